@@ -0,0 +1,319 @@
+#include "math_engine.h"
+#include <math.h>
+#include <stdint.h>
+
+// Micro-benchmarks for every math_operations[] and sort_operations[] entry.
+// The tables are walked at run time, so a newly registered operation is
+// measured without touching this file.
+//   math_engine_bench [--max N] [--repeat N] [--budget SECONDS] [--csv]
+
+#define BENCH_MIN_SIZE 1000
+#define BENCH_DEFAULT_MAX 100000000
+#define BENCH_DEFAULT_REPEAT 5
+#define BENCH_DEFAULT_BUDGET 2.0
+#define BENCH_MIN_ELEMENTS 100000   // Short math ops loop until they touch this many
+
+typedef enum {
+    SHAPE_UNIFORM,
+    SHAPE_SORTED,
+    SHAPE_REVERSE,
+    SHAPE_FEW_UNIQUE,
+    SHAPE_NAN,
+    SHAPE_COUNT
+} InputShape;
+
+static const char *shape_names[SHAPE_COUNT] = {
+    "uniform", "sorted", "reverse", "few-unique", "nan"
+};
+
+typedef struct {
+    int max_size;
+    int repeat;
+    double budget;      // Longest single run worth attempting, in seconds
+    int csv;
+} BenchOptions;
+
+// Run time of one entry at the last two sizes it ran at; used to predict
+// whether the next size fits in the budget
+typedef struct {
+    int last_size;
+    double last_seconds;
+    int prev_size;
+    double prev_seconds;
+    int skipped;
+} GrowthHistory;
+
+typedef struct {
+    double mean;        // ns per element
+    double stddev;
+    double best;
+    int runs;
+} BenchResult;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double random_unit(void) {
+    return (double)(next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void fill_shape(double *values, int n, InputShape shape) {
+    double level = 0.0;
+    switch (shape) {
+        case SHAPE_UNIFORM:
+            for (int i = 0; i < n; i++) values[i] = random_unit() * 1e6;
+            break;
+        case SHAPE_SORTED:
+            for (int i = 0; i < n; i++) values[i] = level += random_unit();
+            break;
+        case SHAPE_REVERSE:
+            for (int i = n - 1; i >= 0; i--) values[i] = level += random_unit();
+            break;
+        case SHAPE_FEW_UNIQUE:
+            for (int i = 0; i < n; i++) values[i] = (double)(next_random() % 16) * 10.0;
+            break;
+        case SHAPE_NAN:
+            // One value in a hundred is NaN
+            for (int i = 0; i < n; i++) values[i] = next_random() % 100 == 0 ? NAN : random_unit() * 1e6;
+            break;
+        case SHAPE_COUNT:
+            break;
+    }
+}
+
+// Predicts the next run time from the growth measured so far; the exponent
+// is clamped so a noisy small size cannot hide an O(n^2) entry
+static int fits_budget(const GrowthHistory *history, int size, double budget) {
+    if (history->skipped) return 0;
+    if (history->last_size == 0) return 1;
+
+    double exponent = 1.0;
+    if (history->prev_size > 0 && history->prev_seconds > 0 && history->last_seconds > 0) {
+        exponent = log(history->last_seconds / history->prev_seconds) /
+                   log((double)history->last_size / history->prev_size);
+        if (exponent < 1.0) exponent = 1.0;
+        if (exponent > 2.5) exponent = 2.5;
+    }
+    double predicted = history->last_seconds * pow((double)size / history->last_size, exponent);
+    return predicted <= budget;
+}
+
+static void record_growth(GrowthHistory *history, int size, double seconds) {
+    history->prev_size = history->last_size;
+    history->prev_seconds = history->last_seconds;
+    history->last_size = size;
+    history->last_seconds = seconds;
+}
+
+static void summarise(const double *samples, int runs, BenchResult *result) {
+    double sum = 0.0, best = INFINITY;
+    for (int r = 0; r < runs; r++) {
+        sum += samples[r];
+        if (samples[r] < best) best = samples[r];
+    }
+    double mean = sum / runs, squares = 0.0;
+    for (int r = 0; r < runs; r++) squares += (samples[r] - mean) * (samples[r] - mean);
+
+    result->mean = mean;
+    result->stddev = runs > 1 ? sqrt(squares / (runs - 1)) : 0.0;
+    result->best = best;
+    result->runs = runs;
+}
+
+// Times a math operation; short inputs are looped so each sample is long
+// enough to measure. Cached state is invalidated between calls.
+static double time_math(MathOperation operation, Dataset *dataset, double *seconds) {
+    int loops = dataset->size < BENCH_MIN_ELEMENTS ? BENCH_MIN_ELEMENTS / dataset->size : 1;
+    volatile double sink = 0.0;
+    double total = 0.0;
+
+    for (int l = 0; l < loops; l++) {
+        dataset_invalidate(dataset);
+        double start = monotonic_seconds();
+        sink += operation(dataset);
+        total += monotonic_seconds() - start;
+    }
+    *seconds = total / loops;
+    return total / loops * 1e9 / dataset->size;
+}
+
+// Times one sort of a fresh copy of the input; the copy is not timed
+static double time_sort(SortOperation operation, Dataset *dataset, const double *input,
+                        int ascending, double *seconds) {
+    memcpy(dataset->data, input, (size_t)dataset->size * sizeof(double));
+    dataset_invalidate(dataset);
+
+    double start = monotonic_seconds();
+    operation(dataset, ascending);
+    *seconds = monotonic_seconds() - start;
+    return *seconds * 1e9 / dataset->size;
+}
+
+static void print_result(const BenchOptions *options, const char *name, const char *order,
+                         InputShape shape, int size, const BenchResult *result) {
+    double cv = result->mean > 0 ? result->stddev / result->mean * 100.0 : 0.0;
+    double throughput = result->mean > 0 ? 1e3 / result->mean : 0.0;
+
+    if (options->csv) {
+        printf("%s,%s,%s,%d,%.4f,%.4f,%.4f,%.3f,%d\n", name, order, shape_names[shape], size,
+               result->mean, result->best, result->stddev, throughput, result->runs);
+    } else {
+        char label[64];
+        snprintf(label, sizeof(label), "%s%s%s", name, *order ? " " : "", order);
+        printf("  %-28s %10.3f ns/elem %10.1f Melem/s  +/-%5.1f%%  (best %.3f, %d runs)\n",
+               label, result->mean, throughput, cv, result->best, result->runs);
+    }
+}
+
+static void print_skipped(const BenchOptions *options, const char *name, const char *order, int size) {
+    if (options->csv) return;
+    char label[64];
+    snprintf(label, sizeof(label), "%s%s%s", name, *order ? " " : "", order);
+    printf("  %-28s skipped (predicted over %.1f s per run at %d)\n", label, options->budget, size);
+}
+
+static int count_entries(void) {
+    int count = 0;
+    while (math_operations[count].operation != NULL) count++;
+    int sorts = 0;
+    while (sort_operations[sorts].operation != NULL) sorts++;
+    return count + 2 * sorts;  // Each sort runs ascending and descending
+}
+
+static int parse_options(int argc, char **argv, BenchOptions *options) {
+    options->max_size = BENCH_DEFAULT_MAX;
+    options->repeat = BENCH_DEFAULT_REPEAT;
+    options->budget = BENCH_DEFAULT_BUDGET;
+    options->csv = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *next = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--csv") == 0) {
+            options->csv = 1;
+        } else if (strcmp(argv[i], "--max") == 0 && next) {
+            options->max_size = atoi(next);
+            i++;
+        } else if (strcmp(argv[i], "--repeat") == 0 && next) {
+            options->repeat = atoi(next);
+            i++;
+        } else if (strcmp(argv[i], "--budget") == 0 && next) {
+            options->budget = atof(next);
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--max N] [--repeat N] [--budget SECONDS] [--csv]\n", argv[0]);
+            return 0;
+        }
+    }
+    if (options->max_size < BENCH_MIN_SIZE) options->max_size = BENCH_MIN_SIZE;
+    if (options->repeat < 1) options->repeat = 1;
+    if (options->budget <= 0) options->budget = BENCH_DEFAULT_BUDGET;
+    return 1;
+}
+
+// Runs every table entry on one input; returns 0 if memory ran out
+static int bench_input(const BenchOptions *options, const double *input, int size, InputShape shape,
+                       GrowthHistory *history, double *samples) {
+    Dataset *dataset = create_dataset(size);
+    if (!dataset) return 0;
+    memcpy(dataset->data, input, (size_t)size * sizeof(double));
+    dataset->size = size;
+
+    BenchResult result;
+    double seconds = 0.0;
+    int entry = 0;
+
+    for (int op = 0; math_operations[op].operation != NULL; op++, entry++) {
+        GrowthHistory *growth = &history[entry * SHAPE_COUNT + shape];
+        if (!fits_budget(growth, size, options->budget)) {
+            growth->skipped = 1;
+            print_skipped(options, math_operations[op].name, "", size);
+            continue;
+        }
+        // One untimed call warms caches and the branch predictors
+        time_math(math_operations[op].operation, dataset, &seconds);
+        double total = 0.0;
+        for (int r = 0; r < options->repeat; r++) {
+            samples[r] = time_math(math_operations[op].operation, dataset, &seconds);
+            total += seconds;
+        }
+        record_growth(growth, size, total / options->repeat);
+        summarise(samples, options->repeat, &result);
+        print_result(options, math_operations[op].name, "", shape, size, &result);
+    }
+
+    for (int op = 0; sort_operations[op].operation != NULL; op++) {
+        for (int ascending = 1; ascending >= 0; ascending--, entry++) {
+            const char *order = ascending ? "asc" : "desc";
+            GrowthHistory *growth = &history[entry * SHAPE_COUNT + shape];
+            if (!fits_budget(growth, size, options->budget)) {
+                growth->skipped = 1;
+                print_skipped(options, sort_operations[op].name, order, size);
+                continue;
+            }
+            double total = 0.0;
+            for (int r = 0; r < options->repeat; r++) {
+                samples[r] = time_sort(sort_operations[op].operation, dataset, input, ascending, &seconds);
+                total += seconds;
+            }
+            record_growth(growth, size, total / options->repeat);
+            summarise(samples, options->repeat, &result);
+            print_result(options, sort_operations[op].name, order, shape, size, &result);
+        }
+    }
+
+    free_dataset(dataset);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) return 2;
+
+    int entries = count_entries();
+    GrowthHistory *history = calloc((size_t)entries * SHAPE_COUNT, sizeof(GrowthHistory));
+    double *samples = malloc((size_t)options.repeat * sizeof(double));
+    if (!history || !samples) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    if (options.csv) {
+        printf("operation,order,shape,size,mean_ns_per_elem,best_ns_per_elem,stddev_ns,melem_per_sec,runs\n");
+    } else {
+        printf("Math engine benchmark: sizes %d..%d, %d runs each, %.1f s budget per run\n",
+               BENCH_MIN_SIZE, options.max_size, options.repeat, options.budget);
+    }
+
+    int status = 0;
+    for (long long size = BENCH_MIN_SIZE; size <= options.max_size; size *= 10) {
+        double *input = malloc((size_t)size * sizeof(double));
+        if (!input) {
+            fprintf(stderr, "Out of memory at %lld elements; stopping\n", size);
+            status = 1;
+            break;
+        }
+
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            fill_shape(input, (int)size, (InputShape)shape);
+            if (!options.csv) printf("\n%lld elements, %s\n", size, shape_names[shape]);
+            if (!bench_input(&options, input, (int)size, (InputShape)shape, history, samples)) {
+                fprintf(stderr, "Out of memory at %lld elements; stopping\n", size);
+                status = 1;
+                break;
+            }
+            fflush(stdout);
+        }
+        free(input);
+        if (status) break;
+    }
+
+    free(history);
+    free(samples);
+    return status;
+}
@@ -0,0 +1,208 @@
+#include "binary_format.h"
+#include <sys/mman.h>
+
+#define WRITE_CHUNK 8192
+
+static int host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const uint8_t *)&probe == 1;
+}
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static void put_double(unsigned char *p, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u64(p, bits);
+}
+
+static uint64_t block_count(uint64_t count, uint32_t block_size) {
+    return block_size ? (count + block_size - 1) / block_size : 0;
+}
+
+// Payload bytes, padded so the footer stays 8-byte aligned
+static uint64_t payload_size(uint64_t count, DataType dtype) {
+    return (count * dtype_size(dtype) + 7) & ~(uint64_t)7;
+}
+
+static int parse_header(const unsigned char *p, size_t size, BinaryHeader *header) {
+    if (!is_binary_data((const char *)p, size) || size < BINARY_HEADER_SIZE) return 0;
+
+    header->version = get_u32(p + 8);
+    header->dtype = get_u32(p + 12);
+    header->count = get_u64(p + 16);
+    header->block_size = get_u32(p + 24);
+
+    if (header->version != BINARY_VERSION || !is_valid_dtype((int)header->dtype)) return 0;
+    if (header->count > INT32_MAX) return 0;
+
+    uint64_t needed = BINARY_HEADER_SIZE + payload_size(header->count, (DataType)header->dtype) +
+                      block_count(header->count, header->block_size) * 2 * sizeof(double);
+    return needed <= size;
+}
+
+int is_binary_data(const char *data, size_t size) {
+    return size >= BINARY_MAGIC_LEN && memcmp(data, BINARY_MAGIC, BINARY_MAGIC_LEN) == 0;
+}
+
+int has_binary_extension(const char *filename) {
+    size_t len = strlen(filename);
+    size_t ext_len = strlen(BINARY_EXTENSION);
+    return len > ext_len && strcmp(filename + len - ext_len, BINARY_EXTENSION) == 0;
+}
+
+// Copies one element of `size` bytes, reversing it on big-endian hosts so
+// the result is little-endian (or, reading back, native)
+static void swap_element(unsigned char *dst, const unsigned char *src, size_t size) {
+    for (size_t i = 0; i < size; i++) dst[i] = src[size - 1 - i];
+}
+
+// Writes the payload little-endian, straight from memory on LE hosts
+static int write_payload(FILE *file, const Dataset *dataset) {
+    size_t elem_size = dtype_size(dataset->dtype);
+    size_t count = (size_t)dataset->size;
+    static const unsigned char padding[8] = {0};
+    size_t pad = (size_t)payload_size(count, dataset->dtype) - count * elem_size;
+
+    if (host_is_little_endian()) {
+        if (fwrite(dataset->values, elem_size, count, file) != count) return 0;
+        return fwrite(padding, 1, pad, file) == pad;
+    }
+
+    unsigned char chunk[WRITE_CHUNK];
+    const unsigned char *values = dataset->values;
+    size_t per_chunk = WRITE_CHUNK / elem_size;
+    for (size_t i = 0; i < count; i += per_chunk) {
+        size_t n = count - i < per_chunk ? count - i : per_chunk;
+        for (size_t j = 0; j < n; j++) {
+            swap_element(chunk + j * elem_size, values + (i + j) * elem_size, elem_size);
+        }
+        if (fwrite(chunk, elem_size, n, file) != n) return 0;
+    }
+    return fwrite(padding, 1, pad, file) == pad;
+}
+
+static int write_footer(FILE *file, const Dataset *dataset, int block_size) {
+    unsigned char pair[2 * sizeof(double)];
+    int count = dataset->size;
+
+    for (int start = 0; start < count; start += block_size) {
+        int end = start + block_size < count ? start + block_size : count;
+        double min = dataset_get(dataset, start), max = min;
+        for (int i = start + 1; i < end; i++) {
+            double value = dataset_get(dataset, i);
+            if (value < min) min = value;
+            if (value > max) max = value;
+        }
+        put_double(pair, min);
+        put_double(pair + sizeof(double), max);
+        if (fwrite(pair, 1, sizeof(pair), file) != sizeof(pair)) return 0;
+    }
+    return 1;
+}
+
+int save_binary_file(Dataset *dataset, const char *filename, int block_size, IoStats *stats) {
+    double start_time = monotonic_seconds();
+    if (block_size < 0) block_size = 0;
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) return 0;
+
+    unsigned char header[BINARY_HEADER_SIZE] = {0};
+    memcpy(header, BINARY_MAGIC, BINARY_MAGIC_LEN);
+    put_u32(header + 8, BINARY_VERSION);
+    put_u32(header + 12, (uint32_t)dataset->dtype);
+    put_u64(header + 16, (uint64_t)dataset->size);
+    put_u32(header + 24, (uint32_t)block_size);
+
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+             write_payload(file, dataset);
+    if (ok && block_size > 0) {
+        ok = write_footer(file, dataset, block_size);
+    }
+    if (fclose(file) != 0) ok = 0;
+
+    if (stats) {
+        stats->bytes = BINARY_HEADER_SIZE + payload_size(dataset->size, dataset->dtype) +
+                       block_count(dataset->size, block_size) * 2 * sizeof(double);
+        stats->values = dataset->size;
+        stats->seconds = monotonic_seconds() - start_time;
+    }
+    return ok;
+}
+
+// Fills the dataset from a binary file view. A mapped view on a
+// little-endian host is adopted as-is: the dataset points into the mapped
+// pages (no copy) until something needs to write to it. Otherwise the
+// payload is decoded into the dataset's heap buffer.
+int load_binary_view(Dataset *dataset, FileView *view) {
+    const unsigned char *bytes = (const unsigned char *)view->data;
+    BinaryHeader header;
+    if (!parse_header(bytes, view->size, &header)) return 0;
+
+    const unsigned char *payload = bytes + BINARY_HEADER_SIZE;
+    int count = (int)header.count;
+    DataType dtype = (DataType)header.dtype;
+    size_t elem_size = dtype_size(dtype);
+
+    if (view->mapped && host_is_little_endian()) {
+        if (dataset->mapping) {
+            munmap(dataset->mapping, dataset->mapping_size);
+        } else {
+            free(dataset->values);
+        }
+        dataset->mapping = (void *)view->data;
+        dataset->mapping_size = view->size;
+        dataset_set_storage(dataset, (void *)payload, dtype);
+        dataset->size = count;
+        dataset->capacity = count;
+        dataset->block_size = (int)header.block_size;
+        dataset->block_minmax = header.block_size ?
+            (const double *)(payload + payload_size(header.count, dtype)) : NULL;
+        dataset_invalidate(dataset);
+
+        // The dataset owns the mapping now
+        view->data = NULL;
+        view->size = 0;
+        return 1;
+    }
+
+    clear_dataset(dataset);
+    if (!dataset_make_writable(dataset)) return 0;
+    if (dataset->dtype != dtype) {
+        void *values = realloc(dataset->values, (size_t)(count > 0 ? count : 1) * elem_size);
+        if (!values) return 0;
+        dataset_set_storage(dataset, values, dtype);
+        dataset->capacity = count > 0 ? count : 1;
+    }
+    if (!dataset_reserve(dataset, count)) return 0;
+
+    unsigned char *values = dataset->values;
+    if (host_is_little_endian()) {
+        memcpy(values, payload, (size_t)count * elem_size);
+    } else {
+        for (int i = 0; i < count; i++) {
+            swap_element(values + (size_t)i * elem_size, payload + (size_t)i * elem_size, elem_size);
+        }
+    }
+    dataset->size = count;
+    return 1;
+}
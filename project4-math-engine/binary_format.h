@@ -0,0 +1,32 @@
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+#include <stdint.h>
+#include "math_engine.h"
+
+// On-disk layout (all fields little-endian):
+//   header  - magic, version, dtype, count, block_size (32 bytes)
+//   payload - count raw elements of the header's dtype (a DataType code),
+//             zero-padded to a multiple of 8 bytes
+//   footer  - ceil(count / block_size) (min, max) double pairs in logical
+//             values, only if block_size > 0
+#define BINARY_MAGIC "MENGDATA"
+#define BINARY_MAGIC_LEN 8
+#define BINARY_VERSION 1
+#define BINARY_HEADER_SIZE 32
+#define BINARY_DEFAULT_BLOCK 4096
+#define BINARY_EXTENSION ".bin"
+
+typedef struct {
+    uint32_t version;
+    uint32_t dtype;
+    uint64_t count;
+    uint32_t block_size;
+} BinaryHeader;
+
+int is_binary_data(const char *data, size_t size);
+int has_binary_extension(const char *filename);
+int save_binary_file(Dataset *dataset, const char *filename, int block_size, IoStats *stats);
+int load_binary_view(Dataset *dataset, FileView *view);
+
+#endif
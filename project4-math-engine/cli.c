@@ -0,0 +1,374 @@
+#include "cli.h"
+#include "pipeline.h"
+#include "engine_context.h"
+#include <math.h>
+
+typedef enum {
+    ACTION_OP,
+    ACTION_SORT,
+    ACTION_SEARCH,
+    ACTION_PIPELINE,
+    ACTION_DTYPE,
+    ACTION_SAVE
+} ActionKind;
+
+typedef struct {
+    ActionKind kind;
+    int index;              // Table index (op, sort) or DataType (dtype)
+    int ascending;
+    double value;
+    const char *text;       // Pipeline expression or filename
+} CliAction;
+
+typedef struct {
+    int json;
+    int repeat;
+    int first_result;
+} CliOutput;
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s --load FILE [actions...] [--json] [--repeat N]\n"
+            "Actions run in the order given:\n"
+            "  --op NAME          math operation (sum, mean, min, max, median, stddev, all)\n"
+            "  --sort ALGO[:ORDER] sort with bubble|selection|quick|radix, ORDER asc|desc\n"
+            "  --search VALUE     indexed search for a value\n"
+            "  --pipeline EXPR    e.g. \"filter > 0 | map * 2 | reduce stddev\"\n"
+            "  --dtype TYPE       convert to float64|float32|int64|fixed32\n"
+            "  --save FILE        save the dataset (.bin for binary)\n"
+            "Options:\n"
+            "  --json             print results as one JSON object\n"
+            "  --repeat N         run each op, search and pipeline N times; report best and mean\n",
+            program);
+}
+
+// Control characters in arguments (tabs, newlines) are escaped too
+static void print_json_string(const char *text) {
+    putchar('"');
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            putchar('\\');
+            putchar(*c);
+        } else if (*c < 0x20) {
+            printf("\\u%04x", *c);
+        } else {
+            putchar(*c);
+        }
+    }
+    putchar('"');
+}
+
+// JSON has no NaN or infinity, so those become null
+static void print_json_number(double value) {
+    char buf[FORMAT_DOUBLE_MAX];
+    if (!isfinite(value)) {
+        printf("null");
+        return;
+    }
+    int len = format_double(value, buf);
+    printf("%.*s", len, buf);
+}
+
+static int parse_dtype(const char *name) {
+    for (int t = DTYPE_FLOAT64; t <= DTYPE_FIXED32; t++) {
+        if (strcmp(name, dtype_name((DataType)t)) == 0) return t;
+    }
+    return 0;
+}
+
+static int parse_sort(const char *spec, CliAction *action) {
+    char name[64];
+    const char *colon = strchr(spec, ':');
+    size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+    if (len >= sizeof(name)) return 0;
+    memcpy(name, spec, len);
+    name[len] = '\0';
+
+    action->index = find_sort_operation(name);
+    action->ascending = 1;
+    if (colon) {
+        if (strcmp(colon + 1, "desc") == 0) action->ascending = 0;
+        else if (strcmp(colon + 1, "asc") != 0) return 0;
+    }
+    return action->index >= 0;
+}
+
+// Opens one result entry; the caller prints its fields and closes it
+static void begin_result(CliOutput *out, const char *action, const char *name) {
+    if (out->json) {
+        printf("%s\n    {\"action\": ", out->first_result ? "" : ",");
+        print_json_string(action);
+        printf(", \"name\": ");
+        print_json_string(name);
+    } else {
+        printf("%s: ", name);
+    }
+    out->first_result = 0;
+}
+
+// Closes a result with the best and mean time over `runs` runs
+static void end_result(CliOutput *out, double best, double total, int runs) {
+    if (out->json) {
+        printf(", \"seconds\": ");
+        print_json_number(best);
+        if (runs > 1) {
+            printf(", \"mean_seconds\": ");
+            print_json_number(total / runs);
+        }
+        printf("}");
+    } else if (runs > 1) {
+        printf(" (best %.3f ms, mean %.3f ms over %d runs)\n", best * 1e3, total / runs * 1e3, runs);
+    } else {
+        printf(" (%.3f ms)\n", best * 1e3);
+    }
+}
+
+static void result_value(CliOutput *out, const char *key, double value) {
+    if (out->json) {
+        printf(", \"%s\": ", key);
+        print_json_number(value);
+    } else {
+        printf("%.6f", value);
+    }
+}
+
+static void run_op(Dataset *dataset, int index, CliOutput *out) {
+    double best = INFINITY, total = 0.0, result = 0.0;
+    for (int r = 0; r < out->repeat; r++) {
+        // Time the computation, not a hit in the result cache; the sort
+        // order is still valid since the contents did not change
+        int sort_order = dataset->sort_order;
+        dataset_invalidate(dataset);
+        dataset->sort_order = sort_order;
+        double start = monotonic_seconds();
+        result = math_operations[index].operation(dataset);
+        double elapsed = monotonic_seconds() - start;
+        total += elapsed;
+        if (elapsed < best) best = elapsed;
+    }
+    begin_result(out, "op", math_operations[index].name);
+    result_value(out, "value", result);
+    end_result(out, best, total, out->repeat);
+}
+
+static int run_action(Dataset *dataset, const CliAction *action, CliOutput *out) {
+    double start, best = INFINITY, total = 0.0;
+
+    switch (action->kind) {
+        case ACTION_OP:
+            if (action->index < 0) {
+                for (int i = 0; math_operations[i].operation != NULL; i++) run_op(dataset, i, out);
+            } else {
+                run_op(dataset, action->index, out);
+            }
+            return 1;
+
+        case ACTION_SORT: {
+            // Sorting is timed once: repeating it would time sorted input
+            start = monotonic_seconds();
+            sort_operations[action->index].operation(dataset, action->ascending);
+            best = monotonic_seconds() - start;
+            begin_result(out, "sort", sort_operations[action->index].name);
+            if (out->json) printf(", \"order\": \"%s\"", action->ascending ? "asc" : "desc");
+            else printf("%s", action->ascending ? "ascending" : "descending");
+            end_result(out, best, best, 1);
+            return 1;
+        }
+
+        case ACTION_SEARCH: {
+            int found = -1;
+            for (int r = 0; r < out->repeat; r++) {
+                start = monotonic_seconds();
+                found = indexed_search(dataset, action->value);
+                double elapsed = monotonic_seconds() - start;
+                total += elapsed;
+                if (elapsed < best) best = elapsed;
+            }
+            char name[64];
+            snprintf(name, sizeof(name), "Search %.6g", action->value);
+            begin_result(out, "search", name);
+            if (out->json) printf(", \"index\": %d", found);
+            else printf("%s%d", found >= 0 ? "index " : "", found);
+            end_result(out, best, total, out->repeat);
+            return 1;
+        }
+
+        case ACTION_PIPELINE: {
+            Pipeline pipeline;
+            if (!pipeline_parse(&pipeline, action->text)) {
+                fprintf(stderr, "Pipeline error: %s\n", pipeline.error);
+                return 0;
+            }
+            PipelineResult result;
+            for (int r = 0; r < out->repeat; r++) {
+                start = monotonic_seconds();
+                int ok = pipeline_run(&pipeline, dataset, NULL, &result);
+                double elapsed = monotonic_seconds() - start;
+                if (!ok) {
+                    fprintf(stderr, "Pipeline failed: %s\n", action->text);
+                    return 0;
+                }
+                total += elapsed;
+                if (elapsed < best) best = elapsed;
+            }
+            begin_result(out, "pipeline", action->text);
+            if (out->json) {
+                printf(", \"passed\": %lld", result.output_count);
+                if (result.has_value) result_value(out, "value", result.value);
+            } else if (result.has_value) {
+                printf("%.6f", result.value);
+            } else {
+                printf("%lld of %lld passed", result.output_count, result.input_count);
+            }
+            end_result(out, best, total, out->repeat);
+            return 1;
+        }
+
+        case ACTION_DTYPE:
+            start = monotonic_seconds();
+            if (!dataset_convert(dataset, (DataType)action->index)) {
+                fprintf(stderr, "Values do not fit in %s\n", dtype_name((DataType)action->index));
+                return 0;
+            }
+            best = monotonic_seconds() - start;
+            begin_result(out, "dtype", dtype_name(dataset->dtype));
+            if (!out->json) printf("converted");
+            end_result(out, best, best, 1);
+            return 1;
+
+        case ACTION_SAVE: {
+            IoStats stats;
+            if (!save_to_file_stats(dataset, action->text, &stats)) {
+                fprintf(stderr, "Failed to save %s\n", action->text);
+                return 0;
+            }
+            begin_result(out, "save", action->text);
+            if (out->json) printf(", \"bytes\": %zu", stats.bytes);
+            else printf("%zu bytes", stats.bytes);
+            end_result(out, stats.seconds, stats.seconds, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int run_cli(int argc, char **argv) {
+    const char *load = NULL;
+    CliAction actions[CLI_MAX_ACTIONS];
+    int action_count = 0;
+    CliOutput out = {0, 1, 1};
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *next = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--json") == 0) {
+            out.json = 1;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (!next) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            print_usage(argv[0]);
+            return 2;
+        }
+        i++;
+
+        if (strcmp(arg, "--load") == 0) {
+            // Actions run on the one dataset, so a second file would
+            // silently replace the first
+            if (load) {
+                fprintf(stderr, "Invalid value for %s: %s (only one dataset can be loaded)\n", arg, next);
+                print_usage(argv[0]);
+                return 2;
+            }
+            load = next;
+            continue;
+        }
+        if (strcmp(arg, "--repeat") == 0) {
+            out.repeat = atoi(next);
+            if (out.repeat < 1) out.repeat = 1;
+            continue;
+        }
+        if (action_count == CLI_MAX_ACTIONS) {
+            fprintf(stderr, "Too many actions (max %d)\n", CLI_MAX_ACTIONS);
+            return 2;
+        }
+
+        CliAction *action = &actions[action_count];
+        memset(action, 0, sizeof(*action));
+        int ok = 1;
+        if (strcmp(arg, "--op") == 0) {
+            action->kind = ACTION_OP;
+            action->index = strcmp(next, "all") == 0 ? -1 : find_math_operation(next);
+            ok = action->index != -1 || strcmp(next, "all") == 0;
+        } else if (strcmp(arg, "--sort") == 0) {
+            action->kind = ACTION_SORT;
+            ok = parse_sort(next, action);
+        } else if (strcmp(arg, "--search") == 0) {
+            char *end;
+            action->kind = ACTION_SEARCH;
+            action->value = strtod(next, &end);
+            ok = end != next && *end == '\0';
+        } else if (strcmp(arg, "--pipeline") == 0) {
+            action->kind = ACTION_PIPELINE;
+            action->text = next;
+        } else if (strcmp(arg, "--dtype") == 0) {
+            action->kind = ACTION_DTYPE;
+            action->index = parse_dtype(next);
+            ok = action->index != 0;
+        } else if (strcmp(arg, "--save") == 0) {
+            action->kind = ACTION_SAVE;
+            action->text = next;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            print_usage(argv[0]);
+            return 2;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "Invalid value for %s: %s\n", arg, next);
+            return 2;
+        }
+        action_count++;
+    }
+
+    if (!load) {
+        fprintf(stderr, "No dataset given (--load FILE)\n");
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    Dataset *dataset = create_dataset(16);
+    IoStats stats;
+    if (!dataset || !load_from_file_stats(dataset, load, &stats)) {
+        fprintf(stderr, "Failed to load data from %s\n", load);
+        free_dataset(dataset);
+        return 1;
+    }
+
+    if (out.json) {
+        printf("{\n  \"load\": {\"file\": ");
+        print_json_string(load);
+        printf(", \"values\": %d, \"dtype\": \"%s\", \"bytes\": %zu, \"seconds\": ",
+               stats.values, dtype_name(dataset->dtype), stats.bytes);
+        print_json_number(stats.seconds);
+        printf("},\n  \"results\": [");
+    } else {
+        printf("Loaded %d values from %s in %.3f ms (%.1f MB/s)\n", stats.values, load,
+               stats.seconds * 1e3, io_stats_mb_per_sec(&stats));
+    }
+
+    int status = 0;
+    for (int i = 0; i < action_count && status == 0; i++) {
+        if (!run_action(dataset, &actions[i], &out)) status = 1;
+    }
+
+    if (out.json) printf("\n  ]\n}\n");
+    free_dataset(dataset);
+    engine_context_free();
+    return status;
+}
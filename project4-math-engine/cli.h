@@ -0,0 +1,13 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include "math_engine.h"
+
+#define CLI_MAX_ACTIONS 64
+
+// Non-interactive mode: loads one dataset, runs the requested actions in
+// command-line order and prints each result with its timing, e.g.
+//   math_engine --load data.bin --op median --op stddev --sort radix:asc --json
+int run_cli(int argc, char **argv);
+
+#endif
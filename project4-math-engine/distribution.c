@@ -0,0 +1,508 @@
+#include "distribution.h"
+#include <math.h>
+#include <stdint.h>
+
+#define FREQUENCY_INITIAL_CAPACITY 64
+#define HISTOGRAM_BAR_WIDTH 40
+#define FREQUENCY_TOP 10
+
+DistributionOperationEntry distribution_operations[] = {
+    {"Fixed-Width Histogram", fixed_width_histogram},
+    {"Log-Scaled Histogram", log_histogram},
+    {"Percentiles (p50/p90/p99/p99.9)", percentile_summary},
+    {"Value Frequency (Mode)", value_frequency},
+    {NULL, NULL}
+};
+
+// ---------------------------------------------------------------------------
+// Bucket mapping
+// ---------------------------------------------------------------------------
+
+// Binary exponent of |value| (value = m * 2^e, 0.5 <= m < 1), clamped
+static int clamped_exponent(double value, int min_exp, int exponents, double *mantissa) {
+    int max_exp = min_exp + exponents - 1;
+    int e;
+    double m;
+    if (isinf(value)) {
+        e = max_exp;
+        m = nextafter(1.0, 0.0);
+    } else {
+        m = frexp(fabs(value), &e);
+        if (e > max_exp) {
+            e = max_exp;
+            m = nextafter(1.0, 0.0);
+        } else if (e < min_exp) {
+            e = min_exp;
+            m = 0.5;
+        }
+    }
+    if (mantissa) *mantissa = m;
+    return e;
+}
+
+// Negative buckets first (largest magnitude first), then zero, then
+// positive buckets, so bucket order is value order
+static int log_bucket(double value) {
+    if (value == 0) return LOG_EXPONENTS;
+    int e = clamped_exponent(value, LOG_EXPONENT_MIN, LOG_EXPONENTS, NULL) - LOG_EXPONENT_MIN;
+    return value < 0 ? LOG_EXPONENTS - 1 - e : LOG_EXPONENTS + 1 + e;
+}
+
+static int hdr_bucket(double value) {
+    double m;
+    int e = clamped_exponent(value, HDR_EXPONENT_MIN, HDR_EXPONENTS, &m) - HDR_EXPONENT_MIN;
+    int sub = (int)((m - 0.5) * 2 * HDR_SUB_BUCKETS);
+    if (sub >= HDR_SUB_BUCKETS) sub = HDR_SUB_BUCKETS - 1;
+    return e * HDR_SUB_BUCKETS + sub;
+}
+
+void distribution_bucket_range(const Distribution *dist, int bucket, double *lo, double *hi) {
+    switch (dist->kind) {
+        case DIST_FIXED_WIDTH:
+            *lo = dist->lo + bucket * dist->width;
+            *hi = dist->lo + (bucket + 1) * dist->width;
+            break;
+        case DIST_LOG_SCALED:
+            if (bucket == LOG_EXPONENTS) {
+                *lo = *hi = 0.0;
+            } else if (bucket > LOG_EXPONENTS) {
+                int e = bucket - LOG_EXPONENTS - 1 + LOG_EXPONENT_MIN;
+                *lo = ldexp(1.0, e - 1);
+                *hi = ldexp(1.0, e);
+            } else {
+                int e = LOG_EXPONENTS - 1 - bucket + LOG_EXPONENT_MIN;
+                *lo = -ldexp(1.0, e);
+                *hi = -ldexp(1.0, e - 1);
+            }
+            break;
+        case DIST_PERCENTILES: {
+            int e = bucket / HDR_SUB_BUCKETS + HDR_EXPONENT_MIN;
+            int sub = bucket % HDR_SUB_BUCKETS;
+            *lo = ldexp(0.5 + sub / (2.0 * HDR_SUB_BUCKETS), e);
+            *hi = ldexp(0.5 + (sub + 1) / (2.0 * HDR_SUB_BUCKETS), e);
+            break;
+        }
+        case DIST_FREQUENCY:
+            *lo = *hi = dist->keys[bucket];
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Frequency table (open addressing keyed on the value's bits)
+// ---------------------------------------------------------------------------
+
+static uint64_t hash_value(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    return bits;
+}
+
+static int frequency_insert(Distribution *dist, double value, long long count);
+
+static int frequency_grow(Distribution *dist) {
+    Distribution old = *dist;
+    int capacity = dist->bucket_count * 2;
+
+    dist->keys = malloc((size_t)capacity * sizeof(double));
+    dist->counts = calloc((size_t)capacity, sizeof(long long));
+    if (!dist->keys || !dist->counts) {
+        free(dist->keys);
+        free(dist->counts);
+        *dist = old;
+        return 0;
+    }
+    dist->bucket_count = capacity;
+    dist->used = 0;
+
+    for (int i = 0; i < old.bucket_count; i++) {
+        if (old.counts[i]) frequency_insert(dist, old.keys[i], old.counts[i]);
+    }
+    free(old.keys);
+    free(old.counts);
+    return 1;
+}
+
+static int frequency_insert(Distribution *dist, double value, long long count) {
+    if ((dist->used + 1) * 10 > dist->bucket_count * 7 && !frequency_grow(dist)) return 0;
+
+    // -0.0 and 0.0 are the same value
+    if (value == 0) value = 0.0;
+
+    int mask = dist->bucket_count - 1;
+    int slot = (int)(hash_value(value) & (uint64_t)mask);
+    while (dist->counts[slot] && dist->keys[slot] != value) {
+        slot = (slot + 1) & mask;
+    }
+    if (!dist->counts[slot]) {
+        dist->keys[slot] = value;
+        dist->used++;
+    }
+    dist->counts[slot] += count;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Building and combining
+// ---------------------------------------------------------------------------
+
+static int distribution_alloc(Distribution *dist, DistributionKind kind, int buckets) {
+    memset(dist, 0, sizeof(*dist));
+    dist->kind = kind;
+    dist->min = INFINITY;
+    dist->max = -INFINITY;
+    dist->bucket_count = buckets;
+    dist->counts = calloc((size_t)buckets, sizeof(long long));
+    if (!dist->counts) return 0;
+
+    if (kind == DIST_FREQUENCY) {
+        dist->keys = malloc((size_t)buckets * sizeof(double));
+        if (!dist->keys) {
+            free(dist->counts);
+            dist->counts = NULL;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Initializes a log-scaled, percentile or frequency distribution; these
+// need no range up front. Fixed-width ones use distribution_init_fixed().
+int distribution_init(Distribution *dist, DistributionKind kind) {
+    switch (kind) {
+        case DIST_LOG_SCALED:
+            return distribution_alloc(dist, kind, 2 * LOG_EXPONENTS + 1);
+        case DIST_PERCENTILES:
+            return distribution_alloc(dist, kind, HDR_EXPONENTS * HDR_SUB_BUCKETS);
+        case DIST_FREQUENCY:
+            return distribution_alloc(dist, kind, FREQUENCY_INITIAL_CAPACITY);
+        default:
+            return 0;
+    }
+}
+
+// `bins` equal buckets over [lo, hi]; values outside are counted as
+// underflow/overflow, as are infinities. The range must be finite.
+// Distributions merge only if their ranges match.
+int distribution_init_fixed(Distribution *dist, double lo, double hi, int bins) {
+    if (bins <= 0 || !isfinite(lo) || !isfinite(hi) || !(hi >= lo)) return 0;
+    if (!distribution_alloc(dist, DIST_FIXED_WIDTH, bins)) return 0;
+
+    dist->lo = lo;
+    dist->hi = hi;
+    dist->width = hi > lo ? (hi - lo) / bins : 1.0;
+    // hi - lo can overflow for ranges spanning most of the double range
+    if (!isfinite(dist->width)) dist->width = hi / bins - lo / bins;
+    return 1;
+}
+
+void distribution_free(Distribution *dist) {
+    free(dist->counts);
+    free(dist->keys);
+    dist->counts = NULL;
+    dist->keys = NULL;
+    dist->bucket_count = 0;
+}
+
+int distribution_add(Distribution *dist, double value) {
+    if (isnan(value)) {
+        dist->nan_count++;
+        return 1;
+    }
+
+    dist->total++;
+    if (value < dist->min) dist->min = value;
+    if (value > dist->max) dist->max = value;
+
+    switch (dist->kind) {
+        case DIST_FIXED_WIDTH: {
+            double offset = (value - dist->lo) / dist->width;
+            if (!isfinite(offset)) {
+                // Infinities never index a bucket
+                if (value < dist->lo) dist->underflow++;
+                else dist->overflow++;
+            } else if (offset < 0) {
+                dist->underflow++;
+            } else if (offset >= dist->bucket_count) {
+                // The range end belongs to the last bucket
+                if (value <= dist->hi) dist->counts[dist->bucket_count - 1]++;
+                else dist->overflow++;
+            } else {
+                dist->counts[(int)offset]++;
+            }
+            return 1;
+        }
+        case DIST_LOG_SCALED:
+            dist->counts[log_bucket(value)]++;
+            return 1;
+        case DIST_PERCENTILES:
+            if (value <= 0) dist->underflow++;
+            else dist->counts[hdr_bucket(value)]++;
+            return 1;
+        case DIST_FREQUENCY:
+            return frequency_insert(dist, value, 1);
+    }
+    return 0;
+}
+
+int distribution_add_dataset(Distribution *dist, const Dataset *dataset) {
+    for (int i = 0; i < dataset->size; i++) {
+        if (!distribution_add(dist, dataset_get(dataset, i))) return 0;
+    }
+    return 1;
+}
+
+int distribution_merge(Distribution *into, const Distribution *other) {
+    if (into->kind != other->kind) return 0;
+    if (into->kind == DIST_FIXED_WIDTH &&
+        (into->bucket_count != other->bucket_count || into->lo != other->lo ||
+         into->hi != other->hi)) {
+        return 0;
+    }
+
+    if (into->kind == DIST_FREQUENCY) {
+        for (int i = 0; i < other->bucket_count; i++) {
+            if (other->counts[i] && !frequency_insert(into, other->keys[i], other->counts[i])) {
+                return 0;
+            }
+        }
+    } else {
+        for (int i = 0; i < into->bucket_count; i++) into->counts[i] += other->counts[i];
+    }
+
+    into->total += other->total;
+    into->nan_count += other->nan_count;
+    into->underflow += other->underflow;
+    into->overflow += other->overflow;
+    if (other->min < into->min) into->min = other->min;
+    if (other->max > into->max) into->max = other->max;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    double value;
+    long long count;
+} FrequencyPair;
+
+static int compare_pairs(const void *a, const void *b) {
+    double x = ((const FrequencyPair *)a)->value, y = ((const FrequencyPair *)b)->value;
+    return (x > y) - (x < y);
+}
+
+// Exact percentile from the frequency table's distinct values
+static double frequency_percentile(const Distribution *dist, double target) {
+    FrequencyPair *pairs = malloc((size_t)(dist->used > 0 ? dist->used : 1) * sizeof(FrequencyPair));
+    if (!pairs) return NAN;
+
+    int n = 0;
+    for (int i = 0; i < dist->bucket_count; i++) {
+        if (dist->counts[i]) pairs[n++] = (FrequencyPair){dist->keys[i], dist->counts[i]};
+    }
+    qsort(pairs, n, sizeof(FrequencyPair), compare_pairs);
+
+    double result = dist->max;
+    long long seen = 0;
+    for (int i = 0; i < n; i++) {
+        seen += pairs[i].count;
+        if (seen >= target) {
+            result = pairs[i].value;
+            break;
+        }
+    }
+    free(pairs);
+    return result;
+}
+
+// Value at quantile q (0..1) of the non-NaN values. Histogram kinds
+// interpolate inside the bucket holding the rank; values counted as
+// underflow or overflow are reported as the exact min or max.
+double distribution_percentile(const Distribution *dist, double q) {
+    if (dist->total == 0) return NAN;
+    if (q <= 0) return dist->min;
+    if (q >= 1) return dist->max;
+
+    double target = q * dist->total;
+    if (target < 1) target = 1;
+    if (dist->kind == DIST_FREQUENCY) return frequency_percentile(dist, target);
+
+    long long seen = dist->underflow;
+    if (seen >= target) return dist->min;
+
+    for (int i = 0; i < dist->bucket_count; i++) {
+        long long count = dist->counts[i];
+        if (count == 0) continue;
+        if (seen + count >= target) {
+            double lo, hi;
+            distribution_bucket_range(dist, i, &lo, &hi);
+            double value = lo + (hi - lo) * ((target - seen) / count);
+            if (value < dist->min) value = dist->min;
+            if (value > dist->max) value = dist->max;
+            return value;
+        }
+        seen += count;
+    }
+    return dist->max;
+}
+
+// Most frequent value (frequency) or the midpoint of the fullest bucket
+// (histograms). Ties go to the smaller value. Returns 0 when empty.
+int distribution_mode(const Distribution *dist, double *value, long long *count) {
+    int best = -1;
+    double best_value = 0;
+
+    for (int i = 0; i < dist->bucket_count; i++) {
+        if (dist->counts[i] == 0) continue;
+        double lo, hi;
+        distribution_bucket_range(dist, i, &lo, &hi);
+        double mid = lo + (hi - lo) / 2;
+        if (best < 0 || dist->counts[i] > dist->counts[best] ||
+            (dist->counts[i] == dist->counts[best] && mid < best_value)) {
+            best = i;
+            best_value = mid;
+        }
+    }
+    if (best < 0) return 0;
+
+    *value = best_value;
+    *count = dist->counts[best];
+    return 1;
+}
+
+static void print_buckets(const Distribution *dist) {
+    long long peak = 1;
+    for (int i = 0; i < dist->bucket_count; i++) {
+        if (dist->counts[i] > peak) peak = dist->counts[i];
+    }
+
+    if (dist->underflow) printf("  %-31s %10lld\n", "below range", dist->underflow);
+    for (int i = 0; i < dist->bucket_count; i++) {
+        if (dist->counts[i] == 0) continue;
+        double lo, hi;
+        distribution_bucket_range(dist, i, &lo, &hi);
+        int bar = (int)(dist->counts[i] * HISTOGRAM_BAR_WIDTH / peak);
+        if (lo == hi) {
+            printf("  [%-14.6g             ] %10lld %.*s\n", lo, dist->counts[i], bar,
+                   "########################################");
+        } else {
+            printf("  [%14.6g, %14.6g) %10lld %.*s\n", lo, hi, dist->counts[i], bar,
+                   "########################################");
+        }
+    }
+    if (dist->overflow) printf("  %-31s %10lld\n", "above range", dist->overflow);
+}
+
+static void print_frequency(const Distribution *dist) {
+    printf("Distinct values: %d\n", dist->used);
+
+    // Repeated selection of the largest remaining count; the list is short
+    int shown[FREQUENCY_TOP];
+    int top = dist->used < FREQUENCY_TOP ? dist->used : FREQUENCY_TOP;
+    for (int t = 0; t < top; t++) {
+        int best = -1;
+        for (int i = 0; i < dist->bucket_count; i++) {
+            if (dist->counts[i] == 0) continue;
+            int taken = 0;
+            for (int s = 0; s < t; s++) taken |= shown[s] == i;
+            if (taken) continue;
+            if (best < 0 || dist->counts[i] > dist->counts[best] ||
+                (dist->counts[i] == dist->counts[best] && dist->keys[i] < dist->keys[best])) {
+                best = i;
+            }
+        }
+        shown[t] = best;
+        printf("  %-14.6g %10lld%s\n", dist->keys[best], dist->counts[best], t == 0 ? "  (mode)" : "");
+    }
+}
+
+void print_distribution(const Distribution *dist) {
+    printf("%lld values", dist->total);
+    if (dist->nan_count) printf(" (+%lld NaN)", dist->nan_count);
+    if (dist->total == 0) {
+        printf("\n");
+        return;
+    }
+    printf(", min %.6g, max %.6g\n", dist->min, dist->max);
+
+    switch (dist->kind) {
+        case DIST_FIXED_WIDTH:
+        case DIST_LOG_SCALED:
+            print_buckets(dist);
+            break;
+        case DIST_PERCENTILES: {
+            static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+            static const char *labels[] = {"p50", "p90", "p99", "p99.9"};
+            for (int i = 0; i < 4; i++) {
+                printf("  %-6s %.6g\n", labels[i], distribution_percentile(dist, quantiles[i]));
+            }
+            printf("  (relative error <= %.2f%% for positive values)\n", 100.0 / HDR_SUB_BUCKETS);
+            break;
+        }
+        case DIST_FREQUENCY:
+            print_frequency(dist);
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Table operations
+// ---------------------------------------------------------------------------
+
+// Range of the finite values, for data whose min or max is infinite or NaN
+static void finite_range(const Dataset *dataset, double *lo, double *hi) {
+    *lo = INFINITY;
+    *hi = -INFINITY;
+    for (int i = 0; i < dataset->size; i++) {
+        double value = dataset_get(dataset, i);
+        if (!isfinite(value)) continue;
+        if (value < *lo) *lo = value;
+        if (value > *hi) *hi = value;
+    }
+}
+
+// The range comes from the dataset's min/max (read from the footer for
+// mapped binary files), then values are counted in one pass. Infinities
+// are left out of the range and land in underflow/overflow.
+int fixed_width_histogram(Dataset *dataset, Distribution *result) {
+    double lo = dataset->size > 0 ? find_minimum(dataset) : 0.0;
+    double hi = dataset->size > 0 ? find_maximum(dataset) : 1.0;
+    if (!isfinite(lo) || !isfinite(hi)) finite_range(dataset, &lo, &hi);
+    if (!isfinite(lo) || !isfinite(hi)) {
+        lo = 0.0;
+        hi = 1.0;
+    }
+
+    if (!distribution_init_fixed(result, lo, hi, HISTOGRAM_DEFAULT_BINS)) return 0;
+    if (!distribution_add_dataset(result, dataset)) {
+        distribution_free(result);
+        return 0;
+    }
+    return 1;
+}
+
+static int single_pass(Dataset *dataset, Distribution *result, DistributionKind kind) {
+    if (!distribution_init(result, kind)) return 0;
+    if (!distribution_add_dataset(result, dataset)) {
+        distribution_free(result);
+        return 0;
+    }
+    return 1;
+}
+
+int log_histogram(Dataset *dataset, Distribution *result) {
+    return single_pass(dataset, result, DIST_LOG_SCALED);
+}
+
+int percentile_summary(Dataset *dataset, Distribution *result) {
+    return single_pass(dataset, result, DIST_PERCENTILES);
+}
+
+int value_frequency(Dataset *dataset, Distribution *result) {
+    return single_pass(dataset, result, DIST_FREQUENCY);
+}
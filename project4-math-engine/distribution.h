@@ -0,0 +1,74 @@
+#ifndef DISTRIBUTION_H
+#define DISTRIBUTION_H
+
+#include "math_engine.h"
+
+#define HISTOGRAM_DEFAULT_BINS 20
+
+// Log-scaled buckets cover binary exponents [-64, 63] on each side of zero
+#define LOG_EXPONENT_MIN -64
+#define LOG_EXPONENTS 128
+
+// Percentile buckets: each power of two is split into HDR_SUB_BUCKETS
+// linear sub-buckets, bounding the relative error by 1/HDR_SUB_BUCKETS
+#define HDR_SUB_BUCKETS 128
+#define HDR_EXPONENT_MIN -64
+#define HDR_EXPONENTS 128
+
+typedef enum {
+    DIST_FIXED_WIDTH,
+    DIST_LOG_SCALED,
+    DIST_PERCENTILES,
+    DIST_FREQUENCY
+} DistributionKind;
+
+// Result of a distribution operation. Built in one pass with
+// distribution_add() and mergeable with distribution_merge(), so chunks or
+// threads can each fill their own and combine them afterwards.
+typedef struct {
+    DistributionKind kind;
+    long long total;        // Non-NaN values counted
+    long long nan_count;
+    double min;
+    double max;
+    long long underflow;    // Fixed-width: below lo; percentiles: <= 0
+    long long overflow;     // Fixed-width: above hi
+    int bucket_count;
+    long long *counts;
+    double lo;              // Fixed-width range and bucket width
+    double hi;
+    double width;
+    double *keys;           // Frequency: distinct values (open addressing)
+    int used;
+} Distribution;
+
+typedef int (*DistributionOperation)(Dataset *dataset, Distribution *result);
+
+typedef struct {
+    const char *name;
+    DistributionOperation operation;
+} DistributionOperationEntry;
+
+extern DistributionOperationEntry distribution_operations[];
+
+// Building and combining
+int distribution_init(Distribution *dist, DistributionKind kind);
+int distribution_init_fixed(Distribution *dist, double lo, double hi, int bins);
+void distribution_free(Distribution *dist);
+int distribution_add(Distribution *dist, double value);
+int distribution_add_dataset(Distribution *dist, const Dataset *dataset);
+int distribution_merge(Distribution *into, const Distribution *other);
+
+// Queries
+void distribution_bucket_range(const Distribution *dist, int bucket, double *lo, double *hi);
+double distribution_percentile(const Distribution *dist, double q);
+int distribution_mode(const Distribution *dist, double *value, long long *count);
+void print_distribution(const Distribution *dist);
+
+// Table operations
+int fixed_width_histogram(Dataset *dataset, Distribution *result);
+int log_histogram(Dataset *dataset, Distribution *result);
+int percentile_summary(Dataset *dataset, Distribution *result);
+int value_frequency(Dataset *dataset, Distribution *result);
+
+#endif
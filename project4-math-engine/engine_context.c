@@ -0,0 +1,103 @@
+#include "engine_context.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Arena sizes are rounded to this, which is also the huge page size
+#define ARENA_GRANULE (2u << 20)
+
+struct ScratchOverflow {
+    struct ScratchOverflow *next;
+};
+
+static EngineContext context;
+static int context_ready = 0;
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+EngineContext* engine_context(void) {
+    if (!context_ready) {
+        memset(&context, 0, sizeof(context));
+        const char *huge = getenv("MATH_ENGINE_HUGEPAGES");
+        context.scratch.huge_pages = huge && *huge && strcmp(huge, "0") != 0;
+        context_ready = 1;
+    }
+    return &context;
+}
+
+void engine_context_use_huge_pages(int enable) {
+    engine_context()->scratch.huge_pages = enable;
+}
+
+static void free_overflow(ScratchArena *arena) {
+    while (arena->overflow) {
+        struct ScratchOverflow *next = arena->overflow->next;
+        free(arena->overflow);
+        arena->overflow = next;
+    }
+}
+
+// Replaces an empty arena with one that holds `bytes`; keeps the old one if
+// the mapping fails, in which case requests keep overflowing to the heap
+static void arena_grow(ScratchArena *arena, size_t bytes) {
+    size_t capacity = align_up(bytes, ARENA_GRANULE);
+    void *base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return;
+#ifdef MADV_HUGEPAGE
+    if (arena->huge_pages) madvise(base, capacity, MADV_HUGEPAGE);
+#endif
+
+    if (arena->base) munmap(arena->base, arena->capacity);
+    arena->base = base;
+    arena->capacity = capacity;
+    arena->grows++;
+}
+
+void engine_context_free(void) {
+    ScratchArena *arena = &engine_context()->scratch;
+    free_overflow(arena);
+    if (arena->base) munmap(arena->base, arena->capacity);
+    int huge_pages = arena->huge_pages;
+    memset(arena, 0, sizeof(*arena));
+    arena->huge_pages = huge_pages;
+}
+
+void* scratch_alloc(size_t bytes) {
+    ScratchArena *arena = &engine_context()->scratch;
+    size_t size = align_up(bytes > 0 ? bytes : 1, SCRATCH_ALIGN);
+    void *block;
+
+    if (arena->used + size <= arena->capacity) {
+        block = arena->base + arena->used;
+    } else {
+        // The header is padded so the block keeps SCRATCH_ALIGN alignment
+        struct ScratchOverflow *overflow;
+        if (posix_memalign((void **)&overflow, SCRATCH_ALIGN, SCRATCH_ALIGN + size) != 0) return NULL;
+        overflow->next = arena->overflow;
+        arena->overflow = overflow;
+        arena->overflow_allocations++;
+        block = (unsigned char *)overflow + SCRATCH_ALIGN;
+    }
+
+    arena->used += size;
+    if (arena->used > arena->peak) arena->peak = arena->used;
+    return block;
+}
+
+size_t scratch_mark(void) {
+    return engine_context()->scratch.used;
+}
+
+void scratch_release(size_t mark) {
+    ScratchArena *arena = &engine_context()->scratch;
+    if (mark > arena->used) return;
+    arena->used = mark;
+    if (mark > 0) return;
+
+    // Empty: drop heap overflow and regrow so the peak fits next time
+    if (arena->overflow) free_overflow(arena);
+    if (arena->peak > arena->capacity) arena_grow(arena, arena->peak);
+    arena->peak = 0;
+}
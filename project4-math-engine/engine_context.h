@@ -0,0 +1,45 @@
+#ifndef ENGINE_CONTEXT_H
+#define ENGINE_CONTEXT_H
+
+#include <stddef.h>
+
+// Scratch allocations are aligned to a cache line
+#define SCRATCH_ALIGN 64
+
+struct ScratchOverflow;
+
+// Bump allocator for short-lived buffers. Requests past the end of the
+// arena are served from the heap; once every buffer has been released the
+// arena regrows to the peak, so steady-state use allocates nothing.
+typedef struct {
+    unsigned char *base;
+    size_t capacity;
+    size_t used;                // Bytes handed out, including overflow
+    size_t peak;                // Largest `used` since the arena was last empty
+    struct ScratchOverflow *overflow;
+    int huge_pages;             // Advise transparent huge pages on the arena
+    size_t grows;               // Times the arena was remapped
+    size_t overflow_allocations;
+} ScratchArena;
+
+// Owns the engine's reusable state. One process-wide context backs the
+// operations in math_engine.c, which keep their table signatures; it is
+// not thread-safe, so worker threads allocate for themselves.
+typedef struct {
+    ScratchArena scratch;
+} EngineContext;
+
+EngineContext* engine_context(void);
+void engine_context_free(void);
+void engine_context_use_huge_pages(int enable);
+
+// Buffers are released in LIFO order by rewinding to an earlier mark:
+//   size_t mark = scratch_mark();
+//   double *copy = scratch_alloc(n * sizeof(double));
+//   ...
+//   scratch_release(mark);
+void* scratch_alloc(size_t bytes);
+size_t scratch_mark(void);
+void scratch_release(size_t mark);
+
+#endif
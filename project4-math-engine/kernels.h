@@ -0,0 +1,200 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+// Kernel generators. Each macro expands to static functions specialised for
+// one element type and (for sorts) one ordering, so the comparison is a
+// compile-time expression the compiler can inline and vectorise instead of
+// an `ascending ? ... : ...` branch evaluated per element.
+
+#define KERNEL_ASC(a, b) ((a) < (b))
+#define KERNEL_DESC(a, b) ((a) > (b))
+
+// Ranges at or below this size finish with insertion sort
+#define KERNEL_SMALL_SORT 16
+
+// Sort kernels: BEFORE(a, b) is true when a must come before b
+#define DEFINE_SORT_KERNELS(T, SUFFIX, BEFORE)                                  \
+static void bubble_sort_##SUFFIX(T *data, int n) {                             \
+    for (int i = 0; i < n - 1; i++) {                                          \
+        for (int j = 0; j < n - i - 1; j++) {                                  \
+            if (BEFORE(data[j + 1], data[j])) {                                \
+                T temp = data[j];                                              \
+                data[j] = data[j + 1];                                         \
+                data[j + 1] = temp;                                            \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static void selection_sort_##SUFFIX(T *data, int n) {                          \
+    for (int i = 0; i < n - 1; i++) {                                          \
+        int target_idx = i;                                                    \
+        for (int j = i + 1; j < n; j++) {                                      \
+            if (BEFORE(data[j], data[target_idx])) target_idx = j;             \
+        }                                                                      \
+        if (target_idx != i) {                                                 \
+            T temp = data[i];                                                  \
+            data[i] = data[target_idx];                                        \
+            data[target_idx] = temp;                                           \
+        }                                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static void insertion_sort_##SUFFIX(T *data, int n) {                          \
+    for (int i = 1; i < n; i++) {                                              \
+        T value = data[i];                                                     \
+        int j = i - 1;                                                         \
+        while (j >= 0 && BEFORE(value, data[j])) {                             \
+            data[j + 1] = data[j];                                             \
+            j--;                                                               \
+        }                                                                      \
+        data[j + 1] = value;                                                   \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+/* Hoare partitioning around a median-of-three pivot; every scan is      */    \
+/* bounds-checked so unordered values (NaN) cannot run off the range     */    \
+static void quick_sort_##SUFFIX(T *data, int lo, int hi) {                     \
+    while (hi - lo >= KERNEL_SMALL_SORT) {                                     \
+        int mid = lo + (hi - lo) / 2;                                          \
+        T a = data[lo], b = data[mid], c = data[hi];                           \
+        T pivot = BEFORE(a, b) ?                                               \
+            (BEFORE(b, c) ? b : (BEFORE(a, c) ? c : a)) :                      \
+            (BEFORE(a, c) ? a : (BEFORE(b, c) ? c : b));                       \
+        int i = lo, j = hi;                                                    \
+        while (i <= j) {                                                       \
+            while (i <= hi && BEFORE(data[i], pivot)) i++;                     \
+            while (j >= lo && BEFORE(pivot, data[j])) j--;                     \
+            if (i <= j) {                                                      \
+                T temp = data[i];                                              \
+                data[i] = data[j];                                             \
+                data[j] = temp;                                                \
+                i++;                                                           \
+                j--;                                                           \
+            }                                                                  \
+        }                                                                      \
+        /* Recurse into the smaller side to bound stack depth */               \
+        if (j - lo < hi - i) {                                                 \
+            quick_sort_##SUFFIX(data, lo, j);                                  \
+            lo = i;                                                            \
+        } else {                                                               \
+            quick_sort_##SUFFIX(data, i, hi);                                  \
+            hi = j;                                                            \
+        }                                                                      \
+    }                                                                          \
+    insertion_sort_##SUFFIX(data + lo, hi - lo + 1);                           \
+}
+
+// Reduction and scan kernels. Four independent accumulators break the
+// loop-carried dependency so the loops pipeline and vectorise without
+// -ffast-math. ACC is the accumulator type of the sum.
+#define DEFINE_REDUCE_KERNELS(T, ACC, SUFFIX)                                  \
+static inline ACC sum_##SUFFIX(const T *data, int n) {                         \
+    ACC s0 = 0, s1 = 0, s2 = 0, s3 = 0;                                        \
+    int i = 0;                                                                 \
+    for (; i + 4 <= n; i += 4) {                                               \
+        s0 += data[i];                                                         \
+        s1 += data[i + 1];                                                     \
+        s2 += data[i + 2];                                                     \
+        s3 += data[i + 3];                                                     \
+    }                                                                          \
+    for (; i < n; i++) s0 += data[i];                                          \
+    return (s0 + s1) + (s2 + s3);                                              \
+}                                                                              \
+                                                                               \
+static inline T min_##SUFFIX(const T *data, int n) {                           \
+    T m0 = data[0], m1 = data[0], m2 = data[0], m3 = data[0];                  \
+    int i = 1;                                                                 \
+    for (; i + 4 <= n; i += 4) {                                               \
+        m0 = data[i] < m0 ? data[i] : m0;                                      \
+        m1 = data[i + 1] < m1 ? data[i + 1] : m1;                              \
+        m2 = data[i + 2] < m2 ? data[i + 2] : m2;                              \
+        m3 = data[i + 3] < m3 ? data[i + 3] : m3;                              \
+    }                                                                          \
+    for (; i < n; i++) m0 = data[i] < m0 ? data[i] : m0;                       \
+    m0 = m1 < m0 ? m1 : m0;                                                    \
+    m2 = m3 < m2 ? m3 : m2;                                                    \
+    return m2 < m0 ? m2 : m0;                                                  \
+}                                                                              \
+                                                                               \
+static inline T max_##SUFFIX(const T *data, int n) {                           \
+    T m0 = data[0], m1 = data[0], m2 = data[0], m3 = data[0];                  \
+    int i = 1;                                                                 \
+    for (; i + 4 <= n; i += 4) {                                               \
+        m0 = data[i] > m0 ? data[i] : m0;                                      \
+        m1 = data[i + 1] > m1 ? data[i + 1] : m1;                              \
+        m2 = data[i + 2] > m2 ? data[i + 2] : m2;                              \
+        m3 = data[i + 3] > m3 ? data[i + 3] : m3;                              \
+    }                                                                          \
+    for (; i < n; i++) m0 = data[i] > m0 ? data[i] : m0;                       \
+    m0 = m1 > m0 ? m1 : m0;                                                    \
+    m2 = m3 > m2 ? m3 : m2;                                                    \
+    return m2 > m0 ? m2 : m0;                                                  \
+}                                                                              \
+                                                                               \
+static inline double sum_squared_diff_##SUFFIX(const T *data, int n, double mean) { \
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;                                     \
+    int i = 0;                                                                 \
+    for (; i + 4 <= n; i += 4) {                                               \
+        double d0 = data[i] - mean, d1 = data[i + 1] - mean;                   \
+        double d2 = data[i + 2] - mean, d3 = data[i + 3] - mean;               \
+        s0 += d0 * d0;                                                         \
+        s1 += d1 * d1;                                                         \
+        s2 += d2 * d2;                                                         \
+        s3 += d3 * d3;                                                         \
+    }                                                                          \
+    for (; i < n; i++) {                                                       \
+        double d = data[i] - mean;                                             \
+        s0 += d * d;                                                           \
+    }                                                                          \
+    return (s0 + s1) + (s2 + s3);                                              \
+}                                                                              \
+                                                                               \
+/* First index in [start, end) within 0.001 of value; scale converts   */      \
+/* stored units to logical values                                        */    \
+static inline int linear_find_##SUFFIX(const T *data, int start, int end,     \
+                                       double value, double scale) {          \
+    for (int i = start; i < end; i++) {                                        \
+        if (fabs(data[i] * scale - value) < 0.001) return i;                   \
+    }                                                                          \
+    return -1;                                                                 \
+}
+
+// LSD radix sort on order-preserving unsigned keys. KEY(value) maps each
+// element to a uint64_t whose unsigned order is the wanted order, so the
+// direction is folded into the key function. Passes whose digit is the
+// same for every element are skipped.
+#define DEFINE_RADIX_KERNEL(T, SUFFIX, KEY)                                    \
+static void radix_sort_##SUFFIX(T *data, T *scratch, int n) {                  \
+    int counts[8][256];                                                        \
+    memset(counts, 0, sizeof(counts));                                         \
+    for (int i = 0; i < n; i++) {                                              \
+        uint64_t key = KEY(data[i]);                                           \
+        for (int pass = 0; pass < 8; pass++) {                                 \
+            counts[pass][(key >> (8 * pass)) & 0xff]++;                        \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    T *src = data, *dst = scratch;                                             \
+    for (int pass = 0; pass < 8; pass++) {                                     \
+        int *count = counts[pass];                                             \
+        int shift = 8 * pass;                                                  \
+        if (count[(KEY(src[0]) >> shift) & 0xff] == n) continue;               \
+                                                                               \
+        int offset = 0;                                                        \
+        for (int d = 0; d < 256; d++) {                                        \
+            int c = count[d];                                                  \
+            count[d] = offset;                                                 \
+            offset += c;                                                       \
+        }                                                                      \
+        for (int i = 0; i < n; i++) {                                          \
+            dst[count[(KEY(src[i]) >> shift) & 0xff]++] = src[i];              \
+        }                                                                      \
+        T *temp = src;                                                         \
+        src = dst;                                                             \
+        dst = temp;                                                            \
+    }                                                                          \
+    if (src != data) memcpy(data, src, (size_t)n * sizeof(T));                 \
+}
+
+#endif
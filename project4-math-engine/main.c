@@ -1,4 +1,11 @@
 #include "math_engine.h"
+#include "stream_engine.h"
+#include "distribution.h"
+#include "rolling.h"
+#include "multivariate.h"
+#include "pipeline.h"
+#include "cli.h"
+#include "engine_context.h"
 
 void display_menu() {
     printf("\n=== Dynamic Math & Data Processing Engine ===\n");
@@ -11,7 +18,16 @@ void display_menu() {
     printf("7. Load from File\n");
     printf("8. Save to File\n");
     printf("9. Clear Dataset\n");
-    printf("10. Exit\n");
+    printf("10. Stream Statistics from File\n");
+    printf("11. External Sort File\n");
+    printf("12. Batch Search\n");
+    printf("13. Change Element Type\n");
+    printf("14. Clean Dataset\n");
+    printf("15. Distribution Analysis\n");
+    printf("16. Rolling Window\n");
+    printf("17. Multi-Column Statistics\n");
+    printf("18. Run Pipeline\n");
+    printf("0. Exit\n");
     printf("============================================\n");
     printf("Choose an option: ");
 }
@@ -32,7 +48,312 @@ void display_sort_operations() {
     printf("Choose sort algorithm: ");
 }
 
-int main() {
+void display_distribution_operations() {
+    printf("\nAvailable Distribution Operations:\n");
+    for (int i = 0; distribution_operations[i].operation != NULL; i++) {
+        printf("%d. %s\n", i, distribution_operations[i].name);
+    }
+    printf("Choose operation: ");
+}
+
+void execute_distribution_operation(Dataset *dataset, int choice) {
+    int count = 0;
+    while (distribution_operations[count].operation != NULL) count++;
+    if (choice < 0 || choice >= count) {
+        printf("Invalid operation choice!\n");
+        return;
+    }
+    
+    Distribution result;
+    if (!distribution_operations[choice].operation(dataset, &result)) {
+        printf("%s failed!\n", distribution_operations[choice].name);
+        return;
+    }
+    printf("%s: ", distribution_operations[choice].name);
+    print_distribution(&result);
+    distribution_free(&result);
+}
+
+static void print_rolling_stats(const RollingWindow *rolling) {
+    printf("Last %d of %lld samples:\n", rolling_count(rolling), rolling->seen);
+    for (int i = 0; rolling_operations[i].operation != NULL; i++) {
+        printf("%s: %.6f\n", rolling_operations[i].name, rolling_operations[i].operation(rolling));
+    }
+}
+
+// Live tracking keeps one window attached to the dataset; series mode
+// evaluates a statistic at every position of the existing data
+void run_rolling_window(Dataset *dataset, RollingWindow *live, int *live_active) {
+    int option, window;
+    double alpha;
+    printf("\nRolling Window Options:\n");
+    printf("1. Track live window on new elements\n");
+    printf("2. Show live window statistics\n");
+    printf("3. Compute series over dataset\n");
+    printf("4. Stop live tracking\n");
+    printf("Choose rolling option: ");
+    if (scanf("%d", &option) != 1) option = 0;
+    
+    if (option == 2) {
+        if (*live_active) print_rolling_stats(live);
+        else printf("No live window is being tracked!\n");
+        return;
+    }
+    if (option == 4) {
+        if (*live_active) {
+            rolling_detach(dataset);
+            rolling_free(live);
+            *live_active = 0;
+        }
+        printf("Live tracking stopped.\n");
+        return;
+    }
+    if (option != 1 && option != 3) {
+        printf("Invalid rolling option!\n");
+        return;
+    }
+    
+    printf("Window size: ");
+    if (scanf("%d", &window) != 1) window = 0;
+    printf("EWMA alpha (0-1, e.g. %.1f): ", ROLLING_DEFAULT_ALPHA);
+    if (scanf("%lf", &alpha) != 1) alpha = 0;
+    
+    if (option == 1) {
+        if (*live_active) {
+            rolling_detach(dataset);
+            rolling_free(live);
+            *live_active = 0;
+        }
+        if (!rolling_init(live, window, alpha)) {
+            printf("Invalid window size or alpha!\n");
+            return;
+        }
+        rolling_attach(live, dataset);
+        *live_active = 1;
+        print_rolling_stats(live);
+        return;
+    }
+    
+    printf("\nAvailable Rolling Operations:\n");
+    for (int i = 0; rolling_operations[i].operation != NULL; i++) {
+        printf("%d. %s\n", i, rolling_operations[i].name);
+    }
+    printf("Choose operation: ");
+    int choice, count = 0;
+    if (scanf("%d", &choice) != 1) choice = -1;
+    while (rolling_operations[count].operation != NULL) count++;
+    if (choice < 0 || choice >= count) {
+        printf("Invalid operation choice!\n");
+        return;
+    }
+    
+    Dataset *series = create_dataset(dataset->size > 0 ? dataset->size : 1);
+    if (series && rolling_series(dataset, window, alpha, rolling_operations[choice].operation, series)) {
+        printf("%s series: ", rolling_operations[choice].name);
+        print_dataset(series);
+    } else {
+        printf("Invalid window size or alpha!\n");
+    }
+    free_dataset(series);
+}
+
+static void print_matrix(const char *title, const double *matrix, int k) {
+    printf("%s:\n", title);
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < k; j++) printf("%12.6f ", matrix[i * k + j]);
+        printf("\n");
+    }
+}
+
+// Loads a k-column text file and relates its columns
+void run_multi_column(const char *filename, int column_count) {
+    Table table;
+    double start_time = monotonic_seconds();
+    if (!load_table(&table, filename, column_count)) {
+        printf("Failed to load %d columns from %s!\n", column_count, filename);
+        return;
+    }
+    printf("Loaded %d rows x %d columns in %.3f s\n", table_rows(&table), column_count,
+           monotonic_seconds() - start_time);
+    
+    if (column_count >= 2) {
+        Dataset *x = table.columns[0], *y = table.columns[1];
+        PairMoments moments;
+        LinearFit fit;
+        compute_pair_moments(x, y, &moments);
+        printf("Columns 0 and 1:\n");
+        printf("Covariance: %.6f\n", moments_covariance(&moments));
+        printf("Pearson correlation: %.6f\n", moments_correlation(&moments));
+        printf("Spearman correlation: %.6f\n", spearman_correlation(x, y));
+        if (linear_regression(x, y, &fit)) {
+            printf("Regression: y = %.6f * x + %.6f (R^2 = %.6f)\n",
+                   fit.slope, fit.intercept, fit.r_squared);
+        }
+    }
+    
+    double *matrix = malloc((size_t)column_count * column_count * sizeof(double));
+    start_time = monotonic_seconds();
+    if (matrix && covariance_matrix(&table, matrix)) {
+        double seconds = monotonic_seconds() - start_time;
+        print_matrix("Covariance matrix", matrix, column_count);
+        correlation_from_covariance(matrix, column_count);
+        print_matrix("Correlation matrix", matrix, column_count);
+        printf("Matrix computed in %.3f s\n", seconds);
+    } else {
+        printf("Covariance matrix failed!\n");
+    }
+    
+    free(matrix);
+    table_free(&table);
+}
+
+// Parses and runs a pipeline; without a reduce stage the survivors
+// replace the dataset's contents
+void run_pipeline(Dataset *dataset, const char *text) {
+    Pipeline pipeline;
+    if (!pipeline_parse(&pipeline, text)) {
+        printf("Pipeline error: %s\n", pipeline.error);
+        return;
+    }
+    
+    Dataset *output = create_typed_dataset(PIPELINE_BLOCK, dataset->dtype);
+    PipelineResult result;
+    double start_time = monotonic_seconds();
+    if (!output || !pipeline_run(&pipeline, dataset, output, &result)) {
+        printf("Pipeline failed!\n");
+        free_dataset(output);
+        return;
+    }
+    double seconds = monotonic_seconds() - start_time;
+    
+    printf("%lld of %lld elements passed the filters (%.3f s)\n",
+           result.output_count, result.input_count, seconds);
+    if (result.has_value) {
+        const PipelineStage *reduce = &pipeline.stages[pipeline.count - 1];
+        printf("%s: %.6f\n", math_operations[reduce->reduce].name, result.value);
+    } else {
+        clear_dataset(dataset);
+        for (int i = 0; i < output->size; i++) add_element(dataset, dataset_get(output, i));
+        print_dataset(dataset);
+    }
+    free_dataset(output);
+}
+
+// Computes every streamable operation over a file without loading it
+void run_stream_statistics(const char *filename, double epsilon) {
+    StreamSummary summary;
+    double start_time = monotonic_seconds();
+    
+    if (!stream_file(filename, STREAM_DEFAULT_CHUNK, epsilon, &summary)) {
+        printf("Failed to stream data from %s!\n", filename);
+        return;
+    }
+    
+    printf("Streamed %lld values in %.3f s\n", summary.count, monotonic_seconds() - start_time);
+    for (int i = 0; math_operations[i].operation != NULL; i++) {
+        double result = stream_summary_result(&summary, math_operations[i].operation);
+        if (math_operations[i].operation == compute_median) {
+            printf("%s (approx, rank error %.3g): %.6f\n", math_operations[i].name, epsilon, result);
+        } else {
+            printf("%s: %.6f\n", math_operations[i].name, result);
+        }
+    }
+    stream_summary_free(&summary);
+}
+
+// Reads a list of values and looks all of them up in one pass
+void run_batch_search(Dataset *dataset) {
+    int count;
+    printf("How many values to search for? ");
+    if (scanf("%d", &count) != 1 || count <= 0) {
+        printf("Invalid count!\n");
+        return;
+    }
+    
+    size_t mark = scratch_mark();
+    double *queries = scratch_alloc(count * sizeof(double));
+    int *results = scratch_alloc(count * sizeof(int));
+    if (!queries || !results) {
+        printf("Memory allocation failed!\n");
+        scratch_release(mark);
+        return;
+    }
+    
+    printf("Enter %d values: ", count);
+    for (int i = 0; i < count; i++) {
+        if (scanf("%lf", &queries[i]) != 1) queries[i] = 0.0;
+    }
+    
+    if (batch_search(dataset, queries, count, results)) {
+        for (int i = 0; i < count; i++) {
+            if (results[i] != -1) {
+                printf("%.2f: Found at index %d\n", queries[i], results[i]);
+            } else {
+                printf("%.2f: Not found\n", queries[i]);
+            }
+        }
+    } else {
+        printf("Batch search failed!\n");
+    }
+    
+    scratch_release(mark);
+}
+
+// Bulk removal: every option compacts the dataset in a single pass
+void run_clean_dataset(Dataset *dataset) {
+    int option, removed = 0;
+    printf("\nCleaning Options:\n");
+    printf("1. Drop NaN values\n");
+    printf("2. Drop values beyond k standard deviations\n");
+    printf("3. Drop a list of indices\n");
+    printf("Choose cleaning option: ");
+    if (scanf("%d", &option) != 1) option = 0;
+    
+    if (option == 1) {
+        removed = remove_nan(dataset);
+    } else if (option == 2) {
+        double k;
+        printf("Enter k (e.g. 3): ");
+        if (scanf("%lf", &k) != 1 || k < 0) {
+            printf("Invalid k!\n");
+            return;
+        }
+        removed = remove_outliers(dataset, k);
+    } else if (option == 3) {
+        int count;
+        printf("How many indices? ");
+        if (scanf("%d", &count) != 1 || count <= 0) {
+            printf("Invalid count!\n");
+            return;
+        }
+        size_t mark = scratch_mark();
+        int *indices = scratch_alloc(count * sizeof(int));
+        if (!indices) {
+            printf("Memory allocation failed!\n");
+            return;
+        }
+        printf("Enter %d indices: ", count);
+        for (int i = 0; i < count; i++) {
+            if (scanf("%d", &indices[i]) != 1) indices[i] = -1;
+        }
+        removed = remove_indices(dataset, indices, count);
+        scratch_release(mark);
+    } else {
+        printf("Invalid cleaning option!\n");
+        return;
+    }
+    
+    if (removed < 0) {
+        printf("Cleaning failed!\n");
+    } else {
+        printf("Removed %d elements, %d remain\n", removed, dataset->size);
+    }
+}
+
+int main(int argc, char **argv) {
+    // Any argument selects the non-interactive batch mode
+    if (argc > 1) return run_cli(argc, argv);
+    
     Dataset *dataset = create_dataset(10);
     if (!dataset) {
         printf("Failed to create dataset!\n");
@@ -43,12 +364,25 @@ int main() {
     double value;
     int index, operation_choice;
     char filename[256];
+    char output_filename[256];
+    char expression[512];
+    double epsilon;
+    int order;
+    IoStats io_stats;
+    RollingWindow rolling_window;
+    int rolling_active = 0;
     
     printf("Welcome to Dynamic Math & Data Processing Engine!\n");
     
     while (1) {
         display_menu();
-        scanf("%d", &choice);
+        int scanned = scanf("%d", &choice);
+        if (scanned == EOF) {
+            choice = 0;
+        } else if (scanned != 1) {
+            scanf("%*s");
+            choice = -1;
+        }
         
         switch (choice) {
             case 1:
@@ -98,28 +432,24 @@ int main() {
                     printf("Linear Search: Not found\n");
                 }
                 
-                // For binary search, we need sorted data
-                Dataset *temp = create_dataset(dataset->size);
-                for (int i = 0; i < dataset->size; i++) {
-                    add_element(temp, dataset->data[i]);
-                }
-                bubble_sort(temp, 1);
-                
-                int binary_result = binary_search(temp, value);
-                if (binary_result != -1) {
-                    printf("Binary Search (on sorted copy): Found at index %d\n", binary_result);
+                int indexed_result = indexed_search(dataset, value);
+                const char *view = dataset->sort_order != SORT_UNKNOWN ?
+                    "sorted data" : "cached sorted index";
+                if (indexed_result != -1) {
+                    printf("Binary Search (on %s): Found at index %d\n", view, indexed_result);
                 } else {
-                    printf("Binary Search (on sorted copy): Not found\n");
+                    printf("Binary Search (on %s): Not found\n", view);
                 }
-                
-                free_dataset(temp);
                 break;
                 
             case 7:
                 printf("Enter filename to load: ");
                 scanf("%s", filename);
-                if (load_from_file(dataset, filename)) {
+                if (load_from_file_stats(dataset, filename, &io_stats)) {
                     printf("Data loaded successfully from %s!\n", filename);
+                    printf("Parsed %d values (%.2f MB) in %.3f s (%.1f MB/s)\n",
+                           io_stats.values, io_stats.bytes / (1024.0 * 1024.0),
+                           io_stats.seconds, io_stats_mb_per_sec(&io_stats));
                     print_dataset(dataset);
                 } else {
                     printf("Failed to load data from %s!\n", filename);
@@ -129,20 +459,108 @@ int main() {
             case 8:
                 printf("Enter filename to save: ");
                 scanf("%s", filename);
-                if (save_to_file(dataset, filename)) {
+                if (save_to_file_stats(dataset, filename, &io_stats)) {
                     printf("Data saved successfully to %s!\n", filename);
+                    printf("Wrote %d values (%.2f MB) in %.3f s (%.1f MB/s)\n",
+                           io_stats.values, io_stats.bytes / (1024.0 * 1024.0),
+                           io_stats.seconds, io_stats_mb_per_sec(&io_stats));
                 } else {
                     printf("Failed to save data to %s!\n", filename);
                 }
                 break;
                 
             case 9:
-                dataset->size = 0;
+                clear_dataset(dataset);
                 printf("Dataset cleared!\n");
                 break;
                 
             case 10:
+                printf("Enter filename to stream ('-' for stdin): ");
+                scanf("%255s", filename);
+                printf("Quantile rank error bound (e.g. 0.01): ");
+                if (scanf("%lf", &epsilon) != 1) epsilon = STREAM_DEFAULT_EPSILON;
+                run_stream_statistics(filename, epsilon);
+                break;
+                
+            case 11:
+                printf("Enter input filename: ");
+                scanf("%255s", filename);
+                printf("Enter output filename: ");
+                scanf("%255s", output_filename);
+                display_sort_operations();
+                scanf("%d", &operation_choice);
+                if (operation_choice < 0 || sort_operations[operation_choice].operation == NULL) {
+                    printf("Invalid sort choice!\n");
+                    break;
+                }
+                printf("Sort order (1=Ascending, 0=Descending): ");
+                scanf("%d", &order);
+                if (external_sort_file(filename, output_filename,
+                                       sort_operations[operation_choice].operation,
+                                       order, STREAM_DEFAULT_CHUNK)) {
+                    printf("Sorted %s into %s using %s runs\n", filename, output_filename,
+                           sort_operations[operation_choice].name);
+                } else {
+                    printf("External sort failed!\n");
+                }
+                break;
+                
+            case 12:
+                run_batch_search(dataset);
+                break;
+                
+            case 13:
+                printf("Element types:\n");
+                for (int t = DTYPE_FLOAT64; t <= DTYPE_FIXED32; t++) {
+                    printf("%d. %s\n", t, dtype_name((DataType)t));
+                }
+                printf("Choose type (current: %s): ", dtype_name(dataset->dtype));
+                scanf("%d", &operation_choice);
+                if (!is_valid_dtype(operation_choice)) {
+                    printf("Invalid element type!\n");
+                } else if (dataset_convert(dataset, (DataType)operation_choice)) {
+                    printf("Dataset now stores %s elements (%zu bytes each)\n",
+                           dtype_name(dataset->dtype), dtype_size(dataset->dtype));
+                } else {
+                    printf("Some values do not fit in %s; dataset unchanged!\n",
+                           dtype_name((DataType)operation_choice));
+                }
+                break;
+                
+            case 14:
+                run_clean_dataset(dataset);
+                break;
+                
+            case 15:
+                display_distribution_operations();
+                scanf("%d", &operation_choice);
+                execute_distribution_operation(dataset, operation_choice);
+                break;
+                
+            case 16:
+                run_rolling_window(dataset, &rolling_window, &rolling_active);
+                break;
+                
+            case 17:
+                printf("Enter filename with one row per line: ");
+                scanf("%255s", filename);
+                printf("Number of columns: ");
+                if (scanf("%d", &index) != 1 || index <= 0) {
+                    printf("Invalid column count!\n");
+                    break;
+                }
+                run_multi_column(filename, index);
+                break;
+                
+            case 18:
+                printf("Enter pipeline (e.g. filter > 0 | map * 2 | reduce stddev):\n");
+                if (scanf(" %511[^\n]", expression) == 1) run_pipeline(dataset, expression);
+                break;
+                
+            case 0:
+                if (rolling_active) rolling_free(&rolling_window);
                 free_dataset(dataset);
+                engine_context_free();
                 printf("Goodbye!\n");
                 return 0;
                 
@@ -1,5 +1,18 @@
 #include "math_engine.h"
+#include "binary_format.h"
+#include "kernels.h"
+#include "rolling.h"
+#include "engine_context.h"
 #include <math.h>
+#include <sys/mman.h>
+#include <limits.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <ctype.h>
+
+// Bytes parsed before the loader extrapolates the final element count
+#define LOAD_SAMPLE_BYTES (64 * 1024)
+#define SAVE_BUFFER_SIZE (1 << 16)
 
 // Function pointer arrays for dynamic dispatch
 MathOperationEntry math_operations[] = {
@@ -15,66 +28,524 @@ MathOperationEntry math_operations[] = {
 SortOperationEntry sort_operations[] = {
     {"Bubble Sort", bubble_sort},
     {"Selection Sort", selection_sort},
+    {"Quick Sort", quick_sort},
+    {"Radix Sort", radix_sort},
     {NULL, NULL}
 };
 
-Dataset* create_dataset(int initial_capacity) {
+// Unsigned keys whose integer order matches the element order
+static inline uint64_t f64_key_asc(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | 0x8000000000000000ULL;
+}
+
+static inline uint64_t f32_key_asc(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 31) ? (uint32_t)~bits : bits | 0x80000000u;
+}
+
+static inline uint64_t i64_key_asc(int64_t value) {
+    return (uint64_t)value ^ 0x8000000000000000ULL;
+}
+
+static inline uint64_t fx32_key_asc(int32_t value) {
+    return (uint32_t)value ^ 0x80000000u;
+}
+
+static inline uint64_t f64_key_desc(double value) { return ~f64_key_asc(value); }
+static inline uint64_t f32_key_desc(float value) { return ~f32_key_asc(value); }
+static inline uint64_t i64_key_desc(int64_t value) { return ~i64_key_asc(value); }
+static inline uint64_t fx32_key_desc(int32_t value) { return ~fx32_key_asc(value); }
+
+// Specialised kernel instances, one set per element type
+DEFINE_SORT_KERNELS(double, f64_asc, KERNEL_ASC)
+DEFINE_SORT_KERNELS(double, f64_desc, KERNEL_DESC)
+DEFINE_RADIX_KERNEL(double, f64_asc, f64_key_asc)
+DEFINE_RADIX_KERNEL(double, f64_desc, f64_key_desc)
+DEFINE_REDUCE_KERNELS(double, double, f64)
+
+DEFINE_SORT_KERNELS(float, f32_asc, KERNEL_ASC)
+DEFINE_SORT_KERNELS(float, f32_desc, KERNEL_DESC)
+DEFINE_RADIX_KERNEL(float, f32_asc, f32_key_asc)
+DEFINE_RADIX_KERNEL(float, f32_desc, f32_key_desc)
+DEFINE_REDUCE_KERNELS(float, double, f32)
+
+DEFINE_SORT_KERNELS(int64_t, i64_asc, KERNEL_ASC)
+DEFINE_SORT_KERNELS(int64_t, i64_desc, KERNEL_DESC)
+DEFINE_RADIX_KERNEL(int64_t, i64_asc, i64_key_asc)
+DEFINE_RADIX_KERNEL(int64_t, i64_desc, i64_key_desc)
+// int64 sums are exact: at most INT_MAX values below 2^63 in magnitude stay
+// below 2^94, so a 128-bit accumulator cannot overflow, and the total is
+// rounded to double once at the end
+__extension__ typedef __int128 i64_accumulator;
+DEFINE_REDUCE_KERNELS(int64_t, i64_accumulator, i64)
+
+DEFINE_SORT_KERNELS(int32_t, fx32_asc, KERNEL_ASC)
+DEFINE_SORT_KERNELS(int32_t, fx32_desc, KERNEL_DESC)
+DEFINE_RADIX_KERNEL(int32_t, fx32_asc, fx32_key_asc)
+DEFINE_RADIX_KERNEL(int32_t, fx32_desc, fx32_key_desc)
+DEFINE_REDUCE_KERNELS(int32_t, int64_t, fx32)
+
+// Calls the ascending or descending instance of KERNEL for the dataset's
+// element type; the remaining arguments follow the data pointer
+#define DISPATCH_SORT(KERNEL, dataset, ascending, ...)                          \
+    switch ((dataset)->dtype) {                                                 \
+    case DTYPE_FLOAT32:                                                         \
+        if (ascending) KERNEL##_f32_asc((float *)(dataset)->values, __VA_ARGS__); \
+        else KERNEL##_f32_desc((float *)(dataset)->values, __VA_ARGS__);       \
+        break;                                                                  \
+    case DTYPE_INT64:                                                           \
+        if (ascending) KERNEL##_i64_asc((int64_t *)(dataset)->values, __VA_ARGS__); \
+        else KERNEL##_i64_desc((int64_t *)(dataset)->values, __VA_ARGS__);     \
+        break;                                                                  \
+    case DTYPE_FIXED32:                                                         \
+        if (ascending) KERNEL##_fx32_asc((int32_t *)(dataset)->values, __VA_ARGS__); \
+        else KERNEL##_fx32_desc((int32_t *)(dataset)->values, __VA_ARGS__);    \
+        break;                                                                  \
+    default:                                                                    \
+        if (ascending) KERNEL##_f64_asc((dataset)->data, __VA_ARGS__);          \
+        else KERNEL##_f64_desc((dataset)->data, __VA_ARGS__);                   \
+        break;                                                                  \
+    }
+
+size_t dtype_size(DataType dtype) {
+    switch (dtype) {
+        case DTYPE_FLOAT32: return sizeof(float);
+        case DTYPE_INT64: return sizeof(int64_t);
+        case DTYPE_FIXED32: return sizeof(int32_t);
+        default: return sizeof(double);
+    }
+}
+
+const char* dtype_name(DataType dtype) {
+    switch (dtype) {
+        case DTYPE_FLOAT32: return "float32";
+        case DTYPE_INT64: return "int64";
+        case DTYPE_FIXED32: return "fixed32";
+        default: return "float64";
+    }
+}
+
+int is_valid_dtype(int dtype) {
+    return dtype >= DTYPE_FLOAT64 && dtype <= DTYPE_FIXED32;
+}
+
+// Multiplier from stored units to logical values
+static double dtype_scale(DataType dtype) {
+    return dtype == DTYPE_FIXED32 ? 1.0 / FIXED_SCALE : 1.0;
+}
+
+static inline double element_at(const void *values, DataType dtype, int index) {
+    switch (dtype) {
+        case DTYPE_FLOAT32: return ((const float *)values)[index];
+        case DTYPE_INT64: return (double)((const int64_t *)values)[index];
+        case DTYPE_FIXED32: return ((const int32_t *)values)[index] / (double)FIXED_SCALE;
+        default: return ((const double *)values)[index];
+    }
+}
+
+// Converts and stores one value; fails if the type cannot represent it
+static int store_element(void *values, DataType dtype, int index, double value) {
+    switch (dtype) {
+        case DTYPE_FLOAT32:
+            ((float *)values)[index] = (float)value;
+            return 1;
+        case DTYPE_INT64:
+            if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0)) return 0;
+            ((int64_t *)values)[index] = (int64_t)llround(value);
+            return 1;
+        case DTYPE_FIXED32: {
+            double scaled = round(value * FIXED_SCALE);
+            if (!(scaled >= INT32_MIN && scaled <= INT32_MAX)) return 0;
+            ((int32_t *)values)[index] = (int32_t)scaled;
+            return 1;
+        }
+        default:
+            ((double *)values)[index] = value;
+            return 1;
+    }
+}
+
+double dataset_get(const Dataset *dataset, int index) {
+    return element_at(dataset->values, dataset->dtype, index);
+}
+
+// Points the dataset at new element storage of the given type
+void dataset_set_storage(Dataset *dataset, void *values, DataType dtype) {
+    dataset->values = values;
+    dataset->dtype = dtype;
+    dataset->data = dtype == DTYPE_FLOAT64 ? (double *)values : NULL;
+}
+
+Dataset* create_typed_dataset(int initial_capacity, DataType dtype) {
     Dataset *dataset = malloc(sizeof(Dataset));
     if (!dataset) return NULL;
     
-    dataset->data = malloc(initial_capacity * sizeof(double));
-    if (!dataset->data) {
+    void *values = malloc(initial_capacity * dtype_size(dtype));
+    if (!values) {
         free(dataset);
         return NULL;
     }
     
+    dataset_set_storage(dataset, values, dtype);
     dataset->size = 0;
     dataset->capacity = initial_capacity;
+    dataset->mapping = NULL;
+    dataset->mapping_size = 0;
+    dataset->block_minmax = NULL;
+    dataset->block_size = 0;
+    dataset->sort_order = SORT_UNKNOWN;
+    dataset->sorted_index = NULL;
+    dataset->index_valid = 0;
+    dataset->rolling = NULL;
+    dataset->version = 0;
+    memset(&dataset->running, 0, sizeof(dataset->running));
+    memset(dataset->results, 0, sizeof(dataset->results));
     return dataset;
 }
 
+Dataset* create_dataset(int initial_capacity) {
+    return create_typed_dataset(initial_capacity, DTYPE_FLOAT64);
+}
+
 void free_dataset(Dataset *dataset) {
     if (dataset) {
-        free(dataset->data);
+        if (dataset->mapping) {
+            munmap(dataset->mapping, dataset->mapping_size);
+        } else {
+            free(dataset->values);
+        }
+        free(dataset->sorted_index);
         free(dataset);
     }
 }
 
+// Copies a file-backed dataset into its own heap buffer before a write
+int dataset_make_writable(Dataset *dataset) {
+    if (!dataset->mapping) return 1;
+    
+    size_t elem_size = dtype_size(dataset->dtype);
+    int capacity = dataset->size > 0 ? dataset->size : 1;
+    void *copy = malloc((size_t)capacity * elem_size);
+    if (!copy) return 0;
+    memcpy(copy, dataset->values, (size_t)dataset->size * elem_size);
+    munmap(dataset->mapping, dataset->mapping_size);
+    
+    dataset_set_storage(dataset, copy, dataset->dtype);
+    dataset->capacity = capacity;
+    dataset->mapping = NULL;
+    dataset->mapping_size = 0;
+    dataset->block_minmax = NULL;
+    dataset->block_size = 0;
+    return 1;
+}
+
+// Re-encodes every element as another type. Fails without changing the
+// dataset if any value does not fit the new type.
+int dataset_convert(Dataset *dataset, DataType dtype) {
+    if (dtype == dataset->dtype) return 1;
+    
+    int capacity = dataset->size > 0 ? dataset->size : 1;
+    void *converted = malloc((size_t)capacity * dtype_size(dtype));
+    if (!converted) return 0;
+    
+    for (int i = 0; i < dataset->size; i++) {
+        if (!store_element(converted, dtype, i, dataset_get(dataset, i))) {
+            free(converted);
+            return 0;
+        }
+    }
+    
+    if (dataset->mapping) {
+        munmap(dataset->mapping, dataset->mapping_size);
+        dataset->mapping = NULL;
+        dataset->mapping_size = 0;
+        dataset->block_minmax = NULL;
+        dataset->block_size = 0;
+    } else {
+        free(dataset->values);
+    }
+    dataset_set_storage(dataset, converted, dtype);
+    dataset->capacity = capacity;
+    // Narrowing can merge neighbouring values but never reorders them
+    dataset->index_valid = 0;
+    dataset->version++;
+    return 1;
+}
+
+// Forgets derived state after the contents were rewritten wholesale
+void dataset_invalidate(Dataset *dataset) {
+    dataset->sort_order = SORT_UNKNOWN;
+    dataset->index_valid = 0;
+    dataset->version++;
+}
+
+// Stores a freshly computed aggregate for the current version
+static void running_record(Dataset *dataset, int bit, double value) {
+    RunningStats *running = &dataset->running;
+    if (running->version != dataset->version) {
+        running->version = dataset->version;
+        running->valid = 0;
+    }
+    running->valid |= bit;
+    if (bit == RUNNING_SUM) {
+        running->sum = value;
+        running->compensation = 0.0;
+    } else if (bit == RUNNING_MIN) {
+        running->min = value;
+    } else {
+        running->max = value;
+    }
+}
+
+static int running_has(const Dataset *dataset, int bit) {
+    return dataset->running.version == dataset->version && (dataset->running.valid & bit);
+}
+
+// Folds an appended value into the aggregates; called before the version
+// bump, and carries them over to the new version if they were current.
+// Non-finite values would poison the compensation, so they drop the sum.
+static void running_append(Dataset *dataset, double value) {
+    RunningStats *running = &dataset->running;
+    if (dataset->size == 0) {
+        running->valid = RUNNING_SUM | RUNNING_MIN | RUNNING_MAX;
+        running->sum = running->compensation = 0.0;
+        running->min = running->max = value;
+    } else if (running->version != dataset->version) {
+        running->valid = 0;
+    }
+    running->version = dataset->version + 1;
+    
+    if (isnan(value)) {
+        running->valid &= ~(RUNNING_MIN | RUNNING_MAX);
+    } else {
+        if (value < running->min) running->min = value;
+        if (value > running->max) running->max = value;
+    }
+    if (!isfinite(value)) {
+        running->valid &= ~RUNNING_SUM;
+    } else {
+        double total = running->sum + value;
+        if (fabs(running->sum) >= fabs(value)) {
+            running->compensation += (running->sum - total) + value;
+        } else {
+            running->compensation += (value - total) + running->sum;
+        }
+        running->sum = total;
+    }
+}
+
+void clear_dataset(Dataset *dataset) {
+    dataset->size = 0;
+    dataset_invalidate(dataset);
+    if (dataset->rolling) rolling_reset(dataset->rolling);
+}
+
 int add_element(Dataset *dataset, double value) {
+    if (!dataset_make_writable(dataset)) return 0;
+    
     if (dataset->size >= dataset->capacity) {
-        dataset->capacity *= 2;
-        double *temp = realloc(dataset->data, dataset->capacity * sizeof(double));
+        int capacity = dataset->capacity > 0 ? dataset->capacity * 2 : 16;
+        void *temp = realloc(dataset->values, (size_t)capacity * dtype_size(dataset->dtype));
         if (!temp) return 0;
-        dataset->data = temp;
+        dataset_set_storage(dataset, temp, dataset->dtype);
+        dataset->capacity = capacity;
     }
     
-    dataset->data[dataset->size++] = value;
+    if (!store_element(dataset->values, dataset->dtype, dataset->size, value)) return 0;
+    double stored = dataset_get(dataset, dataset->size);
+    
+    // Appending in order keeps a known sort order valid
+    if (dataset->size > 0 && dataset->sort_order != SORT_UNKNOWN) {
+        double last = dataset_get(dataset, dataset->size - 1);
+        int in_order = dataset->sort_order == SORT_ASCENDING ? stored >= last : stored <= last;
+        if (!in_order) dataset->sort_order = SORT_UNKNOWN;
+    }
+    dataset->index_valid = 0;
+    running_append(dataset, stored);
+    dataset->version++;
+    
+    dataset->size++;
+    if (dataset->rolling) rolling_push(dataset->rolling, stored);
     return 1;
 }
 
 int remove_element(Dataset *dataset, int index) {
     if (index < 0 || index >= dataset->size) return 0;
+    if (!dataset_make_writable(dataset)) return 0;
     
-    for (int i = index; i < dataset->size - 1; i++) {
-        dataset->data[i] = dataset->data[i + 1];
+    size_t elem_size = dtype_size(dataset->dtype);
+    char *bytes = dataset->values;
+    memmove(bytes + (size_t)index * elem_size, bytes + (size_t)(index + 1) * elem_size,
+            (size_t)(dataset->size - index - 1) * elem_size);
+    dataset->size--;
+    // Removal keeps the remaining elements in order, but shifts positions
+    dataset->index_valid = 0;
+    dataset->version++;
+    return 1;
+}
+
+// O(1) removal that fills the hole with the last element. Element order is
+// not preserved, so a known sort order is dropped unless the last element
+// itself was removed.
+int swap_remove_element(Dataset *dataset, int index) {
+    if (index < 0 || index >= dataset->size) return 0;
+    if (!dataset_make_writable(dataset)) return 0;
+    
+    int last = dataset->size - 1;
+    if (index != last) {
+        size_t elem_size = dtype_size(dataset->dtype);
+        char *bytes = dataset->values;
+        memcpy(bytes + (size_t)index * elem_size, bytes + (size_t)last * elem_size, elem_size);
+        dataset->sort_order = SORT_UNKNOWN;
     }
     dataset->size--;
+    dataset->index_valid = 0;
+    dataset->version++;
+    return 1;
+}
+
+typedef int (*DropTest)(const Dataset *dataset, int index, const void *context);
+
+// Removes every element the test selects in one pass, moving each run of
+// kept elements down once. Relative order is preserved. Returns the number
+// of elements removed.
+static int compact(Dataset *dataset, DropTest drop, const void *context) {
+    size_t elem_size = dtype_size(dataset->dtype);
+    char *bytes = dataset->values;
+    int write = 0, run_start = 0;
+    
+    for (int read = 0; read <= dataset->size; read++) {
+        if (read < dataset->size && !drop(dataset, read, context)) continue;
+        
+        // Element `read` is dropped (or the end is reached): flush the run
+        int run = read - run_start;
+        if (run > 0 && write != run_start) {
+            memmove(bytes + (size_t)write * elem_size, bytes + (size_t)run_start * elem_size,
+                    (size_t)run * elem_size);
+        }
+        write += run;
+        run_start = read + 1;
+    }
+    
+    int removed = dataset->size - write;
+    dataset->size = write;
+    if (removed > 0) {
+        dataset->index_valid = 0;
+        dataset->version++;
+    }
+    return removed;
+}
+
+static int drop_flagged(const Dataset *dataset, int index, const void *context) {
+    (void)dataset;
+    return ((const unsigned char *)context)[index];
+}
+
+// Removes the elements at the given positions; duplicates and out-of-range
+// positions are ignored. Returns the number removed, or -1 on failure.
+int remove_indices(Dataset *dataset, const int *indices, int count) {
+    if (dataset->size == 0 || count <= 0) return 0;
+    if (!dataset_make_writable(dataset)) return -1;
+    
+    size_t mark = scratch_mark();
+    unsigned char *flags = scratch_alloc((size_t)dataset->size);
+    if (!flags) return -1;
+    memset(flags, 0, (size_t)dataset->size);
+    for (int i = 0; i < count; i++) {
+        if (indices[i] >= 0 && indices[i] < dataset->size) flags[indices[i]] = 1;
+    }
+    
+    int removed = compact(dataset, drop_flagged, flags);
+    scratch_release(mark);
+    return removed;
+}
+
+typedef struct {
+    ElementPredicate predicate;
+    const void *context;
+} PredicateTest;
+
+static int drop_matching(const Dataset *dataset, int index, const void *context) {
+    const PredicateTest *test = context;
+    return test->predicate(dataset_get(dataset, index), test->context);
+}
+
+// Removes every element for which predicate(value, context) is true.
+// Returns the number removed, or -1 on failure.
+int remove_if(Dataset *dataset, ElementPredicate predicate, const void *context) {
+    if (!dataset_make_writable(dataset)) return -1;
+    
+    PredicateTest test = {predicate, context};
+    return compact(dataset, drop_matching, &test);
+}
+
+static int is_nan_value(double value, const void *context) {
+    (void)context;
+    return isnan(value);
+}
+
+typedef struct {
+    double mean;
+    double limit;
+} OutlierBounds;
+
+static int is_outlier(double value, const void *context) {
+    const OutlierBounds *bounds = context;
+    return fabs(value - bounds->mean) > bounds->limit;
+}
+
+int remove_nan(Dataset *dataset) {
+    // Only floating-point types can hold NaN
+    if (dataset->dtype != DTYPE_FLOAT64 && dataset->dtype != DTYPE_FLOAT32) return 0;
+    return remove_if(dataset, is_nan_value, NULL);
+}
+
+// Drops elements more than k standard deviations from the mean
+int remove_outliers(Dataset *dataset, double k) {
+    if (dataset->size <= 1) return 0;
+    
+    OutlierBounds bounds = {compute_average(dataset), k * compute_std_deviation(dataset)};
+    return remove_if(dataset, is_outlier, &bounds);
+}
+
+int dataset_reserve(Dataset *dataset, int capacity) {
+    if (!dataset_make_writable(dataset)) return 0;
+    if (capacity <= dataset->capacity) return 1;
+    
+    void *temp = realloc(dataset->values, (size_t)capacity * dtype_size(dataset->dtype));
+    if (!temp) return 0;
+    dataset_set_storage(dataset, temp, dataset->dtype);
+    dataset->capacity = capacity;
     return 1;
 }
 
 void print_dataset(Dataset *dataset) {
-    printf("Dataset [%d elements]: ", dataset->size);
+    printf("Dataset [%d elements, %s]: ", dataset->size, dtype_name(dataset->dtype));
     for (int i = 0; i < dataset->size; i++) {
-        printf("%.2f ", dataset->data[i]);
+        printf("%.2f ", dataset_get(dataset, i));
     }
     printf("\n");
 }
 
+// Sum in stored units (1/FIXED_SCALE steps for fixed-point)
+static double raw_sum(Dataset *dataset) {
+    switch (dataset->dtype) {
+        case DTYPE_FLOAT32: return sum_f32(dataset->values, dataset->size);
+        case DTYPE_INT64: return sum_i64(dataset->values, dataset->size);
+        case DTYPE_FIXED32: return (double)sum_fx32(dataset->values, dataset->size);
+        default: return sum_f64(dataset->data, dataset->size);
+    }
+}
+
 double compute_sum(Dataset *dataset) {
-    double sum = 0.0;
-    for (int i = 0; i < dataset->size; i++) {
-        sum += dataset->data[i];
+    if (running_has(dataset, RUNNING_SUM)) {
+        return dataset->running.sum + dataset->running.compensation;
     }
+    double sum = raw_sum(dataset) * dtype_scale(dataset->dtype);
+    running_record(dataset, RUNNING_SUM, sum);
     return sum;
 }
 
@@ -83,111 +554,214 @@ double compute_average(Dataset *dataset) {
     return compute_sum(dataset) / dataset->size;
 }
 
+static double scan_maximum(Dataset *dataset) {
+    // Mapped binary files carry per-block extremes in their footer
+    if (dataset->block_minmax) {
+        int blocks = (dataset->size + dataset->block_size - 1) / dataset->block_size;
+        double max = dataset->block_minmax[1];
+        for (int b = 1; b < blocks; b++) {
+            if (dataset->block_minmax[2 * b + 1] > max) {
+                max = dataset->block_minmax[2 * b + 1];
+            }
+        }
+        return max;
+    }
+    
+    switch (dataset->dtype) {
+        case DTYPE_FLOAT32: return max_f32(dataset->values, dataset->size);
+        case DTYPE_INT64: return (double)max_i64(dataset->values, dataset->size);
+        case DTYPE_FIXED32: return max_fx32(dataset->values, dataset->size) / (double)FIXED_SCALE;
+        default: return max_f64(dataset->data, dataset->size);
+    }
+}
+
 double find_maximum(Dataset *dataset) {
     if (dataset->size == 0) return 0.0;
+    if (running_has(dataset, RUNNING_MAX)) return dataset->running.max;
     
-    double max = dataset->data[0];
-    for (int i = 1; i < dataset->size; i++) {
-        if (dataset->data[i] > max) {
-            max = dataset->data[i];
+    double max = scan_maximum(dataset);
+    if (!isnan(max)) running_record(dataset, RUNNING_MAX, max);
+    return max;
+}
+
+static double scan_minimum(Dataset *dataset) {
+    if (dataset->block_minmax) {
+        int blocks = (dataset->size + dataset->block_size - 1) / dataset->block_size;
+        double min = dataset->block_minmax[0];
+        for (int b = 1; b < blocks; b++) {
+            if (dataset->block_minmax[2 * b] < min) {
+                min = dataset->block_minmax[2 * b];
+            }
         }
+        return min;
+    }
+    
+    switch (dataset->dtype) {
+        case DTYPE_FLOAT32: return min_f32(dataset->values, dataset->size);
+        case DTYPE_INT64: return (double)min_i64(dataset->values, dataset->size);
+        case DTYPE_FIXED32: return min_fx32(dataset->values, dataset->size) / (double)FIXED_SCALE;
+        default: return min_f64(dataset->data, dataset->size);
     }
-    return max;
 }
 
 double find_minimum(Dataset *dataset) {
     if (dataset->size == 0) return 0.0;
+    if (running_has(dataset, RUNNING_MIN)) return dataset->running.min;
     
-    double min = dataset->data[0];
-    for (int i = 1; i < dataset->size; i++) {
-        if (dataset->data[i] < min) {
-            min = dataset->data[i];
-        }
-    }
+    double min = scan_minimum(dataset);
+    if (!isnan(min)) running_record(dataset, RUNNING_MIN, min);
     return min;
 }
 
 double compute_median(Dataset *dataset) {
     if (dataset->size == 0) return 0.0;
     
-    // Create a copy for sorting
-    Dataset *temp = create_dataset(dataset->size);
-    for (int i = 0; i < dataset->size; i++) {
-        add_element(temp, dataset->data[i]);
+    // Sorted either way, the middle elements are already in place
+    if (dataset->sort_order != SORT_UNKNOWN) {
+        int mid = dataset->size / 2;
+        if (dataset->size % 2 == 0) {
+            return (dataset_get(dataset, mid - 1) + dataset_get(dataset, mid)) / 2.0;
+        }
+        return dataset_get(dataset, mid);
     }
     
-    bubble_sort(temp, 1); // Sort ascending
+    // Sort a copy held in the engine's scratch arena
+    size_t mark = scratch_mark();
+    size_t bytes = (size_t)dataset->size * dtype_size(dataset->dtype);
+    void *copy = scratch_alloc(bytes);
+    if (!copy) return 0.0;
+    memcpy(copy, dataset->values, bytes);
+    
+    Dataset temp;
+    memset(&temp, 0, sizeof(temp));
+    dataset_set_storage(&temp, copy, dataset->dtype);
+    temp.size = temp.capacity = dataset->size;
+    quick_sort(&temp, 1); // Sort ascending
     
     double median;
-    if (temp->size % 2 == 0) {
-        median = (temp->data[temp->size/2 - 1] + temp->data[temp->size/2]) / 2.0;
+    if (temp.size % 2 == 0) {
+        median = (dataset_get(&temp, temp.size/2 - 1) + dataset_get(&temp, temp.size/2)) / 2.0;
     } else {
-        median = temp->data[temp->size/2];
+        median = dataset_get(&temp, temp.size/2);
     }
     
-    free_dataset(temp);
+    scratch_release(mark);
     return median;
 }
 
 double compute_std_deviation(Dataset *dataset) {
     if (dataset->size <= 1) return 0.0;
     
-    double mean = compute_average(dataset);
-    double sum_squared_diff = 0.0;
-    
-    for (int i = 0; i < dataset->size; i++) {
-        double diff = dataset->data[i] - mean;
-        sum_squared_diff += diff * diff;
+    // Work in stored units and scale the result once
+    double mean = raw_sum(dataset) / dataset->size;
+    double sum_squared_diff;
+    switch (dataset->dtype) {
+        case DTYPE_FLOAT32:
+            sum_squared_diff = sum_squared_diff_f32(dataset->values, dataset->size, mean);
+            break;
+        case DTYPE_INT64:
+            sum_squared_diff = sum_squared_diff_i64(dataset->values, dataset->size, mean);
+            break;
+        case DTYPE_FIXED32:
+            sum_squared_diff = sum_squared_diff_fx32(dataset->values, dataset->size, mean);
+            break;
+        default:
+            sum_squared_diff = sum_squared_diff_f64(dataset->data, dataset->size, mean);
+            break;
     }
     
-    return sqrt(sum_squared_diff / (dataset->size - 1));
+    return sqrt(sum_squared_diff / (dataset->size - 1)) * dtype_scale(dataset->dtype);
 }
 
-void bubble_sort(Dataset *dataset, int ascending) {
-    for (int i = 0; i < dataset->size - 1; i++) {
-        for (int j = 0; j < dataset->size - i - 1; j++) {
-            int should_swap = ascending ? 
-                (dataset->data[j] > dataset->data[j + 1]) :
-                (dataset->data[j] < dataset->data[j + 1]);
-            
-            if (should_swap) {
-                double temp = dataset->data[j];
-                dataset->data[j] = dataset->data[j + 1];
-                dataset->data[j + 1] = temp;
-            }
+static int contains_nan(const Dataset *dataset) {
+    if (dataset->dtype == DTYPE_FLOAT32) {
+        const float *values = dataset->values;
+        for (int i = 0; i < dataset->size; i++) {
+            if (isnan(values[i])) return 1;
+        }
+    } else if (dataset->dtype == DTYPE_FLOAT64) {
+        for (int i = 0; i < dataset->size; i++) {
+            if (isnan(dataset->data[i])) return 1;
         }
     }
+    return 0;
+}
+
+// Sorting permutes the data, so the running aggregates stay valid. NaNs
+// compare false both ways and leave the kernels' output unordered, so
+// such data stays SORT_UNKNOWN and searches go through the index.
+static void mark_sorted(Dataset *dataset, int ascending) {
+    int running_current = dataset->running.version == dataset->version;
+    dataset->sort_order = contains_nan(dataset) ? SORT_UNKNOWN :
+                          ascending ? SORT_ASCENDING : SORT_DESCENDING;
+    dataset->index_valid = 0;
+    dataset->version++;
+    if (running_current) dataset->running.version = dataset->version;
+}
+
+// Each sort resolves the element type and direction once and runs the
+// matching kernel
+void bubble_sort(Dataset *dataset, int ascending) {
+    if (!dataset_make_writable(dataset)) return;
+    
+    DISPATCH_SORT(bubble_sort, dataset, ascending, dataset->size)
+    mark_sorted(dataset, ascending);
 }
 
 void selection_sort(Dataset *dataset, int ascending) {
-    for (int i = 0; i < dataset->size - 1; i++) {
-        int target_idx = i;
-        
-        for (int j = i + 1; j < dataset->size; j++) {
-            int should_select = ascending ?
-                (dataset->data[j] < dataset->data[target_idx]) :
-                (dataset->data[j] > dataset->data[target_idx]);
-            
-            if (should_select) {
-                target_idx = j;
-            }
-        }
-        
-        if (target_idx != i) {
-            double temp = dataset->data[i];
-            dataset->data[i] = dataset->data[target_idx];
-            dataset->data[target_idx] = temp;
-        }
+    if (!dataset_make_writable(dataset)) return;
+    
+    DISPATCH_SORT(selection_sort, dataset, ascending, dataset->size)
+    mark_sorted(dataset, ascending);
+}
+
+void quick_sort(Dataset *dataset, int ascending) {
+    if (!dataset_make_writable(dataset)) return;
+    
+    DISPATCH_SORT(quick_sort, dataset, ascending, 0, dataset->size - 1)
+    mark_sorted(dataset, ascending);
+}
+
+void radix_sort(Dataset *dataset, int ascending) {
+    if (!dataset_make_writable(dataset)) return;
+    
+    if (dataset->size > 1) {
+        size_t mark = scratch_mark();
+        void *scratch = scratch_alloc((size_t)dataset->size * dtype_size(dataset->dtype));
+        if (!scratch) return;
+        DISPATCH_SORT(radix_sort, dataset, ascending, scratch, dataset->size)
+        scratch_release(mark);
+    }
+    mark_sorted(dataset, ascending);
+}
+
+// Typed scan of [start, end) for a value within 0.001
+static int find_in_range(Dataset *dataset, int start, int end, double value) {
+    double scale = dtype_scale(dataset->dtype);
+    switch (dataset->dtype) {
+        case DTYPE_FLOAT32: return linear_find_f32(dataset->values, start, end, value, scale);
+        case DTYPE_INT64: return linear_find_i64(dataset->values, start, end, value, scale);
+        case DTYPE_FIXED32: return linear_find_fx32(dataset->values, start, end, value, scale);
+        default: return linear_find_f64(dataset->data, start, end, value, scale);
     }
 }
 
 int linear_search(Dataset *dataset, double value) {
-    for (int i = 0; i < dataset->size; i++) {
-        if (fabs(dataset->data[i] - value) < 0.001) {
-            return i;
+    // Skip whole blocks whose footer range cannot contain the value
+    if (dataset->block_minmax) {
+        for (int start = 0; start < dataset->size; start += dataset->block_size) {
+            const double *range = &dataset->block_minmax[2 * (start / dataset->block_size)];
+            if (value < range[0] - 0.001 || value > range[1] + 0.001) continue;
+            
+            int end = start + dataset->block_size;
+            if (end > dataset->size) end = dataset->size;
+            int found = find_in_range(dataset, start, end, value);
+            if (found != -1) return found;
         }
+        return -1;
     }
-    return -1;
+    
+    return find_in_range(dataset, 0, dataset->size, value);
 }
 
 int binary_search(Dataset *dataset, double value) {
@@ -195,12 +769,13 @@ int binary_search(Dataset *dataset, double value) {
     
     while (left <= right) {
         int mid = left + (right - left) / 2;
+        double current = dataset_get(dataset, mid);
         
-        if (fabs(dataset->data[mid] - value) < 0.001) {
+        if (fabs(current - value) < 0.001) {
             return mid;
         }
         
-        if (dataset->data[mid] < value) {
+        if (current < value) {
             left = mid + 1;
         } else {
             right = mid - 1;
@@ -209,36 +784,364 @@ int binary_search(Dataset *dataset, double value) {
     return -1;
 }
 
+// Total order with NaN last, so NaNs cannot break the index invariants
+static int value_less(double a, double b) {
+    return a < b || (!isnan(a) && isnan(b));
+}
+
+// Bottom-up merge sort of positions by value; stable and O(n log n)
+static int sort_positions(int *positions, int count, const void *values, DataType dtype) {
+    size_t mark = scratch_mark();
+    int *scratch = scratch_alloc((size_t)count * sizeof(int));
+    if (!scratch) return 0;
+    
+    int *src = positions, *dst = scratch;
+    for (int width = 1; width < count; width *= 2) {
+        for (int lo = 0; lo < count; lo += 2 * width) {
+            int mid = lo + width < count ? lo + width : count;
+            int hi = lo + 2 * width < count ? lo + 2 * width : count;
+            int i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                int take_right = value_less(element_at(values, dtype, src[j]),
+                                            element_at(values, dtype, src[i]));
+                dst[k++] = take_right ? src[j++] : src[i++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        int *temp = src;
+        src = dst;
+        dst = temp;
+    }
+    
+    if (src != positions) memcpy(positions, src, (size_t)count * sizeof(int));
+    scratch_release(mark);
+    return 1;
+}
+
+static int ensure_sorted_index(Dataset *dataset) {
+    if (dataset->index_valid) return 1;
+    
+    int *index = realloc(dataset->sorted_index, (size_t)(dataset->size > 0 ? dataset->size : 1) * sizeof(int));
+    if (!index) return 0;
+    dataset->sorted_index = index;
+    
+    for (int i = 0; i < dataset->size; i++) index[i] = i;
+    if (!sort_positions(index, dataset->size, dataset->values, dataset->dtype)) return 0;
+    
+    dataset->index_valid = 1;
+    return 1;
+}
+
+// Position in the original data of the k-th smallest element
+static int sorted_position(Dataset *dataset, int k) {
+    if (dataset->sort_order == SORT_ASCENDING) return k;
+    if (dataset->sort_order == SORT_DESCENDING) return dataset->size - 1 - k;
+    return dataset->sorted_index[k];
+}
+
+// Prepares an ascending view: the data itself if sorted, else the index
+static int prepare_sorted_view(Dataset *dataset) {
+    return dataset->sort_order != SORT_UNKNOWN || ensure_sorted_index(dataset);
+}
+
+// First rank whose value is not below value - 0.001
+static int lower_bound_rank(Dataset *dataset, double value) {
+    int left = 0, right = dataset->size;
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (dataset_get(dataset, sorted_position(dataset, mid)) - value <= -0.001) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+    return left;
+}
+
+// O(log n) search on any dataset: uses the known sort order directly, or a
+// sorted index that is built on first use and reused until the data changes
+int indexed_search(Dataset *dataset, double value) {
+    if (dataset->size == 0 || !prepare_sorted_view(dataset)) return -1;
+    
+    int rank = lower_bound_rank(dataset, value);
+    if (rank < dataset->size) {
+        int pos = sorted_position(dataset, rank);
+        if (fabs(dataset_get(dataset, pos) - value) < 0.001) return pos;
+    }
+    return -1;
+}
+
+// Answers many queries in one merge-like pass: queries are ordered once and
+// walked alongside the sorted view, so the cost is O(n + q log q).
+// results[i] receives the position of queries[i] or -1.
+int batch_search(Dataset *dataset, const double *queries, int count, int *results) {
+    if (count <= 0) return 1;
+    if (dataset->size > 0 && !prepare_sorted_view(dataset)) return 0;
+    
+    size_t mark = scratch_mark();
+    int *order = scratch_alloc((size_t)count * sizeof(int));
+    if (!order) return 0;
+    for (int i = 0; i < count; i++) order[i] = i;
+    if (!sort_positions(order, count, queries, DTYPE_FLOAT64)) {
+        scratch_release(mark);
+        return 0;
+    }
+    
+    int rank = 0;
+    for (int i = 0; i < count; i++) {
+        double value = queries[order[i]];
+        while (rank < dataset->size &&
+               dataset_get(dataset, sorted_position(dataset, rank)) - value <= -0.001) {
+            rank++;
+        }
+        
+        results[order[i]] = -1;
+        if (rank < dataset->size) {
+            int pos = sorted_position(dataset, rank);
+            if (fabs(dataset_get(dataset, pos) - value) < 0.001) results[order[i]] = pos;
+        }
+    }
+    
+    scratch_release(mark);
+    return 1;
+}
+
+// Fills ranks[i] with the 1-based rank of element i; tied values share the
+// average of their ranks. Reuses the sorted view that searches use.
+int compute_ranks(Dataset *dataset, double *ranks) {
+    if (dataset->size == 0) return 1;
+    if (!prepare_sorted_view(dataset)) return 0;
+    
+    int start = 0;
+    while (start < dataset->size) {
+        double value = dataset_get(dataset, sorted_position(dataset, start));
+        int end = start + 1;
+        while (end < dataset->size &&
+               dataset_get(dataset, sorted_position(dataset, end)) == value) {
+            end++;
+        }
+        
+        double rank = (start + 1 + end) / 2.0;
+        for (int k = start; k < end; k++) ranks[sorted_position(dataset, k)] = rank;
+        start = end;
+    }
+    return 1;
+}
+
 int load_from_file(Dataset *dataset, const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) return 0;
+    return load_from_file_stats(dataset, filename, NULL);
+}
+
+int save_to_file(Dataset *dataset, const char *filename) {
+    return save_to_file_stats(dataset, filename, NULL);
+}
+
+// Pre-sizes the dataset from the density of numbers in the parsed prefix
+static int reserve_from_sample(Dataset *dataset, size_t sample_bytes, size_t total_bytes) {
+    if (dataset->size == 0 || sample_bytes == 0) return 1;
+    
+    double estimate = (double)dataset->size / sample_bytes * total_bytes * 1.05 + 16;
+    if (estimate > INT_MAX) estimate = INT_MAX;
+    return dataset_reserve(dataset, (int)estimate);
+}
+
+// Parses the next number into slot `index` in the dataset's element type.
+// int64 tokens are read as integers so values past 2^53 stay exact.
+static int parse_element(Dataset *dataset, const char **cursor, const char *end, int index, int *ok) {
+    *ok = 1;
+    if (dataset->dtype == DTYPE_FLOAT64) {
+        return parse_double(cursor, end, &dataset->data[index]);
+    }
+    if (dataset->dtype == DTYPE_INT64) {
+        return parse_int64(cursor, end, &((int64_t *)dataset->values)[index]);
+    }
     
-    dataset->size = 0; // Reset dataset
     double value;
+    if (!parse_double(cursor, end, &value)) return 0;
+    *ok = store_element(dataset->values, dataset->dtype, index, value);
+    return 1;
+}
+
+int load_from_file_stats(Dataset *dataset, const char *filename, IoStats *stats) {
+    double start_time = monotonic_seconds();
+    FileView view = {0};
+    if (!open_file_view(&view, filename)) return 0;
+    
+    if (is_binary_data(view.data, view.size)) {
+        size_t bytes = view.size;
+        int ok = load_binary_view(dataset, &view);
+        close_file_view(&view);
+        dataset->version++;
+        if (ok && dataset->rolling) rolling_rebuild(dataset->rolling, dataset);
+        if (ok && stats) {
+            stats->bytes = bytes;
+            stats->values = dataset->size;
+            stats->seconds = monotonic_seconds() - start_time;
+        }
+        return ok;
+    }
+    
+    clear_dataset(dataset);
+    if (!dataset_make_writable(dataset)) {
+        close_file_view(&view);
+        return 0;
+    }
+    const char *cursor = view.data;
+    const char *end = view.data + view.size;
+    const char *sample_end = view.size > LOAD_SAMPLE_BYTES ? cursor + LOAD_SAMPLE_BYTES : end;
+    int sampled = 0;
+    int stored = 1;
     
-    while (fscanf(file, "%lf", &value) == 1) {
-        if (!add_element(dataset, value)) {
-            fclose(file);
+    while (1) {
+        if (dataset->size >= dataset->capacity) {
+            if (!sampled && cursor >= sample_end) {
+                sampled = 1;
+                if (!reserve_from_sample(dataset, cursor - view.data, view.size)) {
+                    close_file_view(&view);
+                    return 0;
+                }
+            }
+            if (dataset->size >= dataset->capacity &&
+                !dataset_reserve(dataset, dataset->capacity > 0 ? dataset->capacity * 2 : 16)) {
+                close_file_view(&view);
+                return 0;
+            }
+        }
+        if (!parse_element(dataset, &cursor, end, dataset->size, &stored)) break;
+        if (!stored) {
+            close_file_view(&view);
             return 0;
         }
+        dataset->size++;
     }
     
-    fclose(file);
+    // Bulk-loaded values bypass add_element, so bump the version and replay
+    // them into the window
+    dataset->version++;
+    if (dataset->rolling) rolling_rebuild(dataset->rolling, dataset);
+    
+    if (stats) {
+        stats->bytes = view.size;
+        stats->values = dataset->size;
+        stats->seconds = monotonic_seconds() - start_time;
+    }
+    close_file_view(&view);
     return 1;
 }
 
-int save_to_file(Dataset *dataset, const char *filename) {
+// Formats element `index` for text output; int64 is written exactly
+static int format_element(Dataset *dataset, int index, char *buf) {
+    if (dataset->dtype == DTYPE_INT64) {
+        return snprintf(buf, FORMAT_DOUBLE_MAX, "%" PRId64, ((int64_t *)dataset->values)[index]);
+    }
+    return format_double(dataset_get(dataset, index), buf);
+}
+
+int save_to_file_stats(Dataset *dataset, const char *filename, IoStats *stats) {
+    if (has_binary_extension(filename)) {
+        return save_binary_file(dataset, filename, BINARY_DEFAULT_BLOCK, stats);
+    }
+    
+    double start_time = monotonic_seconds();
     FILE *file = fopen(filename, "w");
     if (!file) return 0;
     
-    for (int i = 0; i < dataset->size; i++) {
-        fprintf(file, "%.6f\n", dataset->data[i]);
+    size_t mark = scratch_mark();
+    char *buffer = scratch_alloc(SAVE_BUFFER_SIZE);
+    if (!buffer) {
+        fclose(file);
+        return 0;
+    }
+    
+    size_t used = 0, written = 0;
+    int ok = 1;
+    for (int i = 0; i < dataset->size && ok; i++) {
+        if (used > SAVE_BUFFER_SIZE - FORMAT_DOUBLE_MAX - 1) {
+            ok = fwrite(buffer, 1, used, file) == used;
+            written += used;
+            used = 0;
+        }
+        used += format_element(dataset, i, buffer + used);
+        buffer[used++] = '\n';
+    }
+    if (ok && used > 0) {
+        ok = fwrite(buffer, 1, used, file) == used;
+        written += used;
     }
     
-    fclose(file);
+    scratch_release(mark);
+    if (fclose(file) != 0) ok = 0;
+    
+    if (stats) {
+        stats->bytes = written;
+        stats->values = dataset->size;
+        stats->seconds = monotonic_seconds() - start_time;
+    }
+    return ok;
+}
+
+// Short names accepted next to the table names
+static const struct {
+    const char *alias;
+    MathOperation operation;
+} math_aliases[] = {
+    {"mean", compute_average},
+    {"avg", compute_average},
+    {"max", find_maximum},
+    {"min", find_minimum},
+    {"stddev", compute_std_deviation},
+    {"std", compute_std_deviation},
+    {NULL, NULL}
+};
+
+// Compares ignoring case, spaces, '-' and '_'
+static int names_match(const char *a, const char *b) {
+    while (*a || *b) {
+        if (*a == ' ' || *a == '-' || *a == '_') {
+            a++;
+        } else if (*b == ' ' || *b == '-' || *b == '_') {
+            b++;
+        } else {
+            if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return 0;
+            a++;
+            b++;
+        }
+    }
     return 1;
 }
 
+// Index in math_operations[] of an operation given by table name
+// ("Standard Deviation", "standard-deviation") or alias ("stddev"), or -1
+int find_math_operation(const char *name) {
+    MathOperation wanted = NULL;
+    for (int i = 0; math_aliases[i].alias != NULL; i++) {
+        if (names_match(name, math_aliases[i].alias)) wanted = math_aliases[i].operation;
+    }
+    
+    for (int i = 0; math_operations[i].operation != NULL; i++) {
+        if (math_operations[i].operation == wanted || names_match(name, math_operations[i].name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Index in sort_operations[] by table name, with or without the trailing
+// "sort" ("Radix Sort", "radix"), or -1
+int find_sort_operation(const char *name) {
+    char with_suffix[64];
+    snprintf(with_suffix, sizeof(with_suffix), "%s sort", name);
+    
+    for (int i = 0; sort_operations[i].operation != NULL; i++) {
+        if (names_match(name, sort_operations[i].name) ||
+            names_match(with_suffix, sort_operations[i].name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 void execute_math_operation(Dataset *dataset, int choice) {
     if (choice < 0 || math_operations[choice].operation == NULL) {
         printf("Invalid operation choice!\n");
@@ -250,10 +1153,26 @@ void execute_math_operation(Dataset *dataset, int choice) {
         return;
     }
     
-    double result = math_operations[choice].operation(dataset);
+    double result = run_math_operation(dataset, choice);
     printf("%s: %.6f\n", math_operations[choice].name, result);
 }
 
+// Runs a math_operations[] entry, reusing its result while the dataset
+// version is unchanged
+double run_math_operation(Dataset *dataset, int index) {
+    MathOperation operation = math_operations[index].operation;
+    if (index >= RESULT_CACHE_SIZE) return operation(dataset);
+    
+    CachedResult *cached = &dataset->results[index];
+    if (cached->valid && cached->version == dataset->version) return cached->value;
+    
+    double value = operation(dataset);
+    cached->valid = 1;
+    cached->version = dataset->version;
+    cached->value = value;
+    return value;
+}
+
 void execute_sort_operation(Dataset *dataset, int choice) {
     if (choice < 0 || sort_operations[choice].operation == NULL) {
         printf("Invalid sort choice!\n");
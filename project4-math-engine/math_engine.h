@@ -4,25 +4,100 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "numeric_io.h"
 
+// Known ordering of a dataset's elements
+#define SORT_UNKNOWN 0
+#define SORT_ASCENDING 1
+#define SORT_DESCENDING -1
+
+// Element types a dataset can store. The values double as the dtype codes
+// of the binary file format.
+typedef enum {
+    DTYPE_FLOAT64 = 1,
+    DTYPE_FLOAT32 = 2,
+    DTYPE_INT64 = 3,
+    DTYPE_FIXED32 = 4    // int32 counting 1/FIXED_SCALE units
+} DataType;
+
+#define FIXED_SCALE 1000
+
+struct RollingWindow;
+
+// Results of the first RESULT_CACHE_SIZE math_operations[] entries are
+// remembered per dataset version
+#define RESULT_CACHE_SIZE 8
+
+#define RUNNING_SUM 1
+#define RUNNING_MIN 2
+#define RUNNING_MAX 4
+
+// Aggregates kept current across appends, valid for one dataset version
 typedef struct {
-    double *data;
+    unsigned long version;
+    int valid;                  // RUNNING_* bits
+    double sum;
+    double compensation;        // Neumaier correction for sum
+    double min;
+    double max;
+} RunningStats;
+
+typedef struct {
+    int valid;
+    unsigned long version;
+    double value;
+} CachedResult;
+
+typedef struct {
+    double *data;               // Same storage as values for DTYPE_FLOAT64, else NULL
+    void *values;               // Element storage of type dtype
+    DataType dtype;
     int size;
     int capacity;
+    void *mapping;              // Read-only file mapping behind data, or NULL
+    size_t mapping_size;
+    const double *block_minmax; // Per-block min/max pairs of a mapped file
+    int block_size;
+    int sort_order;             // SORT_ASCENDING/SORT_DESCENDING once known
+    int *sorted_index;          // Cached permutation ordering data ascending
+    int index_valid;
+    struct RollingWindow *rolling; // Fed by add_element when attached
+    unsigned long version;      // Bumped whenever the contents change
+    RunningStats running;
+    CachedResult results[RESULT_CACHE_SIZE]; // Indexed like math_operations[]
 } Dataset;
 
 // Function pointer type for operations
 typedef double (*MathOperation)(Dataset *dataset);
+typedef int (*ElementPredicate)(double value, const void *context);
 typedef void (*SortOperation)(Dataset *dataset, int ascending);
 typedef int (*SearchOperation)(Dataset *dataset, double value);
 
 // Dataset management
 Dataset* create_dataset(int initial_capacity);
+Dataset* create_typed_dataset(int initial_capacity, DataType dtype);
 void free_dataset(Dataset *dataset);
 int add_element(Dataset *dataset, double value);
 int remove_element(Dataset *dataset, int index);
+int swap_remove_element(Dataset *dataset, int index);
+int remove_indices(Dataset *dataset, const int *indices, int count);
+int remove_if(Dataset *dataset, ElementPredicate predicate, const void *context);
+int remove_nan(Dataset *dataset);
+int remove_outliers(Dataset *dataset, double k);
+int dataset_reserve(Dataset *dataset, int capacity);
+int dataset_make_writable(Dataset *dataset);
+void dataset_invalidate(Dataset *dataset);
+void clear_dataset(Dataset *dataset);
 void print_dataset(Dataset *dataset);
 
+// Element types
+size_t dtype_size(DataType dtype);
+const char* dtype_name(DataType dtype);
+int is_valid_dtype(int dtype);
+double dataset_get(const Dataset *dataset, int index);
+void dataset_set_storage(Dataset *dataset, void *values, DataType dtype);
+int dataset_convert(Dataset *dataset, DataType dtype);
+
 // Mathematical operations
 double compute_sum(Dataset *dataset);
 double compute_average(Dataset *dataset);
@@ -34,14 +109,21 @@ double compute_std_deviation(Dataset *dataset);
 // Sorting operations
 void bubble_sort(Dataset *dataset, int ascending);
 void selection_sort(Dataset *dataset, int ascending);
+void quick_sort(Dataset *dataset, int ascending);
+void radix_sort(Dataset *dataset, int ascending);
 
 // Search operations
 int linear_search(Dataset *dataset, double value);
 int binary_search(Dataset *dataset, double value);
+int indexed_search(Dataset *dataset, double value);
+int batch_search(Dataset *dataset, const double *queries, int count, int *results);
+int compute_ranks(Dataset *dataset, double *ranks);
 
 // File operations
 int load_from_file(Dataset *dataset, const char *filename);
 int save_to_file(Dataset *dataset, const char *filename);
+int load_from_file_stats(Dataset *dataset, const char *filename, IoStats *stats);
+int save_to_file_stats(Dataset *dataset, const char *filename, IoStats *stats);
 
 // Operation dispatcher
 typedef struct {
@@ -62,6 +144,9 @@ extern SortOperationEntry sort_operations[];
 void display_menu();
 int get_operation_choice(const char *type);
 void execute_math_operation(Dataset *dataset, int choice);
+double run_math_operation(Dataset *dataset, int index);
+int find_math_operation(const char *name);
+int find_sort_operation(const char *name);
 void execute_sort_operation(Dataset *dataset, int choice);
 
 #endif
\ No newline at end of file
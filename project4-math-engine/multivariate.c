@@ -0,0 +1,410 @@
+#include "multivariate.h"
+#include "engine_context.h"
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Values per centered row block; sized to stay resident in L1/L2
+#define COVARIANCE_BLOCK_VALUES 4096
+
+// ---------------------------------------------------------------------------
+// Tables
+// ---------------------------------------------------------------------------
+
+int table_init(Table *table, int column_count) {
+    table->columns = calloc((size_t)column_count, sizeof(Dataset *));
+    table->column_count = 0;
+    if (!table->columns) return 0;
+
+    for (int c = 0; c < column_count; c++) {
+        table->columns[c] = create_dataset(16);
+        if (!table->columns[c]) {
+            table_free(table);
+            return 0;
+        }
+        table->column_count++;
+    }
+    return 1;
+}
+
+void table_free(Table *table) {
+    for (int c = 0; c < table->column_count; c++) free_dataset(table->columns[c]);
+    free(table->columns);
+    table->columns = NULL;
+    table->column_count = 0;
+}
+
+int table_rows(const Table *table) {
+    return table->column_count > 0 ? table->columns[0]->size : 0;
+}
+
+// Reads a whitespace-separated text file holding `column_count` values per
+// row. A trailing partial row is dropped so every column has equal length.
+int load_table(Table *table, const char *filename, int column_count) {
+    if (column_count <= 0) return 0;
+
+    FileView view = {0};
+    if (!open_file_view(&view, filename)) return 0;
+    if (!table_init(table, column_count)) {
+        close_file_view(&view);
+        return 0;
+    }
+
+    const char *cursor = view.data;
+    const char *end = view.data + view.size;
+    double value;
+    int column = 0;
+    while (parse_double(&cursor, end, &value)) {
+        if (!add_element(table->columns[column], value)) {
+            close_file_view(&view);
+            table_free(table);
+            return 0;
+        }
+        column = (column + 1) % column_count;
+    }
+    close_file_view(&view);
+
+    int rows = table->columns[column_count - 1]->size;
+    for (int c = 0; c < column_count; c++) {
+        if (table->columns[c]->size == rows) continue;
+        table->columns[c]->size = rows;
+        dataset_invalidate(table->columns[c]);
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Paired statistics
+// ---------------------------------------------------------------------------
+
+void pair_moments_init(PairMoments *moments) {
+    memset(moments, 0, sizeof(*moments));
+}
+
+void pair_moments_add(PairMoments *moments, double x, double y) {
+    if (isnan(x) || isnan(y)) return;
+
+    moments->count++;
+    double dx = x - moments->mean_x;
+    double dy = y - moments->mean_y;
+    moments->mean_x += dx / moments->count;
+    moments->mean_y += dy / moments->count;
+    moments->m2_x += dx * (x - moments->mean_x);
+    moments->m2_y += dy * (y - moments->mean_y);
+    moments->c_xy += dx * (y - moments->mean_y);
+}
+
+// Chan et al. pairwise combination of two partial results
+void pair_moments_merge(PairMoments *into, const PairMoments *other) {
+    if (other->count == 0) return;
+    if (into->count == 0) {
+        *into = *other;
+        return;
+    }
+
+    double n_a = (double)into->count, n_b = (double)other->count;
+    double n = n_a + n_b;
+    double dx = other->mean_x - into->mean_x;
+    double dy = other->mean_y - into->mean_y;
+    double weight = n_a * n_b / n;
+
+    into->mean_x += dx * n_b / n;
+    into->mean_y += dy * n_b / n;
+    into->m2_x += other->m2_x + dx * dx * weight;
+    into->m2_y += other->m2_y + dy * dy * weight;
+    into->c_xy += other->c_xy + dx * dy * weight;
+    into->count += other->count;
+}
+
+int compute_pair_moments(const Dataset *x, const Dataset *y, PairMoments *moments) {
+    if (x->size != y->size) return 0;
+
+    pair_moments_init(moments);
+    for (int i = 0; i < x->size; i++) {
+        pair_moments_add(moments, dataset_get(x, i), dataset_get(y, i));
+    }
+    return 1;
+}
+
+double moments_covariance(const PairMoments *moments) {
+    if (moments->count <= 1) return 0.0;
+    return moments->c_xy / (moments->count - 1);
+}
+
+double moments_correlation(const PairMoments *moments) {
+    double denominator = sqrt(moments->m2_x * moments->m2_y);
+    if (denominator == 0) return 0.0;
+    return moments->c_xy / denominator;
+}
+
+// Least-squares fit y = slope * x + intercept
+int linear_regression(const Dataset *x, const Dataset *y, LinearFit *fit) {
+    PairMoments moments;
+    if (!compute_pair_moments(x, y, &moments) || moments.count < 2 || moments.m2_x == 0) {
+        return 0;
+    }
+
+    fit->slope = moments.c_xy / moments.m2_x;
+    fit->intercept = moments.mean_y - fit->slope * moments.mean_x;
+    double r = moments_correlation(&moments);
+    fit->r_squared = r * r;
+    return 1;
+}
+
+double pearson_correlation(const Dataset *x, const Dataset *y) {
+    PairMoments moments;
+    if (!compute_pair_moments(x, y, &moments)) return 0.0;
+    return moments_correlation(&moments);
+}
+
+// Copies the rows where both values are numbers into two new datasets
+static int complete_pairs(const Dataset *x, const Dataset *y, Dataset **pair_x, Dataset **pair_y) {
+    *pair_x = create_dataset(x->size);
+    *pair_y = create_dataset(y->size);
+    if (!*pair_x || !*pair_y) return 0;
+
+    for (int i = 0; i < x->size; i++) {
+        double a = dataset_get(x, i), b = dataset_get(y, i);
+        if (isnan(a) || isnan(b)) continue;
+        (*pair_x)->data[(*pair_x)->size++] = a;
+        (*pair_y)->data[(*pair_y)->size++] = b;
+    }
+    return 1;
+}
+
+static int has_nan_pair(const Dataset *x, const Dataset *y) {
+    for (int i = 0; i < x->size; i++) {
+        if (isnan(dataset_get(x, i)) || isnan(dataset_get(y, i))) return 1;
+    }
+    return 0;
+}
+
+// Pearson correlation of the ranks; ties get their average rank. As in
+// the Pearson path, rows with a NaN on either side are left out, and
+// before ranking so they cannot shift the other rows' ranks.
+double spearman_correlation(Dataset *x, Dataset *y) {
+    if (x->size != y->size) return 0.0;
+
+    Dataset *pair_x = NULL, *pair_y = NULL;
+    if (has_nan_pair(x, y)) {
+        if (!complete_pairs(x, y, &pair_x, &pair_y)) {
+            free_dataset(pair_x);
+            free_dataset(pair_y);
+            return 0.0;
+        }
+        x = pair_x;
+        y = pair_y;
+    }
+
+    double result = 0.0;
+    size_t mark = scratch_mark();
+    if (x->size >= 2) {
+        double *rank_x = scratch_alloc((size_t)x->size * sizeof(double));
+        double *rank_y = scratch_alloc((size_t)y->size * sizeof(double));
+        if (rank_x && rank_y && compute_ranks(x, rank_x) && compute_ranks(y, rank_y)) {
+            PairMoments moments;
+            pair_moments_init(&moments);
+            for (int i = 0; i < x->size; i++) pair_moments_add(&moments, rank_x[i], rank_y[i]);
+            result = moments_correlation(&moments);
+        }
+    }
+    scratch_release(mark);
+
+    free_dataset(pair_x);
+    free_dataset(pair_y);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Covariance matrix
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const Table *table;
+    const double *means;
+    int start;
+    int end;
+    double *sums;   // k x k co-moment sums (upper triangle) for this range
+    int skip_nan;   // Some row has a NaN; such rows add nothing
+    int ok;
+} CovarianceTask;
+
+static int row_has_nan(const double *row, int k) {
+    for (int c = 0; c < k; c++) {
+        if (isnan(row[c])) return 1;
+    }
+    return 0;
+}
+
+static int column_has_nan(const Dataset *column) {
+    if (column->dtype == DTYPE_FLOAT64) {
+        for (int i = 0; i < column->size; i++) {
+            if (isnan(column->data[i])) return 1;
+        }
+        return 0;
+    }
+    for (int i = 0; i < column->size; i++) {
+        if (isnan(dataset_get(column, i))) return 1;
+    }
+    return 0;
+}
+
+// Column means over the rows without a NaN in any column; returns the
+// number of those rows
+static int complete_row_means(const Table *table, double *means) {
+    int k = table->column_count;
+    int rows = table_rows(table);
+    int complete = 0;
+    for (int c = 0; c < k; c++) means[c] = 0.0;
+
+    for (int r = 0; r < rows; r++) {
+        int c = 0;
+        while (c < k && !isnan(dataset_get(table->columns[c], r))) c++;
+        if (c < k) continue;
+
+        // Running means, so no sum of large values can overflow
+        complete++;
+        for (c = 0; c < k; c++) {
+            means[c] += (dataset_get(table->columns[c], r) - means[c]) / complete;
+        }
+    }
+    return complete;
+}
+
+// Accumulates centered cross products over a row range. Rows are gathered
+// into a small centered block, then each row adds its outer product to the
+// upper triangle; the inner loop runs over contiguous memory with
+// independent accumulators, so it vectorises without reassociation.
+static void *covariance_worker(void *arg) {
+    CovarianceTask *task = arg;
+    const Table *table = task->table;
+    int k = table->column_count;
+    int block_rows = COVARIANCE_BLOCK_VALUES / k;
+    if (block_rows < 16) block_rows = 16;
+
+    double *block = malloc((size_t)block_rows * k * sizeof(double));
+    if (!block) {
+        task->ok = 0;
+        return NULL;
+    }
+
+    for (int first = task->start; first < task->end; first += block_rows) {
+        int rows = task->end - first < block_rows ? task->end - first : block_rows;
+
+        for (int c = 0; c < k; c++) {
+            const Dataset *column = table->columns[c];
+            double mean = task->means[c];
+            if (column->dtype == DTYPE_FLOAT64) {
+                const double *values = column->data + first;
+                for (int r = 0; r < rows; r++) block[r * k + c] = values[r] - mean;
+            } else {
+                for (int r = 0; r < rows; r++) block[r * k + c] = dataset_get(column, first + r) - mean;
+            }
+        }
+
+        for (int r = 0; r < rows; r++) {
+            const double *row = block + (size_t)r * k;
+            if (task->skip_nan && row_has_nan(row, k)) continue;
+            for (int i = 0; i < k; i++) {
+                double ci = row[i];
+                double *sums = task->sums + (size_t)i * k;
+                for (int j = i; j < k; j++) sums[j] += ci * row[j];
+            }
+        }
+    }
+
+    free(block);
+    task->ok = 1;
+    return NULL;
+}
+
+static int covariance_threads(int rows) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = rows / COVARIANCE_MIN_ROWS_PER_THREAD;
+    if (threads > cpus) threads = (int)cpus;
+    if (threads > COVARIANCE_MAX_THREADS) threads = COVARIANCE_MAX_THREADS;
+    return threads < 1 ? 1 : threads;
+}
+
+// Two-pass (means, then centered products) for numerical stability; large
+// tables split their rows across threads, each with its own accumulator.
+// `matrix` receives k * k doubles. Rows with a NaN in any column are left
+// out, so for two columns this agrees with the paired statistics.
+int covariance_matrix(const Table *table, double *matrix) {
+    int k = table->column_count;
+    int rows = table_rows(table);
+    if (k == 0) return 0;
+    for (int c = 1; c < k; c++) {
+        if (table->columns[c]->size != rows) return 0;
+    }
+
+    double *means = malloc((size_t)k * sizeof(double));
+    int threads = covariance_threads(rows);
+    CovarianceTask *tasks = calloc((size_t)threads, sizeof(CovarianceTask));
+    pthread_t *ids = malloc((size_t)threads * sizeof(pthread_t));
+    double *sums = calloc((size_t)threads * k * k, sizeof(double));
+    int ok = means && tasks && ids && sums;
+
+    int skip_nan = 0;
+    int used = rows;
+    if (ok) {
+        for (int c = 0; c < k && !skip_nan; c++) skip_nan = column_has_nan(table->columns[c]);
+        if (skip_nan) {
+            used = complete_row_means(table, means);
+        } else {
+            for (int c = 0; c < k; c++) means[c] = compute_average(table->columns[c]);
+        }
+
+        int started = 0;
+        for (int t = 0; t < threads; t++) {
+            tasks[t].table = table;
+            tasks[t].means = means;
+            tasks[t].start = (int)((long long)rows * t / threads);
+            tasks[t].end = (int)((long long)rows * (t + 1) / threads);
+            tasks[t].sums = sums + (size_t)t * k * k;
+            tasks[t].skip_nan = skip_nan;
+            // The last range runs on this thread
+            if (t == threads - 1 || pthread_create(&ids[t], NULL, covariance_worker, &tasks[t]) != 0) {
+                covariance_worker(&tasks[t]);
+            } else {
+                started |= 1 << t;
+            }
+        }
+        for (int t = 0; t < threads; t++) {
+            if (started & (1 << t)) pthread_join(ids[t], NULL);
+            ok = ok && tasks[t].ok;
+        }
+    }
+
+    if (ok) {
+        double divisor = used > 1 ? used - 1 : 1;
+        for (int i = 0; i < k; i++) {
+            for (int j = i; j < k; j++) {
+                double total = 0.0;
+                for (int t = 0; t < threads; t++) total += sums[(size_t)t * k * k + (size_t)i * k + j];
+                matrix[i * k + j] = matrix[j * k + i] = total / divisor;
+            }
+        }
+    }
+
+    free(means);
+    free(tasks);
+    free(ids);
+    free(sums);
+    return ok;
+}
+
+// Rescales a covariance matrix in place into a correlation matrix
+void correlation_from_covariance(double *matrix, int k) {
+    double *stddev = malloc((size_t)k * sizeof(double));
+    if (!stddev) return;
+
+    for (int i = 0; i < k; i++) stddev[i] = sqrt(matrix[i * k + i]);
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < k; j++) {
+            double scale = stddev[i] * stddev[j];
+            matrix[i * k + j] = scale > 0 ? matrix[i * k + j] / scale : 0.0;
+        }
+    }
+    free(stddev);
+}
@@ -0,0 +1,55 @@
+#ifndef MULTIVARIATE_H
+#define MULTIVARIATE_H
+
+#include "math_engine.h"
+
+// Rows per thread below which the covariance matrix stays single-threaded
+#define COVARIANCE_MIN_ROWS_PER_THREAD (1 << 16)
+#define COVARIANCE_MAX_THREADS 16
+
+// Several equally long columns; row r is (columns[0][r], columns[1][r], ...)
+typedef struct {
+    Dataset **columns;
+    int column_count;
+} Table;
+
+// One-pass co-moments of two paired columns (Welford), mergeable with
+// pair_moments_merge() across chunks
+typedef struct {
+    long long count;
+    double mean_x;
+    double mean_y;
+    double m2_x;
+    double m2_y;
+    double c_xy;
+} PairMoments;
+
+typedef struct {
+    double slope;
+    double intercept;
+    double r_squared;
+} LinearFit;
+
+// Tables
+int table_init(Table *table, int column_count);
+void table_free(Table *table);
+int table_rows(const Table *table);
+int load_table(Table *table, const char *filename, int column_count);
+
+// Paired statistics (rows where either value is NaN are skipped)
+void pair_moments_init(PairMoments *moments);
+void pair_moments_add(PairMoments *moments, double x, double y);
+void pair_moments_merge(PairMoments *into, const PairMoments *other);
+int compute_pair_moments(const Dataset *x, const Dataset *y, PairMoments *moments);
+double moments_covariance(const PairMoments *moments);
+double moments_correlation(const PairMoments *moments);
+int linear_regression(const Dataset *x, const Dataset *y, LinearFit *fit);
+double pearson_correlation(const Dataset *x, const Dataset *y);
+double spearman_correlation(Dataset *x, Dataset *y);
+
+// k x k sample covariance matrix of the table's columns, row-major (rows
+// with a NaN in any column are skipped)
+int covariance_matrix(const Table *table, double *matrix);
+void correlation_from_covariance(double *matrix, int k);
+
+#endif
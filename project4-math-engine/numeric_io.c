@@ -0,0 +1,354 @@
+#include "numeric_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Largest integer a double holds exactly (2^53)
+#define EXACT_INT_LIMIT 9007199254740992.0
+#define MAX_FAST_DIGITS 19
+#define READ_BLOCK_SIZE (1 << 20)
+
+// Powers of ten that are exactly representable as doubles
+static const double exact_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Reads a file that cannot be mapped (pipes, empty files) into a heap buffer
+static int read_whole_file(FileView *view, int fd) {
+    size_t capacity = READ_BLOCK_SIZE;
+    size_t size = 0;
+    char *buffer = malloc(capacity);
+    if (!buffer) return 0;
+
+    while (1) {
+        if (size == capacity) {
+            char *temp = realloc(buffer, capacity * 2);
+            if (!temp) {
+                free(buffer);
+                return 0;
+            }
+            buffer = temp;
+            capacity *= 2;
+        }
+
+        ssize_t n = read(fd, buffer + size, capacity - size);
+        if (n < 0) {
+            free(buffer);
+            return 0;
+        }
+        if (n == 0) break;
+        size += (size_t)n;
+    }
+
+    view->data = buffer;
+    view->size = size;
+    view->mapped = 0;
+    return 1;
+}
+
+int open_file_view(FileView *view, const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+            view->data = addr;
+            view->size = (size_t)st.st_size;
+            view->mapped = 1;
+            close(fd);
+            return 1;
+        }
+    }
+
+    int ok = read_whole_file(view, fd);
+    close(fd);
+    return ok;
+}
+
+void close_file_view(FileView *view) {
+    if (!view->data) return;
+
+    if (view->mapped) {
+        munmap((void *)view->data, view->size);
+    } else {
+        free((void *)view->data);
+    }
+    view->data = NULL;
+    view->size = 0;
+}
+
+// Slow path: hands the token to strtod, which rounds every input correctly
+static int parse_double_fallback(const char **cursor, const char *start, const char *end, double *out) {
+    const char *token_end = start;
+    while (token_end < end && !is_space(*token_end)) token_end++;
+
+    size_t len = (size_t)(token_end - start);
+    char small[64];
+    char *copy = len < sizeof(small) ? small : malloc(len + 1);
+    if (!copy) return 0;
+    memcpy(copy, start, len);
+    copy[len] = '\0';
+
+    char *parsed_end;
+    double value = strtod(copy, &parsed_end);
+    size_t consumed = (size_t)(parsed_end - copy);
+    if (copy != small) free(copy);
+
+    if (consumed == 0) return 0;
+    *out = value;
+    *cursor = start + consumed;
+    return 1;
+}
+
+// Parses the next whitespace-separated number. Decimal inputs with at most
+// 19 significant digits and a small exponent are converted with a single
+// exactly rounded multiply or divide (Clinger's fast path); anything else
+// falls back to strtod. Returns 0 at end of input or on a non-numeric token.
+int parse_double(const char **cursor, const char *end, double *out) {
+    const char *p = *cursor;
+    while (p < end && is_space(*p)) p++;
+    *cursor = p;
+    if (p == end) return 0;
+
+    const char *start = p;
+    int negative = 0;
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    int seen_digit = 0;
+    int truncated = 0;
+
+    for (; p < end && is_digit(*p); p++) {
+        seen_digit = 1;
+        if (mantissa == 0 && *p == '0') continue;
+        if (digits < MAX_FAST_DIGITS) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits++;
+        } else {
+            exponent++;
+            truncated = 1;
+        }
+    }
+
+    if (p < end && *p == '.') {
+        for (p++; p < end && is_digit(*p); p++) {
+            seen_digit = 1;
+            if (mantissa == 0 && *p == '0') {
+                exponent--;
+                continue;
+            }
+            if (digits < MAX_FAST_DIGITS) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits++;
+                exponent--;
+            } else {
+                truncated = 1;
+            }
+        }
+    }
+
+    if (!seen_digit) return parse_double_fallback(cursor, start, end, out);
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int exp_negative = 0;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exp_negative = (*q == '-');
+            q++;
+        }
+        if (q < end && is_digit(*q)) {
+            int exp_value = 0;
+            for (; q < end && is_digit(*q); q++) {
+                if (exp_value < 100000) exp_value = exp_value * 10 + (*q - '0');
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            p = q;
+        }
+    }
+
+    // Hex floats, inf/nan suffixes and glued tokens are left to strtod
+    if (p < end && !is_space(*p)) return parse_double_fallback(cursor, start, end, out);
+    // Compared as integers: converting first would round 2^53 + 1 down
+    if (truncated || mantissa > (1ULL << 53)) {
+        return parse_double_fallback(cursor, start, end, out);
+    }
+
+    double value = (double)mantissa;
+    if (mantissa == 0) {
+        value = 0.0;
+    } else if (exponent < 0) {
+        if (exponent < -22) return parse_double_fallback(cursor, start, end, out);
+        value /= exact_powers_of_ten[-exponent];
+    } else if (exponent > 22) {
+        // Move surplus powers into the mantissa while it stays exact
+        if (exponent > 22 + 15) return parse_double_fallback(cursor, start, end, out);
+        value *= exact_powers_of_ten[exponent - 22];
+        if (value > EXACT_INT_LIMIT) return parse_double_fallback(cursor, start, end, out);
+        value *= exact_powers_of_ten[22];
+    } else {
+        value *= exact_powers_of_ten[exponent];
+    }
+
+    *out = negative ? -value : value;
+    *cursor = p;
+    return 1;
+}
+
+static int write_unsigned(uint64_t value, char *buf) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    for (int i = 0; i < n; i++) {
+        buf[i] = digits[n - 1 - i];
+    }
+    return n;
+}
+
+// Writes m * 10^-decimals in fixed notation
+static int write_fixed(int negative, uint64_t m, int decimals, char *buf) {
+    char digits[24];
+    int n = write_unsigned(m, digits);
+    int len = 0;
+
+    if (negative) buf[len++] = '-';
+    if (decimals == 0) {
+        memcpy(buf + len, digits, n);
+        return len + n;
+    }
+
+    if (n <= decimals) {
+        buf[len++] = '0';
+        buf[len++] = '.';
+        for (int i = n; i < decimals; i++) buf[len++] = '0';
+        memcpy(buf + len, digits, n);
+        return len + n;
+    }
+
+    memcpy(buf + len, digits, n - decimals);
+    len += n - decimals;
+    buf[len++] = '.';
+    memcpy(buf + len, digits + n - decimals, decimals);
+    return len + decimals;
+}
+
+// Slow path: the shortest %.Ng that strtod maps back to the same double
+static int format_double_fallback(double value, char *buf) {
+    int len = 0;
+    for (int precision = 15; precision <= 17; precision++) {
+        len = snprintf(buf, FORMAT_DOUBLE_MAX, "%.*g", precision, value);
+        if (strtod(buf, NULL) == value) break;
+    }
+    return len;
+}
+
+// Parses the next number as an exact 64-bit integer. Plain integer tokens
+// are accumulated directly so values beyond 2^53 keep every digit; tokens
+// with a fraction or exponent go through parse_double and are rounded.
+// Returns 0 at end of input, on a non-numeric token or if out of range.
+int parse_int64(const char **cursor, const char *end, int64_t *out) {
+    const char *p = *cursor;
+    while (p < end && is_space(*p)) p++;
+    *cursor = p;
+    if (p == end) return 0;
+
+    int negative = 0;
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        p++;
+    }
+
+    uint64_t magnitude = 0;
+    int digits = 0, overflow = 0;
+    for (; p < end && is_digit(*p); p++, digits++) {
+        uint64_t digit = (uint64_t)(*p - '0');
+        if (magnitude > (UINT64_MAX - digit) / 10) overflow = 1;
+        magnitude = magnitude * 10 + digit;
+    }
+
+    if (digits > 0 && !overflow && (p == end || is_space(*p))) {
+        uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+        if (magnitude > limit) return 0;
+        *out = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+        *cursor = p;
+        return 1;
+    }
+
+    double value;
+    if (!parse_double(cursor, end, &value)) return 0;
+    if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0)) return 0;
+    *out = (int64_t)llround(value);
+    return 1;
+}
+
+// Writes the shortest fixed-notation decimal that reads back as exactly
+// `value` into buf (at least FORMAT_DOUBLE_MAX bytes) and returns its length.
+// Values whose scaled digits fit in 53 bits are found by trying m / 10^k for
+// increasing k; huge, tiny and non-finite values use snprintf.
+int format_double(double value, char *buf) {
+    if (!isfinite(value)) {
+        int len = snprintf(buf, FORMAT_DOUBLE_MAX, "%s%s",
+                           signbit(value) && !isnan(value) ? "-" : "",
+                           isnan(value) ? "nan" : "inf");
+        return len;
+    }
+
+    int negative = signbit(value) != 0;
+    double magnitude = fabs(value);
+
+    for (int k = 0; k <= 22; k++) {
+        double scaled = magnitude * exact_powers_of_ten[k];
+        if (scaled >= EXACT_INT_LIMIT) break;
+
+        // Scaling is off by at most one unit, so check the neighbours too
+        uint64_t m = (uint64_t)(scaled + 0.5);
+        for (int delta = 0; delta < 3; delta++) {
+            uint64_t candidate = delta == 0 ? m : (delta == 1 ? m - 1 : m + 1);
+            if (candidate > m + 1) continue;
+            if ((double)candidate / exact_powers_of_ten[k] == magnitude) {
+                return write_fixed(negative, candidate, k, buf);
+            }
+        }
+    }
+
+    return format_double_fallback(value, buf);
+}
+
+double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double io_stats_mb_per_sec(const IoStats *stats) {
+    if (stats->seconds <= 0.0) return 0.0;
+    return stats->bytes / (1024.0 * 1024.0) / stats->seconds;
+}
@@ -0,0 +1,37 @@
+#ifndef NUMERIC_IO_H
+#define NUMERIC_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest string format_double() can produce, including the terminator
+#define FORMAT_DOUBLE_MAX 32
+
+// Read-only view of a whole file (memory-mapped when possible)
+typedef struct {
+    const char *data;
+    size_t size;
+    int mapped;
+} FileView;
+
+// Timing and volume of one load/save call
+typedef struct {
+    size_t bytes;
+    int values;
+    double seconds;
+} IoStats;
+
+// File views
+int open_file_view(FileView *view, const char *filename);
+void close_file_view(FileView *view);
+
+// Number parsing and formatting
+int parse_double(const char **cursor, const char *end, double *out);
+int parse_int64(const char **cursor, const char *end, int64_t *out);
+int format_double(double value, char *buf);
+
+// Timing helpers
+double monotonic_seconds(void);
+double io_stats_mb_per_sec(const IoStats *stats);
+
+#endif
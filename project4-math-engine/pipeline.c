@@ -0,0 +1,307 @@
+#include "pipeline.h"
+#include "stream_engine.h"
+#include <math.h>
+#include <ctype.h>
+
+// ---------------------------------------------------------------------------
+// Parsing
+// ---------------------------------------------------------------------------
+
+static const char *skip_spaces(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+// Reads a run of letters (and '_'/'-') into word; returns its length
+static int read_word(const char **cursor, char *word, size_t max) {
+    const char *p = *cursor;
+    size_t len = 0;
+    while (isalpha((unsigned char)*p) || *p == '_' || *p == '-') {
+        if (len + 1 < max) word[len++] = (char)tolower((unsigned char)*p);
+        p++;
+    }
+    word[len] = '\0';
+    *cursor = p;
+    return (int)len;
+}
+
+static int read_operand(const char **cursor, double *value) {
+    char *end;
+    *value = strtod(*cursor, &end);
+    if (end == *cursor) return 0;
+    *cursor = end;
+    return 1;
+}
+
+static int parse_filter(PipelineStage *stage, const char **cursor) {
+    static const struct {
+        const char *symbol;
+        StageOp op;
+    } comparisons[] = {
+        {">=", PIPE_GE}, {"<=", PIPE_LE}, {"==", PIPE_EQ}, {"!=", PIPE_NE},
+        {">", PIPE_GT}, {"<", PIPE_LT}, {NULL, PIPE_GT}
+    };
+    char word[16];
+    const char *p = *cursor;
+
+    if (read_word(&p, word, sizeof(word)) > 0) {
+        if (strcmp(word, "finite") != 0) return 0;
+        stage->op = PIPE_FINITE;
+        *cursor = p;
+        return 1;
+    }
+
+    for (int i = 0; comparisons[i].symbol != NULL; i++) {
+        size_t len = strlen(comparisons[i].symbol);
+        if (strncmp(p, comparisons[i].symbol, len) == 0) {
+            stage->op = comparisons[i].op;
+            p = skip_spaces(p + len);
+            if (!read_operand(&p, &stage->operand)) return 0;
+            *cursor = p;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int parse_map(PipelineStage *stage, const char **cursor) {
+    static const struct {
+        const char *name;
+        StageOp op;
+    } functions[] = {
+        {"abs", PIPE_ABS}, {"sqrt", PIPE_SQRT}, {"log", PIPE_LOG}, {"square", PIPE_SQUARE},
+        {NULL, PIPE_ABS}
+    };
+    char word[16];
+    const char *p = *cursor;
+
+    if (read_word(&p, word, sizeof(word)) > 0) {
+        for (int i = 0; functions[i].name != NULL; i++) {
+            if (strcmp(word, functions[i].name) == 0) {
+                stage->op = functions[i].op;
+                *cursor = p;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    switch (*p) {
+        case '+': stage->op = PIPE_ADD; break;
+        case '-': stage->op = PIPE_SUB; break;
+        case '*': stage->op = PIPE_MUL; break;
+        case '/': stage->op = PIPE_DIV; break;
+        default: return 0;
+    }
+    p = skip_spaces(p + 1);
+    if (!read_operand(&p, &stage->operand)) return 0;
+    *cursor = p;
+    return 1;
+}
+
+// The reduce name runs to the next '|' or the end, so table names with
+// spaces ("standard deviation") work as well as aliases
+static int parse_reduce(PipelineStage *stage, const char **cursor) {
+    const char *p = *cursor;
+    const char *end = p;
+    while (*end && *end != '|' && *end != '\n') end++;
+    const char *name_end = end;
+    while (name_end > p && (name_end[-1] == ' ' || name_end[-1] == '\t')) name_end--;
+
+    char name[64];
+    size_t len = (size_t)(name_end - p);
+    if (len == 0 || len >= sizeof(name)) return 0;
+    memcpy(name, p, len);
+    name[len] = '\0';
+
+    stage->reduce = find_math_operation(name);
+    if (stage->reduce < 0) return 0;
+    *cursor = end;
+    return 1;
+}
+
+int pipeline_parse(Pipeline *pipeline, const char *text) {
+    const char *p = text;
+    pipeline->count = 0;
+    pipeline->error[0] = '\0';
+
+    while (1) {
+        p = skip_spaces(p);
+        if (pipeline->count == PIPELINE_MAX_STAGES) {
+            snprintf(pipeline->error, PIPELINE_ERROR_MAX, "more than %d stages", PIPELINE_MAX_STAGES);
+            return 0;
+        }
+
+        PipelineStage *stage = &pipeline->stages[pipeline->count];
+        memset(stage, 0, sizeof(*stage));
+        const char *stage_text = p;
+        char keyword[16];
+        read_word(&p, keyword, sizeof(keyword));
+        p = skip_spaces(p);
+
+        int ok;
+        if (strcmp(keyword, "filter") == 0) {
+            stage->kind = STAGE_FILTER;
+            ok = parse_filter(stage, &p);
+        } else if (strcmp(keyword, "map") == 0) {
+            stage->kind = STAGE_MAP;
+            ok = parse_map(stage, &p);
+        } else if (strcmp(keyword, "reduce") == 0) {
+            stage->kind = STAGE_REDUCE;
+            ok = parse_reduce(stage, &p);
+        } else {
+            ok = 0;
+        }
+
+        p = skip_spaces(p);
+        if (!ok || (*p && *p != '|' && *p != '\n')) {
+            int len = 0;
+            while (stage_text[len] && stage_text[len] != '|' && stage_text[len] != '\n') len++;
+            snprintf(pipeline->error, PIPELINE_ERROR_MAX, "invalid stage '%.*s'", len, stage_text);
+            return 0;
+        }
+        pipeline->count++;
+
+        if (*p != '|') break;
+        if (stage->kind == STAGE_REDUCE) {
+            snprintf(pipeline->error, PIPELINE_ERROR_MAX, "reduce must be the last stage");
+            return 0;
+        }
+        p++;
+    }
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Fused execution
+// ---------------------------------------------------------------------------
+
+// Keeps matching values in place; the write is unconditional and only the
+// output position depends on the test, so the loop has no data branch
+static int apply_filter(const PipelineStage *stage, double *values, int n) {
+    double x = stage->operand;
+    int kept = 0;
+
+#define KEEP_IF(test)                                                          \
+    for (int i = 0; i < n; i++) {                                              \
+        double v = values[i];                                                  \
+        values[kept] = v;                                                      \
+        kept += (test);                                                        \
+    }
+
+    switch (stage->op) {
+        case PIPE_GT: KEEP_IF(v > x) break;
+        case PIPE_GE: KEEP_IF(v >= x) break;
+        case PIPE_LT: KEEP_IF(v < x) break;
+        case PIPE_LE: KEEP_IF(v <= x) break;
+        case PIPE_EQ: KEEP_IF(v == x) break;
+        case PIPE_NE: KEEP_IF(v != x) break;
+        case PIPE_FINITE: KEEP_IF(isfinite(v) != 0) break;
+        default: return n;
+    }
+#undef KEEP_IF
+    return kept;
+}
+
+static void apply_map(const PipelineStage *stage, double *values, int n) {
+    double x = stage->operand;
+    switch (stage->op) {
+        case PIPE_ADD: for (int i = 0; i < n; i++) values[i] += x; break;
+        case PIPE_SUB: for (int i = 0; i < n; i++) values[i] -= x; break;
+        case PIPE_MUL: for (int i = 0; i < n; i++) values[i] *= x; break;
+        case PIPE_DIV: for (int i = 0; i < n; i++) values[i] /= x; break;
+        case PIPE_ABS: for (int i = 0; i < n; i++) values[i] = fabs(values[i]); break;
+        case PIPE_SQRT: for (int i = 0; i < n; i++) values[i] = sqrt(values[i]); break;
+        case PIPE_LOG: for (int i = 0; i < n; i++) values[i] = log(values[i]); break;
+        case PIPE_SQUARE: for (int i = 0; i < n; i++) values[i] *= values[i]; break;
+        default: break;
+    }
+}
+
+static int append_block(Dataset *sink, const double *values, int n) {
+    if (!dataset_reserve(sink, sink->size + n)) return 0;
+    if (sink->dtype == DTYPE_FLOAT64 && !sink->rolling) {
+        memcpy(sink->data + sink->size, values, (size_t)n * sizeof(double));
+        sink->size += n;
+        dataset_invalidate(sink);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (!add_element(sink, values[i])) return 0;
+    }
+    return 1;
+}
+
+// Runs every element-wise stage on one cache-sized block before moving on,
+// so no intermediate array is ever materialised. A trailing reduce merges
+// per-block summaries; median (which needs all survivors) and pipelines
+// without a reduce write the survivors to a sink. `output` receives the
+// survivors when there is no reduce stage and may be NULL.
+int pipeline_run(const Pipeline *pipeline, Dataset *input, Dataset *output, PipelineResult *result) {
+    if (output == input) return 0;
+
+    memset(result, 0, sizeof(*result));
+    result->input_count = input->size;
+
+    const PipelineStage *last = pipeline->count > 0 ? &pipeline->stages[pipeline->count - 1] : NULL;
+    int reducing = last && last->kind == STAGE_REDUCE;
+    int element_stages = reducing ? pipeline->count - 1 : pipeline->count;
+    MathOperation reduce = reducing ? math_operations[last->reduce].operation : NULL;
+
+    StreamSummary summary;
+    int summarising = reducing && reduce != compute_median;
+    Dataset *sink = reducing ? NULL : output;
+    if (reducing && !summarising) {
+        sink = create_dataset(PIPELINE_BLOCK);
+        if (!sink) return 0;
+    } else if (output) {
+        clear_dataset(output);
+    }
+    if (summarising) stream_summary_init_moments(&summary);
+
+    double block[PIPELINE_BLOCK];
+    Dataset view;
+    memset(&view, 0, sizeof(view));
+    dataset_set_storage(&view, block, DTYPE_FLOAT64);
+    view.capacity = PIPELINE_BLOCK;
+
+    int ok = 1;
+    for (int start = 0; start < input->size && ok; start += PIPELINE_BLOCK) {
+        int n = input->size - start < PIPELINE_BLOCK ? input->size - start : PIPELINE_BLOCK;
+        if (input->dtype == DTYPE_FLOAT64) {
+            memcpy(block, input->data + start, (size_t)n * sizeof(double));
+        } else {
+            for (int i = 0; i < n; i++) block[i] = dataset_get(input, start + i);
+        }
+
+        for (int s = 0; s < element_stages && n > 0; s++) {
+            if (pipeline->stages[s].kind == STAGE_FILTER) {
+                n = apply_filter(&pipeline->stages[s], block, n);
+            } else {
+                apply_map(&pipeline->stages[s], block, n);
+            }
+        }
+        if (n == 0) continue;
+
+        result->output_count += n;
+        // The view is reused over each new block, so results cached for
+        // the previous block must not carry over
+        view.size = n;
+        dataset_invalidate(&view);
+        if (summarising) {
+            ok = stream_summary_add_chunk(&summary, &view);
+        } else if (sink) {
+            ok = append_block(sink, block, n);
+        }
+    }
+
+    if (ok && reducing) {
+        result->has_value = 1;
+        result->value = summarising ? stream_summary_result(&summary, reduce) :
+                        sink->size > 0 ? reduce(sink) : 0.0;
+    }
+
+    if (summarising) stream_summary_free(&summary);
+    if (reducing && !summarising) free_dataset(sink);
+    return ok;
+}
@@ -0,0 +1,49 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "math_engine.h"
+
+#define PIPELINE_MAX_STAGES 16
+#define PIPELINE_BLOCK 1024
+#define PIPELINE_ERROR_MAX 128
+
+// A pipeline is a '|'-separated list of stages, for example
+//   filter > 0 | map * 2 | reduce stddev
+// filter: > >= < <= == != VALUE, or "finite"
+// map:    + - * / VALUE, or abs, sqrt, log, square
+// reduce: any math_operations[] name or alias (last stage only)
+typedef enum {
+    STAGE_FILTER,
+    STAGE_MAP,
+    STAGE_REDUCE
+} StageKind;
+
+typedef enum {
+    PIPE_GT, PIPE_GE, PIPE_LT, PIPE_LE, PIPE_EQ, PIPE_NE, PIPE_FINITE,
+    PIPE_ADD, PIPE_SUB, PIPE_MUL, PIPE_DIV, PIPE_ABS, PIPE_SQRT, PIPE_LOG, PIPE_SQUARE
+} StageOp;
+
+typedef struct {
+    StageKind kind;
+    StageOp op;
+    double operand;
+    int reduce;             // Index into math_operations[] for STAGE_REDUCE
+} PipelineStage;
+
+typedef struct {
+    PipelineStage stages[PIPELINE_MAX_STAGES];
+    int count;
+    char error[PIPELINE_ERROR_MAX];
+} Pipeline;
+
+typedef struct {
+    long long input_count;
+    long long output_count;     // Elements that survived every filter
+    int has_value;              // Set when the pipeline ends in a reduce
+    double value;
+} PipelineResult;
+
+int pipeline_parse(Pipeline *pipeline, const char *text);
+int pipeline_run(const Pipeline *pipeline, Dataset *input, Dataset *output, PipelineResult *result);
+
+#endif
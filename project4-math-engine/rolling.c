@@ -0,0 +1,218 @@
+#include "rolling.h"
+#include <math.h>
+
+RollingOperationEntry rolling_operations[] = {
+    {"Moving Average", rolling_mean},
+    {"Moving Minimum", rolling_min},
+    {"Moving Maximum", rolling_max},
+    {"Rolling Variance", rolling_variance},
+    {"EWMA", rolling_ewma},
+    {"Cumulative Sum", rolling_cumsum},
+    {NULL, NULL}
+};
+
+// ---------------------------------------------------------------------------
+// Window state
+// ---------------------------------------------------------------------------
+
+int rolling_init(RollingWindow *rolling, int window, double alpha) {
+    if (window <= 0 || !(alpha > 0 && alpha <= 1)) return 0;
+
+    rolling->window = window;
+    rolling->alpha = alpha;
+    rolling->ring = malloc((size_t)window * sizeof(double));
+    rolling->min_deque = malloc((size_t)window * sizeof(long long));
+    rolling->max_deque = malloc((size_t)window * sizeof(long long));
+    if (!rolling->ring || !rolling->min_deque || !rolling->max_deque) {
+        rolling_free(rolling);
+        return 0;
+    }
+
+    rolling_reset(rolling);
+    return 1;
+}
+
+void rolling_free(RollingWindow *rolling) {
+    free(rolling->ring);
+    free(rolling->min_deque);
+    free(rolling->max_deque);
+    rolling->ring = NULL;
+    rolling->min_deque = NULL;
+    rolling->max_deque = NULL;
+}
+
+void rolling_reset(RollingWindow *rolling) {
+    rolling->seen = 0;
+    rolling->min_head = rolling->min_size = 0;
+    rolling->max_head = rolling->max_size = 0;
+    rolling->mean = 0.0;
+    rolling->m2 = 0.0;
+    rolling->ewma = 0.0;
+    rolling->cumulative = 0.0;
+    rolling->cumulative_error = 0.0;
+}
+
+int rolling_count(const RollingWindow *rolling) {
+    return rolling->seen < rolling->window ? (int)rolling->seen : rolling->window;
+}
+
+static double sample(const RollingWindow *rolling, long long seq) {
+    return rolling->ring[seq % rolling->window];
+}
+
+// Appends `seq` to a monotonic deque after dropping the back entries it
+// makes redundant: larger ones for the min deque, smaller for the max deque
+static void deque_push(const RollingWindow *rolling, long long *deque, int head, int *size,
+                       long long seq, int keep_min) {
+    double value = sample(rolling, seq);
+    while (*size > 0) {
+        double back = sample(rolling, deque[(head + *size - 1) % rolling->window]);
+        if (keep_min ? back < value : back > value) break;
+        (*size)--;
+    }
+    deque[(head + *size) % rolling->window] = seq;
+    (*size)++;
+}
+
+// Recomputes the window moments from scratch to cancel accumulated
+// rounding error; called once per `window` samples, so O(1) amortized
+static void refresh_moments(RollingWindow *rolling) {
+    int n = rolling_count(rolling);
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += rolling->ring[i];
+    double mean = sum / n;
+    double m2 = 0.0;
+    for (int i = 0; i < n; i++) {
+        double d = rolling->ring[i] - mean;
+        m2 += d * d;
+    }
+    rolling->mean = mean;
+    rolling->m2 = m2;
+}
+
+// Adds one sample. NaN samples are ignored so they cannot poison the
+// window statistics.
+void rolling_push(RollingWindow *rolling, double value) {
+    if (isnan(value)) return;
+
+    long long seq = rolling->seen;
+    int window = rolling->window;
+    int slot = (int)(seq % window);
+
+    // The sample leaving the window can only be at the front of a deque
+    if (seq >= window) {
+        long long expired = seq - window;
+        if (rolling->min_size > 0 && rolling->min_deque[rolling->min_head] == expired) {
+            rolling->min_head = (rolling->min_head + 1) % window;
+            rolling->min_size--;
+        }
+        if (rolling->max_size > 0 && rolling->max_deque[rolling->max_head] == expired) {
+            rolling->max_head = (rolling->max_head + 1) % window;
+            rolling->max_size--;
+        }
+
+        // Sliding Welford update: replace the oldest sample by the new one
+        double oldest = rolling->ring[slot];
+        double old_mean = rolling->mean;
+        rolling->mean += (value - oldest) / window;
+        rolling->m2 += (value - oldest) * (value - rolling->mean + oldest - old_mean);
+        if (rolling->m2 < 0) rolling->m2 = 0;
+    } else {
+        double delta = value - rolling->mean;
+        rolling->mean += delta / (seq + 1);
+        rolling->m2 += delta * (value - rolling->mean);
+    }
+
+    rolling->ring[slot] = value;
+    deque_push(rolling, rolling->min_deque, rolling->min_head, &rolling->min_size, seq, 1);
+    deque_push(rolling, rolling->max_deque, rolling->max_head, &rolling->max_size, seq, 0);
+
+    rolling->ewma = seq == 0 ? value : rolling->alpha * value + (1 - rolling->alpha) * rolling->ewma;
+
+    // Neumaier-compensated cumulative sum
+    double total = rolling->cumulative + value;
+    if (fabs(rolling->cumulative) >= fabs(value)) {
+        rolling->cumulative_error += (rolling->cumulative - total) + value;
+    } else {
+        rolling->cumulative_error += (value - total) + rolling->cumulative;
+    }
+    rolling->cumulative = total;
+
+    rolling->seen++;
+    if (rolling->seen % window == 0) refresh_moments(rolling);
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+// ---------------------------------------------------------------------------
+
+double rolling_mean(const RollingWindow *rolling) {
+    return rolling->seen > 0 ? rolling->mean : 0.0;
+}
+
+double rolling_min(const RollingWindow *rolling) {
+    if (rolling->min_size == 0) return 0.0;
+    return sample(rolling, rolling->min_deque[rolling->min_head]);
+}
+
+double rolling_max(const RollingWindow *rolling) {
+    if (rolling->max_size == 0) return 0.0;
+    return sample(rolling, rolling->max_deque[rolling->max_head]);
+}
+
+double rolling_variance(const RollingWindow *rolling) {
+    int n = rolling_count(rolling);
+    if (n <= 1) return 0.0;
+    return rolling->m2 / (n - 1);
+}
+
+double rolling_ewma(const RollingWindow *rolling) {
+    return rolling->ewma;
+}
+
+double rolling_cumsum(const RollingWindow *rolling) {
+    return rolling->cumulative + rolling->cumulative_error;
+}
+
+// ---------------------------------------------------------------------------
+// Live tracking and batch evaluation
+// ---------------------------------------------------------------------------
+
+// Replays the dataset's current elements so the window reflects them
+void rolling_rebuild(RollingWindow *rolling, const Dataset *dataset) {
+    rolling_reset(rolling);
+    for (int i = 0; i < dataset->size; i++) {
+        rolling_push(rolling, dataset_get(dataset, i));
+    }
+}
+
+void rolling_attach(RollingWindow *rolling, Dataset *dataset) {
+    rolling_rebuild(rolling, dataset);
+    dataset->rolling = rolling;
+}
+
+void rolling_detach(Dataset *dataset) {
+    dataset->rolling = NULL;
+}
+
+int rolling_series(const Dataset *input, int window, double alpha, RollingStat stat,
+                   Dataset *output) {
+    RollingWindow rolling;
+    if (!rolling_init(&rolling, window, alpha)) return 0;
+
+    clear_dataset(output);
+    if (!dataset_reserve(output, input->size)) {
+        rolling_free(&rolling);
+        return 0;
+    }
+    for (int i = 0; i < input->size; i++) {
+        rolling_push(&rolling, dataset_get(input, i));
+        if (!add_element(output, stat(&rolling))) {
+            rolling_free(&rolling);
+            return 0;
+        }
+    }
+
+    rolling_free(&rolling);
+    return 1;
+}
@@ -0,0 +1,60 @@
+#ifndef ROLLING_H
+#define ROLLING_H
+
+#include "math_engine.h"
+
+#define ROLLING_DEFAULT_ALPHA 0.1
+
+// Sliding-window state updated in O(1) amortized per sample. The last
+// `window` samples live in a ring buffer; the min/max deques hold sample
+// sequence numbers whose values are monotonic from front to back.
+typedef struct RollingWindow {
+    int window;
+    double *ring;
+    long long seen;         // Samples pushed so far
+    long long *min_deque;
+    long long *max_deque;
+    int min_head, min_size;
+    int max_head, max_size;
+    double mean;            // Mean and sum of squared deviations of the window
+    double m2;
+    double alpha;           // EWMA smoothing factor in (0, 1]
+    double ewma;
+    double cumulative;      // Compensated running total of every sample
+    double cumulative_error;
+} RollingWindow;
+
+typedef double (*RollingStat)(const RollingWindow *rolling);
+
+typedef struct {
+    const char *name;
+    RollingStat operation;
+} RollingOperationEntry;
+
+extern RollingOperationEntry rolling_operations[];
+
+// Window state
+int rolling_init(RollingWindow *rolling, int window, double alpha);
+void rolling_free(RollingWindow *rolling);
+void rolling_reset(RollingWindow *rolling);
+void rolling_push(RollingWindow *rolling, double value);
+int rolling_count(const RollingWindow *rolling);
+
+// Statistics of the current window (EWMA and cumulative sum cover all samples)
+double rolling_mean(const RollingWindow *rolling);
+double rolling_min(const RollingWindow *rolling);
+double rolling_max(const RollingWindow *rolling);
+double rolling_variance(const RollingWindow *rolling);
+double rolling_ewma(const RollingWindow *rolling);
+double rolling_cumsum(const RollingWindow *rolling);
+
+// Live tracking: once attached, every add_element() pushes into the window
+void rolling_attach(RollingWindow *rolling, Dataset *dataset);
+void rolling_detach(Dataset *dataset);
+void rolling_rebuild(RollingWindow *rolling, const Dataset *dataset);
+
+// Batch: output[i] is the statistic after input[0..i] have been pushed
+int rolling_series(const Dataset *input, int window, double alpha, RollingStat stat,
+                   Dataset *output);
+
+#endif
@@ -0,0 +1,565 @@
+#include "stream_engine.h"
+#include <math.h>
+
+#define READER_BUFFER_SIZE (1 << 20)
+#define MERGE_FANIN 64
+#define RUN_BUFFER_VALUES 8192
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+static int is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// ---------------------------------------------------------------------------
+// Chunk reader
+// ---------------------------------------------------------------------------
+
+int chunk_reader_open(ChunkReader *reader, const char *filename) {
+    reader->file = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+    if (!reader->file) return 0;
+
+    reader->buffer = malloc(READER_BUFFER_SIZE);
+    if (!reader->buffer) {
+        if (reader->file != stdin) fclose(reader->file);
+        return 0;
+    }
+
+    reader->start = 0;
+    reader->end = 0;
+    reader->eof = 0;
+    reader->done = 0;
+    return 1;
+}
+
+void chunk_reader_close(ChunkReader *reader) {
+    if (reader->file && reader->file != stdin) fclose(reader->file);
+    free(reader->buffer);
+    reader->file = NULL;
+    reader->buffer = NULL;
+}
+
+static void chunk_reader_refill(ChunkReader *reader) {
+    size_t remaining = reader->end - reader->start;
+    memmove(reader->buffer, reader->buffer + reader->start, remaining);
+    reader->start = 0;
+    reader->end = remaining;
+
+    size_t wanted = READER_BUFFER_SIZE - reader->end;
+    size_t n = fread(reader->buffer + reader->end, 1, wanted, reader->file);
+    reader->end += n;
+    if (n < wanted) reader->eof = 1;
+}
+
+// End of the region that holds only complete tokens: everything up to the
+// last whitespace, or the whole buffer once the input is exhausted
+static size_t chunk_reader_limit(const ChunkReader *reader) {
+    if (reader->eof) return reader->end;
+
+    size_t limit = reader->end;
+    while (limit > reader->start && !is_space(reader->buffer[limit - 1])) limit--;
+    return limit;
+}
+
+// Fills `chunk` with up to max_values numbers. Returns how many were read;
+// 0 means the input is exhausted (or stopped at a non-numeric token).
+int chunk_reader_next(ChunkReader *reader, Dataset *chunk, int max_values) {
+    clear_dataset(chunk);
+    if (!dataset_reserve(chunk, max_values)) return 0;
+
+    while (!reader->done && chunk->size < max_values) {
+        size_t limit = chunk_reader_limit(reader);
+        if (limit == reader->start) {
+            // A single token filling the whole buffer cannot be a number
+            if (reader->eof || (reader->start == 0 && reader->end == READER_BUFFER_SIZE)) {
+                reader->done = 1;
+                break;
+            }
+            chunk_reader_refill(reader);
+            continue;
+        }
+
+        const char *cursor = reader->buffer + reader->start;
+        const char *end = reader->buffer + limit;
+        double value;
+        while (chunk->size < max_values && parse_double(&cursor, end, &value)) {
+            chunk->data[chunk->size++] = value;
+        }
+        reader->start = cursor - reader->buffer;
+
+        if (chunk->size < max_values) {
+            if (cursor < end || reader->eof) {
+                reader->done = 1;
+            } else {
+                chunk_reader_refill(reader);
+            }
+        }
+    }
+    return chunk->size;
+}
+
+// ---------------------------------------------------------------------------
+// KLL quantile sketch
+// ---------------------------------------------------------------------------
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nominal capacity shrinks by 2/3 per level below the top
+static int sketch_level_capacity(const QuantileSketch *sketch, int level) {
+    int depth = sketch->levels - 1 - level;
+    double capacity = ceil(sketch->k * pow(2.0 / 3.0, depth));
+    return capacity < 2 ? 2 : (int)capacity;
+}
+
+static int sketch_push(QuantileSketch *sketch, int level, double value) {
+    if (sketch->sizes[level] == sketch->capacities[level]) {
+        int capacity = sketch->capacities[level] ? sketch->capacities[level] * 2 : 8;
+        double *temp = realloc(sketch->items[level], capacity * sizeof(double));
+        if (!temp) return 0;
+        sketch->items[level] = temp;
+        sketch->capacities[level] = capacity;
+    }
+    sketch->items[level][sketch->sizes[level]++] = value;
+    return 1;
+}
+
+// Sorts a level and promotes every other item (random offset) one level up,
+// doubling its weight
+static int sketch_compact(QuantileSketch *sketch, int level) {
+    if (level + 1 >= SKETCH_MAX_LEVELS) return 1;
+    if (level + 1 == sketch->levels) sketch->levels++;
+
+    double *items = sketch->items[level];
+    int n = sketch->sizes[level];
+    qsort(items, n, sizeof(double), compare_doubles);
+
+    sketch->rng = sketch->rng * 1103515245u + 12345u;
+    int offset = (sketch->rng >> 16) & 1;
+    int paired = n - (n % 2);
+    for (int i = offset; i < paired; i += 2) {
+        if (!sketch_push(sketch, level + 1, items[i])) return 0;
+    }
+
+    // An odd item out stays behind at its current weight
+    if (n % 2) items[0] = items[n - 1];
+    sketch->sizes[level] = n % 2;
+    return 1;
+}
+
+static int sketch_compress(QuantileSketch *sketch) {
+    while (1) {
+        int total = 0, capacity = 0;
+        for (int h = 0; h < sketch->levels; h++) {
+            total += sketch->sizes[h];
+            capacity += sketch_level_capacity(sketch, h);
+        }
+        if (total <= capacity) return 1;
+
+        for (int h = 0; h < sketch->levels; h++) {
+            if (sketch->sizes[h] >= sketch_level_capacity(sketch, h)) {
+                if (!sketch_compact(sketch, h)) return 0;
+                break;
+            }
+        }
+    }
+}
+
+// epsilon is the target rank error; KLL reaches roughly 1.7/k
+int sketch_init(QuantileSketch *sketch, double epsilon) {
+    memset(sketch, 0, sizeof(*sketch));
+    if (epsilon <= 0.0 || epsilon >= 1.0) epsilon = STREAM_DEFAULT_EPSILON;
+
+    sketch->k = (int)ceil(1.7 / epsilon);
+    if (sketch->k < 8) sketch->k = 8;
+    sketch->levels = 1;
+    sketch->rng = 0x9e3779b9u;
+    return 1;
+}
+
+void sketch_free(QuantileSketch *sketch) {
+    for (int h = 0; h < SKETCH_MAX_LEVELS; h++) {
+        free(sketch->items[h]);
+        sketch->items[h] = NULL;
+        sketch->sizes[h] = 0;
+        sketch->capacities[h] = 0;
+    }
+}
+
+int sketch_add(QuantileSketch *sketch, double value) {
+    if (isnan(value)) return 1;
+    if (!sketch_push(sketch, 0, value)) return 0;
+    sketch->count++;
+    return sketch_compress(sketch);
+}
+
+int sketch_merge(QuantileSketch *into, const QuantileSketch *other) {
+    if (other->levels > into->levels) into->levels = other->levels;
+
+    for (int h = 0; h < other->levels; h++) {
+        for (int i = 0; i < other->sizes[h]; i++) {
+            if (!sketch_push(into, h, other->items[h][i])) return 0;
+        }
+    }
+    into->count += other->count;
+    return sketch_compress(into);
+}
+
+typedef struct {
+    double value;
+    double weight;
+} WeightedItem;
+
+static int compare_weighted(const void *a, const void *b) {
+    return compare_doubles(&((const WeightedItem *)a)->value, &((const WeightedItem *)b)->value);
+}
+
+double sketch_quantile(const QuantileSketch *sketch, double q) {
+    int total = 0;
+    for (int h = 0; h < sketch->levels; h++) total += sketch->sizes[h];
+    if (total == 0) return NAN;
+
+    WeightedItem *items = malloc(total * sizeof(WeightedItem));
+    if (!items) return NAN;
+
+    int n = 0;
+    double total_weight = 0.0;
+    for (int h = 0; h < sketch->levels; h++) {
+        double weight = ldexp(1.0, h);
+        for (int i = 0; i < sketch->sizes[h]; i++) {
+            items[n].value = sketch->items[h][i];
+            items[n].weight = weight;
+            total_weight += weight;
+            n++;
+        }
+    }
+    qsort(items, n, sizeof(WeightedItem), compare_weighted);
+
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    double target = q * total_weight;
+    double cumulative = 0.0;
+    double result = items[n - 1].value;
+    for (int i = 0; i < n; i++) {
+        cumulative += items[i].weight;
+        if (cumulative >= target) {
+            result = items[i].value;
+            break;
+        }
+    }
+
+    free(items);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Streaming summaries
+// ---------------------------------------------------------------------------
+
+int stream_summary_init(StreamSummary *summary, double epsilon) {
+    summary->count = 0;
+    summary->sum = 0.0;
+    summary->sum_error = 0.0;
+    summary->mean = 0.0;
+    summary->m2 = 0.0;
+    summary->min = 0.0;
+    summary->max = 0.0;
+    summary->track_quantiles = 1;
+    return sketch_init(&summary->sketch, epsilon);
+}
+
+// Exact moments only: skips the sketch, so median is unavailable
+void stream_summary_init_moments(StreamSummary *summary) {
+    stream_summary_init(summary, STREAM_DEFAULT_EPSILON);
+    summary->track_quantiles = 0;
+}
+
+void stream_summary_free(StreamSummary *summary) {
+    sketch_free(&summary->sketch);
+}
+
+// Neumaier-compensated running sum, so chunk order does not drift the total
+static void add_compensated(StreamSummary *summary, double value) {
+    double t = summary->sum + value;
+    if (fabs(summary->sum) >= fabs(value)) {
+        summary->sum_error += (summary->sum - t) + value;
+    } else {
+        summary->sum_error += (value - t) + summary->sum;
+    }
+    summary->sum = t;
+}
+
+// Chan et al. pairwise update of count, mean and sum of squared deviations
+static void merge_moments(StreamSummary *into, long long count, double mean, double m2,
+                          double min, double max) {
+    if (count == 0) return;
+    if (into->count == 0) {
+        into->count = count;
+        into->mean = mean;
+        into->m2 = m2;
+        into->min = min;
+        into->max = max;
+        return;
+    }
+
+    long long total = into->count + count;
+    double delta = mean - into->mean;
+    into->mean += delta * count / total;
+    into->m2 += m2 + delta * delta * ((double)into->count * count / total);
+    into->count = total;
+    if (min < into->min) into->min = min;
+    if (max > into->max) into->max = max;
+}
+
+// Reduces one chunk with the regular Dataset operations and folds the
+// partial results into the running summary
+int stream_summary_add_chunk(StreamSummary *summary, Dataset *chunk) {
+    if (chunk->size == 0) return 1;
+
+    double sum = compute_sum(chunk);
+    double mean = sum / chunk->size;
+    double m2 = 0.0;
+    for (int i = 0; i < chunk->size; i++) {
+        double diff = chunk->data[i] - mean;
+        m2 += diff * diff;
+    }
+
+    add_compensated(summary, sum);
+    merge_moments(summary, chunk->size, mean, m2, find_minimum(chunk), find_maximum(chunk));
+
+    if (!summary->track_quantiles) return 1;
+    for (int i = 0; i < chunk->size; i++) {
+        if (!sketch_add(&summary->sketch, chunk->data[i])) return 0;
+    }
+    return 1;
+}
+
+int stream_summary_merge(StreamSummary *into, const StreamSummary *other) {
+    add_compensated(into, other->sum);
+    add_compensated(into, other->sum_error);
+    merge_moments(into, other->count, other->mean, other->m2, other->min, other->max);
+    if (!other->track_quantiles) into->track_quantiles = 0;
+    return !into->track_quantiles || sketch_merge(&into->sketch, &other->sketch);
+}
+
+// Answers a math_operations[] entry from the merged state. Returns NAN for
+// operations that have no streaming equivalent.
+double stream_summary_result(const StreamSummary *summary, MathOperation operation) {
+    if (summary->count == 0) return 0.0;
+
+    if (operation == compute_sum) return summary->sum + summary->sum_error;
+    if (operation == compute_average) return summary->mean;
+    if (operation == find_maximum) return summary->max;
+    if (operation == find_minimum) return summary->min;
+    if (operation == compute_median) {
+        return summary->track_quantiles ? sketch_quantile(&summary->sketch, 0.5) : NAN;
+    }
+    if (operation == compute_std_deviation) {
+        return summary->count > 1 ? sqrt(summary->m2 / (summary->count - 1)) : 0.0;
+    }
+    return NAN;
+}
+
+int stream_file(const char *filename, int chunk_size, double epsilon, StreamSummary *summary) {
+    if (chunk_size <= 0) chunk_size = STREAM_DEFAULT_CHUNK;
+
+    ChunkReader reader;
+    if (!chunk_reader_open(&reader, filename)) return 0;
+
+    Dataset *chunk = create_dataset(chunk_size);
+    if (!chunk || !stream_summary_init(summary, epsilon)) {
+        free_dataset(chunk);
+        chunk_reader_close(&reader);
+        return 0;
+    }
+
+    int ok = 1;
+    while (ok && chunk_reader_next(&reader, chunk, chunk_size) > 0) {
+        ok = stream_summary_add_chunk(summary, chunk);
+    }
+
+    free_dataset(chunk);
+    chunk_reader_close(&reader);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// External merge sort
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    FILE *file;
+    double buffer[RUN_BUFFER_VALUES];
+    int size;
+    int pos;
+} RunReader;
+
+// Destination of a merge: a binary run file or the final text output
+typedef struct {
+    FILE *file;
+    int text;
+    char *buffer;
+    size_t used;
+} MergeSink;
+
+static int run_reader_fill(RunReader *run) {
+    run->size = (int)fread(run->buffer, sizeof(double), RUN_BUFFER_VALUES, run->file);
+    run->pos = 0;
+    return run->size > 0;
+}
+
+static int sink_flush(MergeSink *sink) {
+    if (sink->used == 0) return 1;
+    int ok = fwrite(sink->buffer, 1, sink->used, sink->file) == sink->used;
+    sink->used = 0;
+    return ok;
+}
+
+static int sink_put(MergeSink *sink, double value) {
+    if (sink->used > OUTPUT_BUFFER_SIZE - FORMAT_DOUBLE_MAX - 1 && !sink_flush(sink)) return 0;
+
+    if (sink->text) {
+        sink->used += format_double(value, sink->buffer + sink->used);
+        sink->buffer[sink->used++] = '\n';
+    } else {
+        memcpy(sink->buffer + sink->used, &value, sizeof(double));
+        sink->used += sizeof(double);
+    }
+    return 1;
+}
+
+static int precedes(double a, double b, int ascending) {
+    return ascending ? a < b : a > b;
+}
+
+static void heap_sift_down(int *heap, int n, int i, RunReader *runs, int ascending) {
+    while (1) {
+        int best = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < n && precedes(runs[heap[left]].buffer[runs[heap[left]].pos],
+                                 runs[heap[best]].buffer[runs[heap[best]].pos], ascending)) {
+            best = left;
+        }
+        if (right < n && precedes(runs[heap[right]].buffer[runs[heap[right]].pos],
+                                  runs[heap[best]].buffer[runs[heap[best]].pos], ascending)) {
+            best = right;
+        }
+        if (best == i) return;
+        int temp = heap[i];
+        heap[i] = heap[best];
+        heap[best] = temp;
+        i = best;
+    }
+}
+
+// k-way merges sorted binary run files into the sink; closes the runs
+static int merge_runs(FILE **files, int count, int ascending, MergeSink *sink) {
+    RunReader *runs = malloc(count * sizeof(RunReader));
+    int *heap = malloc(count * sizeof(int));
+    if (!runs || !heap) {
+        free(runs);
+        free(heap);
+        return 0;
+    }
+
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        runs[i].file = files[i];
+        rewind(files[i]);
+        if (run_reader_fill(&runs[i])) heap[n++] = i;
+    }
+    for (int i = n / 2 - 1; i >= 0; i--) heap_sift_down(heap, n, i, runs, ascending);
+
+    int ok = 1;
+    while (n > 0 && ok) {
+        RunReader *run = &runs[heap[0]];
+        ok = sink_put(sink, run->buffer[run->pos++]);
+        if (run->pos == run->size && !run_reader_fill(run)) {
+            heap[0] = heap[--n];
+        }
+        heap_sift_down(heap, n, 0, runs, ascending);
+    }
+
+    for (int i = 0; i < count; i++) fclose(files[i]);
+    free(runs);
+    free(heap);
+    return ok && sink_flush(sink);
+}
+
+static int write_run(Dataset *chunk, FILE **run) {
+    *run = tmpfile();
+    if (!*run) return 0;
+    return fwrite(chunk->data, sizeof(double), chunk->size, *run) == (size_t)chunk->size;
+}
+
+// Sorts a file larger than memory: chunks of chunk_size values are sorted
+// with the chosen sort_operations[] algorithm and spilled to temporary run
+// files, which are then merged (at most MERGE_FANIN at a time) into a text
+// file in the same format as save_to_file
+int external_sort_file(const char *input, const char *output, SortOperation sort,
+                       int ascending, int chunk_size) {
+    if (chunk_size <= 0) chunk_size = STREAM_DEFAULT_CHUNK;
+
+    ChunkReader reader;
+    if (!chunk_reader_open(&reader, input)) return 0;
+
+    Dataset *chunk = create_dataset(chunk_size);
+    FILE **runs = NULL;
+    int run_count = 0, run_capacity = 0;
+    int ok = chunk != NULL;
+
+    while (ok && chunk_reader_next(&reader, chunk, chunk_size) > 0) {
+        if (run_count == run_capacity) {
+            run_capacity = run_capacity ? run_capacity * 2 : 16;
+            FILE **temp = realloc(runs, run_capacity * sizeof(FILE *));
+            if (!temp) {
+                ok = 0;
+                break;
+            }
+            runs = temp;
+        }
+        sort(chunk, ascending);
+        ok = write_run(chunk, &runs[run_count]);
+        if (runs[run_count]) run_count++;
+    }
+    free_dataset(chunk);
+    chunk_reader_close(&reader);
+
+    char *buffer = malloc(OUTPUT_BUFFER_SIZE);
+    if (!buffer) ok = 0;
+
+    // Reduce the number of runs until one final merge fits the fan-in
+    while (ok && run_count > MERGE_FANIN) {
+        int merged = 0;
+        for (int i = 0; i < run_count && ok; i += MERGE_FANIN) {
+            int group = run_count - i < MERGE_FANIN ? run_count - i : MERGE_FANIN;
+            MergeSink sink = {tmpfile(), 0, buffer, 0};
+            if (!sink.file) {
+                ok = 0;
+                break;
+            }
+            ok = merge_runs(&runs[i], group, ascending, &sink);
+            for (int j = i; j < i + group; j++) runs[j] = NULL;
+            runs[merged++] = sink.file;
+        }
+        run_count = merged;
+    }
+
+    if (ok) {
+        MergeSink sink = {fopen(output, "w"), 1, buffer, 0};
+        if (sink.file) {
+            ok = merge_runs(runs, run_count, ascending, &sink);
+            if (fclose(sink.file) != 0) ok = 0;
+            run_count = 0;
+        } else {
+            ok = 0;
+        }
+    }
+
+    for (int i = 0; i < run_count; i++) {
+        if (runs[i]) fclose(runs[i]);
+    }
+    free(runs);
+    free(buffer);
+    return ok;
+}
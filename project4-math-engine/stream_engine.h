@@ -0,0 +1,70 @@
+#ifndef STREAM_ENGINE_H
+#define STREAM_ENGINE_H
+
+#include "math_engine.h"
+
+#define STREAM_DEFAULT_CHUNK (1 << 20)
+#define STREAM_DEFAULT_EPSILON 0.01
+#define SKETCH_MAX_LEVELS 48
+
+// Reads whitespace-separated numbers from a file (or stdin for "-")
+// in bounded-size pieces
+typedef struct {
+    FILE *file;
+    char *buffer;
+    size_t start;
+    size_t end;
+    int eof;
+    int done;
+} ChunkReader;
+
+// KLL quantile sketch: level h holds items of weight 2^h
+typedef struct {
+    double *items[SKETCH_MAX_LEVELS];
+    int sizes[SKETCH_MAX_LEVELS];
+    int capacities[SKETCH_MAX_LEVELS];
+    int levels;
+    int k;
+    long long count;
+    unsigned int rng;
+} QuantileSketch;
+
+// Exactly mergeable moments plus an approximate quantile sketch
+typedef struct {
+    long long count;
+    double sum;
+    double sum_error;
+    double mean;
+    double m2;
+    double min;
+    double max;
+    int track_quantiles;    // 0 when only the moments are needed
+    QuantileSketch sketch;
+} StreamSummary;
+
+// Chunk reading
+int chunk_reader_open(ChunkReader *reader, const char *filename);
+int chunk_reader_next(ChunkReader *reader, Dataset *chunk, int max_values);
+void chunk_reader_close(ChunkReader *reader);
+
+// Quantile sketch
+int sketch_init(QuantileSketch *sketch, double epsilon);
+void sketch_free(QuantileSketch *sketch);
+int sketch_add(QuantileSketch *sketch, double value);
+int sketch_merge(QuantileSketch *into, const QuantileSketch *other);
+double sketch_quantile(const QuantileSketch *sketch, double q);
+
+// Streaming summaries
+int stream_summary_init(StreamSummary *summary, double epsilon);
+void stream_summary_init_moments(StreamSummary *summary);
+void stream_summary_free(StreamSummary *summary);
+int stream_summary_add_chunk(StreamSummary *summary, Dataset *chunk);
+int stream_summary_merge(StreamSummary *into, const StreamSummary *other);
+double stream_summary_result(const StreamSummary *summary, MathOperation operation);
+int stream_file(const char *filename, int chunk_size, double epsilon, StreamSummary *summary);
+
+// Out-of-core sorting
+int external_sort_file(const char *input, const char *output, SortOperation sort,
+                       int ascending, int chunk_size);
+
+#endif
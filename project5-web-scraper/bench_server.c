@@ -0,0 +1,272 @@
+#include "bench_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define REQUEST_BUFFER 4096
+
+typedef struct {
+    char request[REQUEST_BUFFER];
+    size_t request_len;
+    size_t request_end;     // End of the request being answered, 0 if none
+    size_t sent;            // Bytes of header + body written so far
+    long long due_ms;       // When a delayed response may start
+    int waiting;            // Delayed and not yet started
+    int response;           // RESPONSE_* kind of the current answer
+} Connection;
+
+enum { RESPONSE_OK, RESPONSE_NOT_MODIFIED, RESPONSE_UNAVAILABLE, RESPONSE_KINDS };
+
+typedef struct {
+    const BenchServerConfig *config;
+    int epoll_fd;
+    int max_fd;
+    Connection *connections[BENCH_SERVER_MAX_FDS];
+    char headers[RESPONSE_KINDS][160];
+    size_t header_len[RESPONSE_KINDS];
+    char *body;
+    unsigned long served;   // Responses decided so far, for fail_every
+} BenchServer;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+int bench_server_listen(int *port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short)*port);
+    socklen_t len = sizeof(addr);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4096) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        close(fd);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void close_connection(BenchServer *server, int fd) {
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    free(server->connections[fd]);
+    server->connections[fd] = NULL;
+}
+
+static void watch(BenchServer *server, int fd, unsigned int events) {
+    struct epoll_event event = {0};
+    event.events = events;
+    event.data.fd = fd;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, fd, &event);
+}
+
+// Marks the next complete request in the buffer as being answered
+static void next_request(BenchServer *server, Connection *conn) {
+    conn->request_end = 0;
+    conn->sent = 0;
+    conn->request[conn->request_len] = '\0';
+    char *end = strstr(conn->request, "\r\n\r\n");
+    if (!end) return;
+
+    conn->request_end = (size_t)(end - conn->request) + 4;
+    conn->waiting = server->config->delay_ms > 0;
+    conn->due_ms = now_ms() + server->config->delay_ms;
+
+    // Only this request's headers count
+    *end = '\0';
+    server->served++;
+    if (server->config->fail_every > 0 && server->served % server->config->fail_every == 0) {
+        conn->response = RESPONSE_UNAVAILABLE;
+    } else if (strstr(conn->request, "\r\nIf-None-Match:") || strstr(conn->request, "\r\nif-none-match:")) {
+        conn->response = RESPONSE_NOT_MODIFIED;
+    } else {
+        conn->response = RESPONSE_OK;
+    }
+}
+
+// Writes as much of the current response as the socket takes; returns 0
+// if the connection failed
+static int send_response(BenchServer *server, int fd, Connection *conn) {
+    char *header = server->headers[conn->response];
+    size_t header_len = server->header_len[conn->response];
+    size_t body_size = conn->response == RESPONSE_OK ? server->config->body_size : 0;
+    size_t total = header_len + body_size;
+    while (conn->sent < total) {
+        struct iovec parts[2];
+        int count = 0;
+        if (conn->sent < header_len) {
+            parts[count].iov_base = header + conn->sent;
+            parts[count++].iov_len = header_len - conn->sent;
+            parts[count].iov_base = server->body;
+            parts[count++].iov_len = body_size;
+        } else {
+            size_t offset = conn->sent - header_len;
+            parts[count].iov_base = server->body + offset;
+            parts[count++].iov_len = body_size - offset;
+        }
+
+        ssize_t written = writev(fd, parts, count);
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                watch(server, fd, EPOLLOUT);
+                return 1;
+            }
+            return 0;
+        }
+        conn->sent += (size_t)written;
+    }
+
+    // Done: drop the answered request and look for a pipelined one
+    memmove(conn->request, conn->request + conn->request_end, conn->request_len - conn->request_end);
+    conn->request_len -= conn->request_end;
+    next_request(server, conn);
+    if (conn->request_end && !conn->waiting) return send_response(server, fd, conn);
+    watch(server, fd, EPOLLIN);
+    return 1;
+}
+
+static void handle_readable(BenchServer *server, int fd) {
+    Connection *conn = server->connections[fd];
+    ssize_t received = read(fd, conn->request + conn->request_len, REQUEST_BUFFER - 1 - conn->request_len);
+    if (received <= 0) {
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        close_connection(server, fd);
+        return;
+    }
+    conn->request_len += (size_t)received;
+
+    if (conn->request_end == 0) {
+        next_request(server, conn);
+        if (conn->request_end == 0 && conn->request_len == REQUEST_BUFFER - 1) {
+            close_connection(server, fd);
+            return;
+        }
+        if (conn->request_end && !conn->waiting && !send_response(server, fd, conn)) {
+            close_connection(server, fd);
+        }
+    }
+}
+
+static void accept_connections(BenchServer *server, int listen_fd) {
+    while (1) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) return;
+        if (fd >= BENCH_SERVER_MAX_FDS) {
+            close(fd);
+            continue;
+        }
+        Connection *conn = calloc(1, sizeof(Connection));
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        set_nonblocking(fd);
+        server->connections[fd] = conn;
+        if (fd > server->max_fd) server->max_fd = fd;
+
+        struct epoll_event event = {0};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+// Starts delayed responses that are due; returns the wait until the next
+static int start_due_responses(BenchServer *server) {
+    long long now = now_ms();
+    long long next = -1;
+    for (int fd = 0; fd <= server->max_fd; fd++) {
+        Connection *conn = server->connections[fd];
+        if (!conn || !conn->waiting) continue;
+        if (conn->due_ms <= now) {
+            conn->waiting = 0;
+            if (!send_response(server, fd, conn)) close_connection(server, fd);
+        } else if (next < 0 || conn->due_ms < next) {
+            next = conn->due_ms;
+        }
+    }
+    return next < 0 ? -1 : (int)(next - now);
+}
+
+int run_bench_server(int listen_fd, const BenchServerConfig *config) {
+    BenchServer *server = calloc(1, sizeof(BenchServer));
+    if (!server) return 0;
+    server->config = config;
+    server->body = malloc(config->body_size > 0 ? config->body_size : 1);
+    server->epoll_fd = epoll_create1(0);
+    if (!server->body || server->epoll_fd < 0) return 0;
+
+    memset(server->body, 'x', config->body_size);
+    size_t offset = 0;
+    for (int i = 0; i < config->links; i++) {
+        char link[32];
+        int length = snprintf(link, sizeof(link), "<a href=\"%d/\">%d</a>\n", i, i);
+        if (offset + (size_t)length > config->body_size) break;
+        memcpy(server->body + offset, link, (size_t)length);
+        offset += (size_t)length;
+    }
+    server->header_len[RESPONSE_OK] = (size_t)snprintf(
+        server->headers[RESPONSE_OK], sizeof(server->headers[RESPONSE_OK]),
+        "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nETag: \"bench-%zu\"\r\n"
+        "Content-Length: %zu\r\n\r\n", config->body_size, config->body_size);
+    server->header_len[RESPONSE_NOT_MODIFIED] = (size_t)snprintf(
+        server->headers[RESPONSE_NOT_MODIFIED], sizeof(server->headers[RESPONSE_NOT_MODIFIED]),
+        "HTTP/1.1 304 Not Modified\r\nETag: \"bench-%zu\"\r\n\r\n", config->body_size);
+    server->header_len[RESPONSE_UNAVAILABLE] = (size_t)snprintf(
+        server->headers[RESPONSE_UNAVAILABLE], sizeof(server->headers[RESPONSE_UNAVAILABLE]),
+        "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+
+    set_nonblocking(listen_fd);
+    struct epoll_event event = {0};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+
+    struct epoll_event events[256];
+    int timeout = -1;
+    while (1) {
+        int ready = epoll_wait(server->epoll_fd, events, 256, timeout);
+        if (ready < 0 && errno != EINTR) return 0;
+
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd) {
+                accept_connections(server, listen_fd);
+                continue;
+            }
+            if (!server->connections[fd]) continue;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close_connection(server, fd);
+            } else if (events[i].events & EPOLLOUT) {
+                if (!send_response(server, fd, server->connections[fd])) close_connection(server, fd);
+            } else {
+                handle_readable(server, fd);
+            }
+        }
+        timeout = start_due_responses(server);
+    }
+}
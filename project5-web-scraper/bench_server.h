@@ -0,0 +1,27 @@
+#ifndef BENCH_SERVER_H
+#define BENCH_SERVER_H
+
+#include <stddef.h>
+
+#define BENCH_SERVER_MAX_FDS 65536
+
+// Minimal HTTP/1.1 stand-in for benchmarks: every GET gets a fixed-size
+// 200 response after an optional delay, and connections are kept alive.
+// The body carries a constant ETag, so conditional requests get a 304.
+// With `links`, every page starts with relative links "0/", "1/", ... so a
+// crawl from "/" unfolds into a tree with that many children per page.
+typedef struct {
+    size_t body_size;
+    int delay_ms;           // Simulated server latency per request
+    int fail_every;         // Every Nth response is a 503, 0 for none
+    int links;              // Links at the top of each page, 0 for none
+} BenchServerConfig;
+
+// Binds a listening socket on 127.0.0.1; *port receives the chosen port
+// when it is 0. Returns the socket, or -1.
+int bench_server_listen(int *port);
+
+// Serves requests on the listening socket until the process is killed
+int run_bench_server(int listen_fd, const BenchServerConfig *config);
+
+#endif
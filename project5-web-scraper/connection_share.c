@@ -0,0 +1,44 @@
+#include "connection_share.h"
+
+static void lock_share(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+    ConnectionShare *share = userptr;
+    (void)handle;
+    (void)access;
+    pthread_mutex_lock(&share->locks[data]);
+}
+
+static void unlock_share(CURL *handle, curl_lock_data data, void *userptr) {
+    ConnectionShare *share = userptr;
+    (void)handle;
+    pthread_mutex_unlock(&share->locks[data]);
+}
+
+int connection_share_init(ConnectionShare *share) {
+    share->share = curl_share_init();
+    if (!share->share) return 0;
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&share->locks[i], NULL);
+    }
+
+    curl_share_setopt(share->share, CURLSHOPT_LOCKFUNC, lock_share);
+    curl_share_setopt(share->share, CURLSHOPT_UNLOCKFUNC, unlock_share);
+    curl_share_setopt(share->share, CURLSHOPT_USERDATA, share);
+    curl_share_setopt(share->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(share->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    return 1;
+}
+
+void connection_share_destroy(ConnectionShare *share) {
+    if (!share->share) return;
+    curl_share_cleanup(share->share);
+    share->share = NULL;
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_destroy(&share->locks[i]);
+    }
+}
+
+void connection_share_attach(ConnectionShare *share, CURL *curl) {
+    if (share->share) curl_easy_setopt(curl, CURLOPT_SHARE, share->share);
+}
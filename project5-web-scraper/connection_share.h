@@ -0,0 +1,24 @@
+#ifndef CONNECTION_SHARE_H
+#define CONNECTION_SHARE_H
+
+#include <pthread.h>
+#include <curl/curl.h>
+
+// One curl_share object for every handle of a scraper: the DNS cache,
+// the connection pool and TLS sessions outlive individual transfers, so
+// repeated fetches from one host skip the lookup and handshakes. Each
+// shared cache is guarded by its own mutex.
+typedef struct {
+    CURLSH *share;
+    pthread_mutex_t locks[CURL_LOCK_DATA_LAST];
+} ConnectionShare;
+
+// curl_global_init must have been called. Returns 0 on failure.
+int connection_share_init(ConnectionShare *share);
+
+// Every handle attached to the share must have been cleaned up
+void connection_share_destroy(ConnectionShare *share);
+
+void connection_share_attach(ConnectionShare *share, CURL *curl);
+
+#endif
@@ -0,0 +1,263 @@
+#include "host_scheduler.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void url_origin(const char *url, char *host, size_t size) {
+    const char *authority = strstr(url, "://");
+    authority = authority ? authority + 3 : url;
+    size_t end = strcspn(authority, "/?#");
+
+    // Credentials do not make a different origin
+    const char *at = memchr(authority, '@', end);
+    size_t scheme = (size_t)(authority - url);
+    if (at) {
+        end -= (size_t)(at + 1 - authority);
+        authority = at + 1;
+    }
+
+    size_t length = 0;
+    for (size_t i = 0; i < scheme && length + 1 < size; i++) {
+        host[length++] = (char)tolower((unsigned char)url[i]);
+    }
+    for (size_t i = 0; i < end && length + 1 < size; i++) {
+        host[length++] = (char)tolower((unsigned char)authority[i]);
+    }
+    host[length] = '\0';
+}
+
+static size_t hash_name(const char *name) {
+    size_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+int host_scheduler_init(HostScheduler *scheduler, int jobs, int max_per_host, double rate) {
+    memset(scheduler, 0, sizeof(*scheduler));
+    size_t slots = 16;
+    if (jobs < 1) jobs = 1;
+
+    scheduler->host_of = malloc(jobs * sizeof(int));
+    scheduler->next_job = malloc(jobs * sizeof(int));
+    scheduler->table = malloc(slots * sizeof(int));
+    if (!scheduler->host_of || !scheduler->next_job || !scheduler->table) {
+        free(scheduler->host_of);
+        free(scheduler->next_job);
+        free(scheduler->table);
+        memset(scheduler, 0, sizeof(*scheduler));
+        return 0;
+    }
+
+    memset(scheduler->table, -1, slots * sizeof(int));
+    scheduler->table_mask = slots - 1;
+    scheduler->job_capacity = jobs;
+    scheduler->max_per_host = max_per_host;
+    scheduler->rate = rate;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&scheduler->changed, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&scheduler->lock, NULL);
+    return 1;
+}
+
+void host_scheduler_destroy(HostScheduler *scheduler) {
+    if (!scheduler->table) return;
+    pthread_mutex_destroy(&scheduler->lock);
+    pthread_cond_destroy(&scheduler->changed);
+    free(scheduler->hosts);
+    free(scheduler->host_of);
+    free(scheduler->next_job);
+    free(scheduler->active);
+    free(scheduler->table);
+    memset(scheduler, 0, sizeof(*scheduler));
+}
+
+// Doubles the host index once it is half full
+static int grow_table(HostScheduler *scheduler) {
+    size_t slots = (scheduler->table_mask + 1) * 2;
+    int *table = malloc(slots * sizeof(int));
+    if (!table) return 0;
+    memset(table, -1, slots * sizeof(int));
+    for (int i = 0; i < scheduler->host_count; i++) {
+        size_t slot = hash_name(scheduler->hosts[i].name) & (slots - 1);
+        while (table[slot] >= 0) slot = (slot + 1) & (slots - 1);
+        table[slot] = i;
+    }
+    free(scheduler->table);
+    scheduler->table = table;
+    scheduler->table_mask = slots - 1;
+    return 1;
+}
+
+// Index of the host named `name`, added if new; -1 if out of memory
+static int find_host(HostScheduler *scheduler, const char *name) {
+    size_t slot = hash_name(name) & scheduler->table_mask;
+    while (scheduler->table[slot] >= 0) {
+        if (strcmp(scheduler->hosts[scheduler->table[slot]].name, name) == 0) return scheduler->table[slot];
+        slot = (slot + 1) & scheduler->table_mask;
+    }
+
+    if (scheduler->host_count == scheduler->host_capacity) {
+        int capacity = scheduler->host_capacity ? scheduler->host_capacity * 2 : 16;
+        HostQueue *hosts = realloc(scheduler->hosts, capacity * sizeof(HostQueue));
+        if (!hosts) return -1;
+        scheduler->hosts = hosts;
+        int *active = realloc(scheduler->active, capacity * sizeof(int));
+        if (!active) return -1;
+        scheduler->active = active;
+        scheduler->host_capacity = capacity;
+    }
+    if ((size_t)(scheduler->host_count + 1) * 2 > scheduler->table_mask + 1) {
+        if (!grow_table(scheduler)) return -1;
+        slot = hash_name(name) & scheduler->table_mask;
+        while (scheduler->table[slot] >= 0) slot = (slot + 1) & scheduler->table_mask;
+    }
+
+    int index = scheduler->host_count++;
+    HostQueue *host = &scheduler->hosts[index];
+    strcpy(host->name, name);
+    host->head = host->tail = -1;
+    host->in_flight = 0;
+    host->tokens = HOST_RATE_BURST;
+    host->refilled_at = monotonic_seconds();
+    scheduler->table[slot] = index;
+    return index;
+}
+
+// Makes room for job indices up to `job`
+static int reserve_jobs(HostScheduler *scheduler, int job) {
+    if (job < scheduler->job_capacity) return 1;
+    int capacity = scheduler->job_capacity * 2;
+    while (capacity <= job) capacity *= 2;
+    int *host_of = realloc(scheduler->host_of, capacity * sizeof(int));
+    if (!host_of) return 0;
+    scheduler->host_of = host_of;
+    int *next_job = realloc(scheduler->next_job, capacity * sizeof(int));
+    if (!next_job) return 0;
+    scheduler->next_job = next_job;
+    scheduler->job_capacity = capacity;
+    return 1;
+}
+
+int host_scheduler_add(HostScheduler *scheduler, int job, const char *url) {
+    char name[MAX_HOST_LENGTH];
+    url_origin(url, name, sizeof(name));
+
+    pthread_mutex_lock(&scheduler->lock);
+    int index = reserve_jobs(scheduler, job) ? find_host(scheduler, name) : -1;
+    if (index < 0) {
+        pthread_mutex_unlock(&scheduler->lock);
+        return 0;
+    }
+    HostQueue *host = &scheduler->hosts[index];
+
+    scheduler->host_of[job] = index;
+    scheduler->next_job[job] = -1;
+    if (host->head < 0) {
+        host->head = job;
+        scheduler->active[scheduler->active_count++] = index;
+    } else {
+        scheduler->next_job[host->tail] = job;
+    }
+    host->tail = job;
+    scheduler->remaining++;
+    pthread_cond_signal(&scheduler->changed);
+    pthread_mutex_unlock(&scheduler->lock);
+    return 1;
+}
+
+// Caller holds the lock
+static int poll_locked(HostScheduler *scheduler, int *job, long *wait_ms) {
+    if (scheduler->remaining == 0 && scheduler->in_flight == 0) return -1;
+
+    double now = monotonic_seconds();
+    double wait = -1.0;
+    for (int k = 0; k < scheduler->active_count; k++) {
+        int position = (scheduler->cursor + k) % scheduler->active_count;
+        HostQueue *host = &scheduler->hosts[scheduler->active[position]];
+        if (scheduler->max_per_host > 0 && host->in_flight >= scheduler->max_per_host) continue;
+
+        if (scheduler->rate > 0) {
+            host->tokens += (now - host->refilled_at) * scheduler->rate;
+            if (host->tokens > HOST_RATE_BURST) host->tokens = HOST_RATE_BURST;
+            host->refilled_at = now;
+            if (host->tokens < 1.0) {
+                double until = (1.0 - host->tokens) / scheduler->rate;
+                if (wait < 0 || until < wait) wait = until;
+                continue;
+            }
+            host->tokens -= 1.0;
+        }
+
+        *job = host->head;
+        host->head = scheduler->next_job[*job];
+        host->in_flight++;
+        scheduler->in_flight++;
+        scheduler->remaining--;
+
+        // A drained host leaves the rotation; the next host moves into its place
+        if (host->head < 0) {
+            scheduler->active[position] = scheduler->active[--scheduler->active_count];
+            scheduler->cursor = position;
+        } else {
+            scheduler->cursor = position + 1;
+        }
+        if (scheduler->cursor >= scheduler->active_count) scheduler->cursor = 0;
+        return 1;
+    }
+
+    *wait_ms = wait < 0 ? -1 : (long)(wait * 1000) + 1;
+    return 0;
+}
+
+int host_scheduler_poll(HostScheduler *scheduler, int *job, long *wait_ms) {
+    pthread_mutex_lock(&scheduler->lock);
+    int result = poll_locked(scheduler, job, wait_ms);
+    pthread_mutex_unlock(&scheduler->lock);
+    return result;
+}
+
+int host_scheduler_take(HostScheduler *scheduler, int *job) {
+    long wait_ms;
+    int result;
+
+    pthread_mutex_lock(&scheduler->lock);
+    while ((result = poll_locked(scheduler, job, &wait_ms)) == 0) {
+        if (wait_ms < 0) {
+            pthread_cond_wait(&scheduler->changed, &scheduler->lock);
+            continue;
+        }
+        struct timespec until;
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        until.tv_sec += wait_ms / 1000;
+        until.tv_nsec += (wait_ms % 1000) * 1000000;
+        if (until.tv_nsec >= 1000000000) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&scheduler->changed, &scheduler->lock, &until);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+    return result == 1;
+}
+
+void host_scheduler_done(HostScheduler *scheduler, int job) {
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->hosts[scheduler->host_of[job]].in_flight--;
+    scheduler->in_flight--;
+    pthread_cond_signal(&scheduler->changed);
+    pthread_mutex_unlock(&scheduler->lock);
+}
@@ -0,0 +1,69 @@
+#ifndef HOST_SCHEDULER_H
+#define HOST_SCHEDULER_H
+
+#include <pthread.h>
+
+#define MAX_HOST_LENGTH 256
+#define HOST_RATE_BURST 1.0     // Tokens a host can save up: no bursts, a steady rate
+
+// Pending jobs of one origin (scheme://host:port)
+typedef struct {
+    char name[MAX_HOST_LENGTH];
+    int head;               // First pending job, -1 when drained
+    int tail;
+    int in_flight;          // Handed out and not yet done
+    double tokens;          // Token bucket for the request rate
+    double refilled_at;
+} HostQueue;
+
+// Hands out jobs so that each host sees at most max_per_host requests at
+// once and at most `rate` new requests per second, cycling through the
+// hosts so one large host cannot starve the others while the rest of
+// the pipeline stays busy. Safe to share between threads.
+typedef struct {
+    HostQueue *hosts;
+    int host_count;
+    int host_capacity;
+    int *host_of;           // Job -> host index
+    int *next_job;          // Job -> next pending job of the same host
+    int job_capacity;       // Room in host_of[] and next_job[]
+    int *table;             // Open-addressing index of hosts by name, -1 if empty
+    size_t table_mask;
+    int *active;            // Hosts with pending jobs, in rotation order
+    int active_count;
+    int cursor;             // Position in active[] to try first
+    int remaining;          // Jobs not handed out yet
+    int in_flight;          // Jobs handed out and not done, over all hosts
+    int max_per_host;       // 0 for no limit
+    double rate;            // Requests per second per host, 0 for no limit
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // Signalled when a job finishes
+} HostScheduler;
+
+// Room for job indices 0..jobs-1 to start with; returns 0 on allocation failure
+int host_scheduler_init(HostScheduler *scheduler, int jobs, int max_per_host, double rate);
+
+// Also safe on a scheduler whose init failed or that was zeroed
+void host_scheduler_destroy(HostScheduler *scheduler);
+
+// Queues a job behind the earlier jobs of its host, growing the tables
+// as needed. Thread-safe, so running jobs can add the links they find;
+// returns 0 if out of memory.
+int host_scheduler_add(HostScheduler *scheduler, int job, const char *url);
+
+// Non-blocking: returns 1 with *job set, 0 if every remaining host is at
+// its limit or only running jobs are left (*wait_ms is the time until the
+// next token, or -1 if only a finishing job can help), and -1 once every
+// job has been handed out and finished, so none can add more
+int host_scheduler_poll(HostScheduler *scheduler, int *job, long *wait_ms);
+
+// Blocking: waits for an eligible job; returns 0 once all are finished
+int host_scheduler_take(HostScheduler *scheduler, int *job);
+
+// Reports a handed-out job as finished
+void host_scheduler_done(HostScheduler *scheduler, int job);
+
+// Copies the origin of `url` into `host` (scheme://host[:port], lowercase)
+void url_origin(const char *url, char *host, size_t size);
+
+#endif
@@ -0,0 +1,167 @@
+#include "http_cache.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define COPY_BUFFER 16384
+
+static void entry_path(const char *dir, const char *url, const char *suffix, char *path) {
+    unsigned long long hash = 14695981039346656037ull;
+    for (const char *c = url; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
+    }
+    snprintf(path, MAX_CACHE_PATH, "%s/%016llx.%s", dir, hash, suffix);
+}
+
+int http_cache_open(const char *dir) {
+    return mkdir(dir, 0755) == 0 || errno == EEXIST;
+}
+
+static int copy_stream(FILE *in, FILE *out) {
+    char buffer[COPY_BUFFER];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, read, out) != read) return 0;
+    }
+    return !ferror(in);
+}
+
+// Strips the line break fgets keeps
+static void chomp(char *line) {
+    line[strcspn(line, "\r\n")] = '\0';
+}
+
+static void copy_value(char *value, const char *text) {
+    size_t length = strlen(text);
+    if (length >= MAX_VALIDATOR_LENGTH) length = MAX_VALIDATOR_LENGTH - 1;
+    memcpy(value, text, length);
+    value[length] = '\0';
+}
+
+int http_cache_lookup(const char *dir, const char *url, CacheValidators *validators) {
+    char path[MAX_CACHE_PATH];
+    char line[1024];
+
+    validators->etag[0] = '\0';
+    validators->last_modified[0] = '\0';
+
+    entry_path(dir, url, "meta", path);
+    FILE *meta = fopen(path, "r");
+    if (!meta) return 0;
+
+    // The first line guards against hash collisions
+    int found = fgets(line, sizeof(line), meta) != NULL;
+    if (found) {
+        chomp(line);
+        found = strcmp(line, url) == 0;
+    }
+    while (found && fgets(line, sizeof(line), meta)) {
+        chomp(line);
+        if (strncmp(line, "etag: ", 6) == 0) {
+            copy_value(validators->etag, line + 6);
+        } else if (strncmp(line, "last-modified: ", 15) == 0) {
+            copy_value(validators->last_modified, line + 15);
+        }
+    }
+    fclose(meta);
+
+    entry_path(dir, url, "body", path);
+    return found && (validators->etag[0] || validators->last_modified[0]) && access(path, R_OK) == 0;
+}
+
+// Opens a temporary file in the cache directory
+static FILE* open_temp(const char *dir, char *path) {
+    snprintf(path, MAX_CACHE_PATH, "%s/tmp.XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    FILE *file = fdopen(fd, "wb");
+    if (!file) {
+        close(fd);
+        unlink(path);
+    }
+    return file;
+}
+
+// Moves a finished temporary file into place; `ok` says whether writing it worked
+static int commit_temp(FILE *file, const char *temp, const char *path, int ok) {
+    if (fclose(file) != 0) ok = 0;
+    if (ok && rename(temp, path) == 0) return 1;
+    unlink(temp);
+    return 0;
+}
+
+static int store_meta(const char *dir, const char *url, const CacheValidators *validators) {
+    char temp[MAX_CACHE_PATH];
+    char path[MAX_CACHE_PATH];
+
+    FILE *meta = open_temp(dir, temp);
+    if (!meta) return 0;
+    int ok = fprintf(meta, "%s\n", url) > 0;
+    if (validators->etag[0]) ok = ok && fprintf(meta, "etag: %s\n", validators->etag) > 0;
+    if (validators->last_modified[0]) {
+        ok = ok && fprintf(meta, "last-modified: %s\n", validators->last_modified) > 0;
+    }
+
+    entry_path(dir, url, "meta", path);
+    return commit_temp(meta, temp, path, ok);
+}
+
+int http_cache_store_file(const char *dir, const char *url, const CacheValidators *validators,
+                          const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (!in) return 0;
+    int ok = http_cache_store_stream(dir, url, validators, in);
+    fclose(in);
+    return ok;
+}
+
+int http_cache_store_stream(const char *dir, const char *url, const CacheValidators *validators,
+                            FILE *in) {
+    char temp[MAX_CACHE_PATH];
+    char body_path[MAX_CACHE_PATH];
+
+    FILE *body = open_temp(dir, temp);
+    if (!body) return 0;
+    int ok = fseek(in, 0, SEEK_SET) == 0 && copy_stream(in, body);
+
+    entry_path(dir, url, "body", body_path);
+    return commit_temp(body, temp, body_path, ok) && store_meta(dir, url, validators);
+}
+
+int http_cache_store_data(const char *dir, const char *url, const CacheValidators *validators,
+                          const char *data, size_t size) {
+    char temp[MAX_CACHE_PATH];
+    char body_path[MAX_CACHE_PATH];
+
+    FILE *body = open_temp(dir, temp);
+    if (!body) return 0;
+    int ok = size == 0 || fwrite(data, 1, size, body) == size;
+
+    entry_path(dir, url, "body", body_path);
+    return commit_temp(body, temp, body_path, ok) && store_meta(dir, url, validators);
+}
+
+FILE* http_cache_open_body(const char *dir, const char *url) {
+    char body_path[MAX_CACHE_PATH];
+    entry_path(dir, url, "body", body_path);
+    return fopen(body_path, "rb");
+}
+
+int http_cache_restore(const char *dir, const char *url, const char *path) {
+    FILE *in = http_cache_open_body(dir, url);
+    if (!in) return 0;
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        fclose(in);
+        return 0;
+    }
+    int ok = copy_stream(in, out);
+    fclose(in);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) remove(path);
+    return ok;
+}
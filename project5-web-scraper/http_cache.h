@@ -0,0 +1,42 @@
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define MAX_VALIDATOR_LENGTH 128
+#define MAX_CACHE_PATH 512
+
+// Validators of a stored response, sent back as If-None-Match and
+// If-Modified-Since; empty strings when the server sent none
+typedef struct {
+    char etag[MAX_VALIDATOR_LENGTH];
+    char last_modified[MAX_VALIDATOR_LENGTH];
+} CacheValidators;
+
+// On-disk cache keyed by URL: <dir>/<hash>.meta holds the URL and its
+// validators, <dir>/<hash>.body the last 200 body. Entries are replaced
+// through rename(), so concurrent workers never see half-written files.
+
+// Creates the directory if needed; returns 0 if it cannot be used
+int http_cache_open(const char *dir);
+
+// Returns 1 with the validators if an entry for `url` has a body
+int http_cache_lookup(const char *dir, const char *url, CacheValidators *validators);
+
+// Stores a body from a file, an open stream (read from its start) or
+// memory; returns 0 on failure
+int http_cache_store_file(const char *dir, const char *url, const CacheValidators *validators,
+                          const char *path);
+int http_cache_store_stream(const char *dir, const char *url, const CacheValidators *validators,
+                            FILE *in);
+int http_cache_store_data(const char *dir, const char *url, const CacheValidators *validators,
+                          const char *data, size_t size);
+
+// Copies the cached body of `url` to `path` (after a 304)
+int http_cache_restore(const char *dir, const char *url, const char *path);
+
+// Opens the cached body of `url` for reading, NULL if there is none
+FILE* http_cache_open_body(const char *dir, const char *url);
+
+#endif
@@ -0,0 +1,143 @@
+#include "job_store.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Reallocates one result array to `capacity` entries
+static int grow_array(void **array, size_t element, int capacity) {
+    void *grown = realloc(*array, element * (size_t)capacity);
+    if (!grown) return 0;
+    *array = grown;
+    return 1;
+}
+
+static int reserve_jobs(JobStore *store, int capacity) {
+    if (capacity <= store->capacity) return 1;
+    int ok = grow_array((void **)&store->urls, sizeof(*store->urls), capacity) &&
+             grow_array((void **)&store->status, sizeof(*store->status), capacity) &&
+             grow_array((void **)&store->seconds, sizeof(*store->seconds), capacity) &&
+             grow_array((void **)&store->phases, sizeof(*store->phases), capacity) &&
+             grow_array((void **)&store->bytes, sizeof(*store->bytes), capacity) &&
+             grow_array((void **)&store->new_connections, sizeof(*store->new_connections), capacity) &&
+             grow_array((void **)&store->retries, sizeof(*store->retries), capacity) &&
+             grow_array((void **)&store->flags, sizeof(*store->flags), capacity) &&
+             grow_array((void **)&store->depths, sizeof(*store->depths), capacity);
+    // Arrays that did grow are still valid at the old capacity
+    if (ok) store->capacity = capacity;
+    return ok;
+}
+
+int job_store_init(JobStore *store, int capacity) {
+    memset(store, 0, sizeof(*store));
+    if (!reserve_jobs(store, capacity > 0 ? capacity : INITIAL_JOB_CAPACITY)) {
+        job_store_free(store);
+        return 0;
+    }
+    return 1;
+}
+
+void job_store_clear(JobStore *store) {
+    for (int i = 0; i < store->block_count; i++) {
+        free(store->blocks[i]);
+    }
+    store->block_count = 0;
+    store->block_used = 0;
+    store->block_size = 0;
+    store->count = 0;
+}
+
+JobStoreMark job_store_mark(const JobStore *store) {
+    JobStoreMark mark = {store->count, store->block_count, store->block_used, store->block_size};
+    return mark;
+}
+
+void job_store_rewind(JobStore *store, const JobStoreMark *mark) {
+    if (mark->count >= store->count) return;
+    // Blocks are only ever appended, so the ones after the mark hold
+    // nothing but URLs of dropped jobs
+    for (int i = mark->block_count; i < store->block_count; i++) {
+        free(store->blocks[i]);
+    }
+    store->block_count = mark->block_count;
+    store->block_used = mark->block_used;
+    store->block_size = mark->block_size;
+    store->count = mark->count;
+}
+
+void job_store_free(JobStore *store) {
+    job_store_clear(store);
+    free(store->blocks);
+    free(store->urls);
+    free(store->status);
+    free(store->seconds);
+    free(store->phases);
+    free(store->bytes);
+    free(store->new_connections);
+    free(store->retries);
+    free(store->flags);
+    free(store->depths);
+    memset(store, 0, sizeof(*store));
+}
+
+// Room for `size` bytes in the newest block, starting a new block when the
+// current one is full; long URLs get a block of their own
+static char* arena_alloc(JobStore *store, size_t size) {
+    if (store->block_count == 0 || store->block_size - store->block_used < size) {
+        if (store->block_count == store->block_capacity) {
+            int capacity = store->block_capacity ? store->block_capacity * 2 : 16;
+            if (!grow_array((void **)&store->blocks, sizeof(char *), capacity)) return NULL;
+            store->block_capacity = capacity;
+        }
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        char *block = malloc(block_size);
+        if (!block) return NULL;
+        store->blocks[store->block_count++] = block;
+        store->block_size = block_size;
+        store->block_used = 0;
+    }
+
+    char *memory = store->blocks[store->block_count - 1] + store->block_used;
+    store->block_used += size;
+    return memory;
+}
+
+int job_store_add(JobStore *store, const char *url, size_t length, int depth) {
+    if (store->count == store->capacity && !reserve_jobs(store, store->capacity * 2)) return -1;
+
+    char *copy = arena_alloc(store, length + 1);
+    if (!copy) return -1;
+    memcpy(copy, url, length);
+    copy[length] = '\0';
+
+    int job = store->count++;
+    store->urls[job] = copy;
+    store->depths[job] = depth > UINT8_MAX ? UINT8_MAX : (uint8_t)depth;
+    JobResult empty = {0};
+    job_store_set_result(store, job, &empty);
+    return job;
+}
+
+void job_store_set_result(JobStore *store, int job, const JobResult *result) {
+    store->status[job] = (uint16_t)result->response_code;
+    store->seconds[job] = (float)result->download_time;
+    for (int i = 0; i < JOB_PHASES; i++) {
+        store->phases[job][i] = (float)result->phases[i];
+    }
+    store->bytes[job] = result->bytes_received;
+    store->new_connections[job] = result->new_connections > UINT16_MAX ? UINT16_MAX
+                                                                        : (uint16_t)result->new_connections;
+    store->retries[job] = result->retries > UINT8_MAX ? UINT8_MAX : (uint8_t)result->retries;
+    store->flags[job] = (result->success ? JOB_SUCCESS : 0) | (result->not_modified ? JOB_NOT_MODIFIED : 0);
+}
+
+void job_store_get_result(const JobStore *store, int job, JobResult *result) {
+    result->response_code = store->status[job];
+    result->download_time = store->seconds[job];
+    for (int i = 0; i < JOB_PHASES; i++) {
+        result->phases[i] = store->phases[job][i];
+    }
+    result->bytes_received = store->bytes[job];
+    result->new_connections = store->new_connections[job];
+    result->retries = store->retries[job];
+    result->success = (store->flags[job] & JOB_SUCCESS) != 0;
+    result->not_modified = (store->flags[job] & JOB_NOT_MODIFIED) != 0;
+}
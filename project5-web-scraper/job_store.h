@@ -0,0 +1,85 @@
+#ifndef JOB_STORE_H
+#define JOB_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_BLOCK_SIZE 65536
+#define INITIAL_JOB_CAPACITY 64
+
+// Phases of a request's final attempt, in the order they happen
+typedef enum {
+    PHASE_DNS,              // Name lookup
+    PHASE_CONNECT,          // TCP handshake
+    PHASE_TLS,              // TLS handshake, 0 for plain HTTP
+    PHASE_TTFB,             // Request sent until the first response byte
+    PHASE_TRANSFER,         // First byte until the last one
+    JOB_PHASES
+} JobPhase;
+
+// Outcome of one job as the engines report it
+typedef struct {
+    long response_code;
+    double download_time;   // Wall-clock seconds, retries and backoff included
+    double phases[JOB_PHASES];
+    long new_connections;
+    size_t bytes_received;
+    int retries;
+    int success;
+    int not_modified;
+} JobResult;
+
+// Every URL of a crawl list and its result. URLs are packed back to back
+// in fixed arena blocks that never move, so a URL pointer stays valid for
+// as long as the job exists; results live in one compact array per field.
+// A job costs its URL's length plus about 50 bytes, with no upper limit
+// on the number of jobs.
+typedef struct {
+    char **blocks;
+    int block_count;
+    int block_capacity;
+    size_t block_used;      // Bytes taken in the newest block
+    size_t block_size;      // Size of the newest block
+
+    const char **urls;
+    uint16_t *status;
+    float *seconds;
+    float (*phases)[JOB_PHASES];
+    uint64_t *bytes;
+    uint16_t *new_connections;
+    uint8_t *retries;
+    uint8_t *flags;         // JOB_SUCCESS | JOB_NOT_MODIFIED
+    uint8_t *depths;        // Links followed from a listed URL to reach the job
+    int count;
+    int capacity;
+} JobStore;
+
+// Position in a store to come back to, dropping the jobs added since
+typedef struct {
+    int count;
+    int block_count;
+    size_t block_used;
+    size_t block_size;
+} JobStoreMark;
+
+#define JOB_SUCCESS 1
+#define JOB_NOT_MODIFIED 2
+
+int job_store_init(JobStore *store, int capacity);
+void job_store_free(JobStore *store);
+
+// Drops every job (and its URL) but keeps the arrays for reuse
+void job_store_clear(JobStore *store);
+
+JobStoreMark job_store_mark(const JobStore *store);
+
+// Drops the jobs added after `mark` was taken, and the blocks of their URLs
+void job_store_rewind(JobStore *store, const JobStoreMark *mark);
+
+// Copies `url` into the store; returns the new job's index, or -1 if out of memory
+int job_store_add(JobStore *store, const char *url, size_t length, int depth);
+
+void job_store_set_result(JobStore *store, int job, const JobResult *result);
+void job_store_get_result(const JobStore *store, int job, JobResult *result);
+
+#endif
@@ -0,0 +1,324 @@
+#include "link_extractor.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+void link_extractor_init(LinkExtractor *extractor, LinkCallback callback, void *context) {
+    memset(extractor, 0, sizeof(*extractor));
+    extractor->state = LINK_TEXT;
+    extractor->callback = callback;
+    extractor->context = context;
+}
+
+// Lowercase append; a name too long for the buffer keeps counting, so it
+// can never match a short name such as "href"
+static void append_name(char *name, size_t *length, char c) {
+    if (*length + 1 < MAX_TAG_NAME) name[*length] = (char)tolower((unsigned char)c);
+    (*length)++;
+}
+
+static int name_is(const char *name, size_t length, const char *expected) {
+    return length < MAX_TAG_NAME && length == strlen(expected) && memcmp(name, expected, length) == 0;
+}
+
+static void start_value(LinkExtractor *extractor) {
+    extractor->value_length = 0;
+    extractor->value_overflow = 0;
+}
+
+static void append_value(LinkExtractor *extractor, char c) {
+    if (extractor->value_length + 1 < MAX_LINK_LENGTH) {
+        extractor->value[extractor->value_length++] = c;
+    } else {
+        extractor->value_overflow = 1;
+    }
+}
+
+static void emit_attribute(LinkExtractor *extractor) {
+    size_t length = extractor->attribute_length;
+    if (extractor->value_overflow) return;
+    if (!name_is(extractor->attribute, length, "href") && !name_is(extractor->attribute, length, "src")) return;
+    if (extractor->tag_length >= MAX_TAG_NAME) return;
+
+    extractor->tag[extractor->tag_length] = '\0';
+    extractor->value[extractor->value_length] = '\0';
+    extractor->callback(extractor->context, extractor->tag, extractor->value);
+}
+
+// After the '>' of a start tag; script and style bodies are not markup
+static void end_start_tag(LinkExtractor *extractor) {
+    if (name_is(extractor->tag, extractor->tag_length, "script") ||
+        name_is(extractor->tag, extractor->tag_length, "style")) {
+        extractor->state = LINK_RAW_TEXT;
+        extractor->matched = 0;
+    } else {
+        extractor->state = LINK_TEXT;
+    }
+}
+
+static void start_attribute(LinkExtractor *extractor, char c) {
+    extractor->attribute_length = 0;
+    append_name(extractor->attribute, &extractor->attribute_length, c);
+    extractor->state = LINK_ATTRIBUTE_NAME;
+}
+
+void link_extractor_feed(LinkExtractor *extractor, const char *data, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        // Text is most of a page: jump straight to the next tag
+        if (extractor->state == LINK_TEXT ||
+            (extractor->state == LINK_RAW_TEXT && extractor->matched == 0)) {
+            const char *open = memchr(data + i, '<', size - i);
+            if (!open) return;
+            i = (size_t)(open - data);
+        }
+
+        char c = data[i++];
+        int space = isspace((unsigned char)c);
+        switch (extractor->state) {
+            case LINK_TEXT:
+                extractor->state = LINK_TAG_OPEN;
+                break;
+            case LINK_TAG_OPEN:
+                if (c == '!') {
+                    extractor->state = LINK_MARKUP;
+                    extractor->matched = 0;
+                } else if (c == '/' || c == '?') {
+                    extractor->state = LINK_SKIP_TAG;
+                } else if (isalpha((unsigned char)c)) {
+                    extractor->tag_length = 0;
+                    append_name(extractor->tag, &extractor->tag_length, c);
+                    extractor->state = LINK_TAG_NAME;
+                } else if (c != '<') {
+                    extractor->state = LINK_TEXT;
+                }
+                break;
+            case LINK_MARKUP:
+                if (c == '-' && ++extractor->matched == 2) {
+                    extractor->state = LINK_COMMENT;
+                    extractor->matched = 0;
+                } else if (c == '>') {
+                    extractor->state = LINK_TEXT;
+                } else if (c != '-') {
+                    extractor->state = LINK_SKIP_TAG;
+                }
+                break;
+            case LINK_COMMENT:
+                if (c == '-') {
+                    extractor->matched++;
+                } else {
+                    if (c == '>' && extractor->matched >= 2) extractor->state = LINK_TEXT;
+                    extractor->matched = 0;
+                }
+                break;
+            case LINK_SKIP_TAG:
+                if (c == '>') extractor->state = LINK_TEXT;
+                break;
+            case LINK_TAG_NAME:
+                if (space || c == '/') {
+                    extractor->state = LINK_BEFORE_ATTRIBUTE;
+                } else if (c == '>') {
+                    end_start_tag(extractor);
+                } else {
+                    append_name(extractor->tag, &extractor->tag_length, c);
+                }
+                break;
+            case LINK_BEFORE_ATTRIBUTE:
+                if (c == '>') {
+                    end_start_tag(extractor);
+                } else if (!space && c != '/') {
+                    start_attribute(extractor, c);
+                }
+                break;
+            case LINK_ATTRIBUTE_NAME:
+                if (space) {
+                    extractor->state = LINK_AFTER_ATTRIBUTE_NAME;
+                } else if (c == '=') {
+                    extractor->state = LINK_BEFORE_VALUE;
+                } else if (c == '/') {
+                    extractor->state = LINK_BEFORE_ATTRIBUTE;
+                } else if (c == '>') {
+                    end_start_tag(extractor);
+                } else {
+                    append_name(extractor->attribute, &extractor->attribute_length, c);
+                }
+                break;
+            case LINK_AFTER_ATTRIBUTE_NAME:
+                if (c == '=') {
+                    extractor->state = LINK_BEFORE_VALUE;
+                } else if (c == '/') {
+                    extractor->state = LINK_BEFORE_ATTRIBUTE;
+                } else if (c == '>') {
+                    end_start_tag(extractor);
+                } else if (!space) {
+                    start_attribute(extractor, c);
+                }
+                break;
+            case LINK_BEFORE_VALUE:
+                if (c == '"' || c == '\'') {
+                    extractor->quote = c;
+                    start_value(extractor);
+                    extractor->state = LINK_QUOTED_VALUE;
+                } else if (c == '>') {
+                    end_start_tag(extractor);
+                } else if (!space) {
+                    start_value(extractor);
+                    append_value(extractor, c);
+                    extractor->state = LINK_UNQUOTED_VALUE;
+                }
+                break;
+            case LINK_QUOTED_VALUE:
+                if (c == extractor->quote) {
+                    emit_attribute(extractor);
+                    extractor->state = LINK_BEFORE_ATTRIBUTE;
+                } else {
+                    append_value(extractor, c);
+                }
+                break;
+            case LINK_UNQUOTED_VALUE:
+                if (space) {
+                    emit_attribute(extractor);
+                    extractor->state = LINK_BEFORE_ATTRIBUTE;
+                } else if (c == '>') {
+                    emit_attribute(extractor);
+                    end_start_tag(extractor);
+                } else {
+                    append_value(extractor, c);
+                }
+                break;
+            case LINK_RAW_TEXT: {
+                // Looking for "</script" or "</style", in any case
+                size_t position = (size_t)extractor->matched;
+                char expected = position == 0 ? '<' : position == 1 ? '/' : extractor->tag[position - 2];
+                if (tolower((unsigned char)c) == expected) {
+                    if (++extractor->matched == (int)extractor->tag_length + 2) {
+                        extractor->state = LINK_SKIP_TAG;
+                    }
+                } else {
+                    extractor->matched = c == '<';
+                }
+                break;
+            }
+        }
+    }
+}
+
+// Length of the "scheme:" prefix's scheme, 0 if `url` has none
+static size_t scheme_length(const char *url) {
+    if (!isalpha((unsigned char)url[0])) return 0;
+    size_t length = 1;
+    while (isalnum((unsigned char)url[length]) || url[length] == '+' || url[length] == '-' ||
+           url[length] == '.') {
+        length++;
+    }
+    return url[length] == ':' ? length : 0;
+}
+
+// Copies the link without surrounding whitespace, embedded line breaks and
+// its fragment, decoding "&amp;" (the one entity common in links) and
+// escaping inner spaces, which libcurl would reject
+static size_t clean_link(const char *link, char *clean, size_t size) {
+    while (isspace((unsigned char)*link)) link++;
+    size_t end = strcspn(link, "#");
+    while (end > 0 && isspace((unsigned char)link[end - 1])) end--;
+
+    size_t length = 0;
+    for (size_t i = 0; i < end; i++) {
+        char c = link[i];
+        if (c == '\n' || c == '\r' || c == '\t') continue;
+        if (length + 4 >= size) return 0;
+        if (c == ' ') {
+            memcpy(clean + length, "%20", 3);
+            length += 3;
+            continue;
+        }
+        clean[length++] = c;
+        if (c == '&' && strncmp(link + i, "&amp;", 5) == 0) i += 4;
+    }
+    clean[length] = '\0';
+    return length;
+}
+
+// Rewrites `path` (starting with '/', `length` bytes) without "." and ".."
+// segments into `out`; returns the new length
+static size_t remove_dot_segments(const char *path, size_t length, char *out) {
+    size_t out_length = 0;
+    size_t i = 0;
+    while (i < length) {
+        size_t start = i + 1, end = start;
+        while (end < length && path[end] != '/') end++;
+        size_t segment = end - start;
+        int last = end == length;
+
+        if (segment == 1 && path[start] == '.') {
+            if (last) out[out_length++] = '/';
+        } else if (segment == 2 && path[start] == '.' && path[start + 1] == '.') {
+            while (out_length > 0 && out[--out_length] != '/');
+            if (last) out[out_length++] = '/';
+        } else {
+            out[out_length++] = '/';
+            memcpy(out + out_length, path + start, segment);
+            out_length += segment;
+        }
+        i = end;
+    }
+    return out_length;
+}
+
+int resolve_url(const char *base, const char *link, char *url, size_t size) {
+    char clean[MAX_LINK_LENGTH];
+    char joined[MAX_LINK_LENGTH * 2];
+    if (clean_link(link, clean, sizeof(clean)) == 0) return 0;
+
+    size_t scheme = scheme_length(clean);
+    if (scheme > 0) {
+        if (!(scheme == 4 && strncasecmp(clean, "http", 4) == 0) &&
+            !(scheme == 5 && strncasecmp(clean, "https", 5) == 0)) {
+            return 0;
+        }
+        strcpy(joined, clean);
+    } else {
+        // Split the base into scheme://authority, path and query
+        size_t base_scheme = scheme_length(base);
+        if (base_scheme == 0 || strncmp(base + base_scheme, "://", 3) != 0) return 0;
+        size_t authority_end = base_scheme + 3 + strcspn(base + base_scheme + 3, "/?#");
+        size_t path_end = authority_end + strcspn(base + authority_end, "?#");
+        size_t directory_end = path_end;
+        while (directory_end > authority_end && base[directory_end - 1] != '/') directory_end--;
+
+        int written;
+        if (clean[0] == '/' && clean[1] == '/') {
+            written = snprintf(joined, sizeof(joined), "%.*s%s", (int)base_scheme + 1, base, clean);
+        } else if (clean[0] == '/') {
+            written = snprintf(joined, sizeof(joined), "%.*s%s", (int)authority_end, base, clean);
+        } else if (clean[0] == '?') {
+            written = snprintf(joined, sizeof(joined), "%.*s%s", (int)path_end, base, clean);
+        } else if (directory_end == authority_end) {
+            written = snprintf(joined, sizeof(joined), "%.*s/%s", (int)authority_end, base, clean);
+        } else {
+            written = snprintf(joined, sizeof(joined), "%.*s%s", (int)directory_end, base, clean);
+        }
+        if (written < 0 || (size_t)written >= sizeof(joined)) return 0;
+        scheme = base_scheme;
+    }
+
+    // Lowercase scheme and authority, then normalise the path
+    if (strncmp(joined + scheme, "://", 3) != 0) return 0;
+    size_t authority_end = scheme + 3 + strcspn(joined + scheme + 3, "/?");
+    if (authority_end == scheme + 3) return 0;
+    for (size_t i = 0; i < authority_end; i++) joined[i] = (char)tolower((unsigned char)joined[i]);
+
+    const char *path = joined + authority_end;
+    size_t path_length = strcspn(path, "?");
+    char normal[MAX_LINK_LENGTH * 2];
+    size_t normal_length = path_length > 0 && path[0] == '/' ? remove_dot_segments(path, path_length, normal) : 0;
+    if (normal_length == 0) normal[normal_length++] = '/';
+
+    size_t query_length = strlen(path + path_length);
+    if (authority_end + normal_length + query_length >= size) return 0;
+    memcpy(url, joined, authority_end);
+    memcpy(url + authority_end, normal, normal_length);
+    memcpy(url + authority_end + normal_length, path + path_length, query_length + 1);
+    return 1;
+}
@@ -0,0 +1,57 @@
+#ifndef LINK_EXTRACTOR_H
+#define LINK_EXTRACTOR_H
+
+#include <stddef.h>
+
+#define MAX_LINK_LENGTH 2048    // Longer attribute values are dropped
+#define MAX_TAG_NAME 16
+
+// Called for every href or src attribute; `tag` is the lowercase element name
+typedef void (*LinkCallback)(void *context, const char *tag, const char *link);
+
+typedef enum {
+    LINK_TEXT,
+    LINK_TAG_OPEN,          // After '<'
+    LINK_MARKUP,            // After "<!", deciding between comment and declaration
+    LINK_COMMENT,
+    LINK_SKIP_TAG,          // End tags, declarations: nothing until '>'
+    LINK_TAG_NAME,
+    LINK_BEFORE_ATTRIBUTE,
+    LINK_ATTRIBUTE_NAME,
+    LINK_AFTER_ATTRIBUTE_NAME,
+    LINK_BEFORE_VALUE,
+    LINK_QUOTED_VALUE,
+    LINK_UNQUOTED_VALUE,
+    LINK_RAW_TEXT           // Inside <script> or <style>, until its end tag
+} LinkState;
+
+// Incremental HTML tokenizer that only looks at start tags and their
+// href/src attributes. Bytes can arrive in chunks of any size; a tag split
+// across chunks resumes where the previous chunk stopped, so a body is
+// scanned once, as it streams in, with no DOM and no second pass.
+typedef struct {
+    LinkState state;
+    char tag[MAX_TAG_NAME];
+    size_t tag_length;
+    char attribute[MAX_TAG_NAME];
+    size_t attribute_length;
+    char value[MAX_LINK_LENGTH];
+    size_t value_length;
+    int value_overflow;     // The current value did not fit
+    char quote;
+    int matched;            // Progress through "--" in comments or "</tag" in raw text
+    LinkCallback callback;
+    void *context;
+} LinkExtractor;
+
+void link_extractor_init(LinkExtractor *extractor, LinkCallback callback, void *context);
+
+void link_extractor_feed(LinkExtractor *extractor, const char *data, size_t size);
+
+// Resolves `link` (as written in a page) against the page's URL into an
+// absolute http(s) URL without fragment, with dot segments removed and the
+// scheme and host lowercased. Returns 0 for links to skip: other schemes,
+// fragments of the page itself, or results that do not fit in `size`.
+int resolve_url(const char *base, const char *link, char *url, size_t size);
+
+#endif
@@ -1,4 +1,8 @@
 #include "web_scraper.h"
+#include <ctype.h>
+
+#define LOAD_BUFFER_SIZE (1 << 20)
+#define LOAD_ECHO_LIMIT 10      // Lines of a loaded file echoed back
 
 void display_menu() {
     printf("\n=== Multi-threaded Web Scraper ===\n");
@@ -7,47 +11,71 @@ void display_menu() {
     printf("3. Display current URLs\n");
     printf("4. Start scraping\n");
     printf("5. Clear URL list\n");
-    printf("6. Exit\n");
+    printf("6. Set concurrency\n");
+    printf("7. Select engine\n");
+    printf("8. Set per-host limits\n");
+    printf("9. Set retries and HTTP cache\n");
+    printf("10. Export last run report\n");
+    printf("11. Set crawl depth\n");
+    printf("12. Set output mode\n");
+    printf("0. Exit\n");
     printf("==================================\n");
     printf("Choose an option: ");
 }
 
+// Streams the file line by line, so lists of any size load in one pass
+// without a per-line length limit; only the first few lines are echoed
 int load_urls_from_file(ScraperManager *manager, const char *filename) {
     FILE *file = fopen(filename, "r");
     if (!file) {
         printf("Error: Cannot open file %s\n", filename);
         return 0;
     }
+    setvbuf(file, NULL, _IOFBF, LOAD_BUFFER_SIZE);
     
-    char url[MAX_URL_LENGTH];
-    int count = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+    int count = 0, skipped = 0, echoed = 0;
     
-    while (fgets(url, sizeof(url), file)) {
-        // Remove newline character
-        url[strcspn(url, "\n")] = '\0';
+    while ((length = getline(&line, &line_capacity, file)) != -1) {
+        // Trim surrounding whitespace, including CR from CRLF files
+        char *url = line;
+        while (length > 0 && isspace((unsigned char)url[length - 1])) url[--length] = '\0';
+        while (isspace((unsigned char)*url)) url++;
+        if (*url == '\0') continue;
         
-        if (strlen(url) > 0 && add_url(manager, url)) {
+        int added = add_url(manager, url);
+        if (added) {
             count++;
-            printf("Added: %s\n", url);
         } else {
-            printf("Skipped invalid URL: %s\n", url);
+            skipped++;
+        }
+        if (echoed < LOAD_ECHO_LIMIT) {
+            printf(added ? "Added: %s\n" : "Skipped invalid URL: %s\n", url);
+            if (++echoed == LOAD_ECHO_LIMIT) printf("...\n");
         }
     }
     
+    free(line);
     fclose(file);
-    printf("Loaded %d URLs from %s\n", count, filename);
+    printf("Loaded %d URLs from %s", count, filename);
+    if (skipped > 0) printf(" (%d skipped)", skipped);
+    printf("\n");
     return count;
 }
 
 void display_urls(ScraperManager *manager) {
-    if (manager->count == 0) {
+    // Only the listed URLs; pages a crawl found are in the results
+    int count = manager->listed.count;
+    if (count == 0) {
         printf("No URLs added yet.\n");
         return;
     }
     
-    printf("\nCurrent URLs (%d):\n", manager->count);
-    for (int i = 0; i < manager->count; i++) {
-        printf("%d. %s\n", i + 1, manager->threads[i].url);
+    printf("\nCurrent URLs (%d):\n", count);
+    for (int i = 0; i < count; i++) {
+        printf("%d. %s\n", i + 1, manager->jobs.urls[i]);
     }
 }
 
@@ -65,7 +93,7 @@ void create_sample_urls_file() {
 }
 
 int main() {
-    ScraperManager *manager = init_scraper(MAX_URLS);
+    ScraperManager *manager = init_scraper(INITIAL_JOB_CAPACITY);
     if (!manager) {
         printf("Failed to initialize scraper!\n");
         return 1;
@@ -83,7 +111,13 @@ int main() {
     
     while (1) {
         display_menu();
-        scanf("%d", &choice);
+        int scanned = scanf("%d", &choice);
+        if (scanned == EOF) {
+            choice = 0;
+        } else if (scanned != 1) {
+            scanf("%*s");
+            choice = -1;
+        }
         
         switch (choice) {
             case 1:
@@ -123,12 +157,12 @@ int main() {
                 break;
                 
             case 4:
-                if (manager->count == 0) {
+                if (manager->listed.count == 0) {
                     printf("No URLs to scrape! Add some URLs first.\n");
                     break;
                 }
                 
-                printf("Starting parallel download of %d URLs...\n", manager->count);
+                printf("Starting parallel download of %d URLs...\n", manager->listed.count);
                 start_scraping(manager);
                 wait_for_completion(manager);
                 print_results(manager);
@@ -136,11 +170,129 @@ int main() {
                 break;
                 
             case 5:
-                manager->count = 0;
+                clear_urls(manager);
                 printf("URL list cleared.\n");
                 break;
                 
-            case 6:
+            case 6: {
+                int limit;
+                if (manager->engine == ENGINE_MULTI) {
+                    printf("Enter transfers in flight (1-%d, current %d): ", MAX_TRANSFERS, manager->max_transfers);
+                } else {
+                    printf("Enter number of worker threads (1-%d, current %d): ", MAX_WORKERS, manager->max_workers);
+                }
+                if (scanf("%d", &limit) == 1 && set_concurrency(manager, limit)) {
+                    printf("Concurrency set to %d.\n", limit);
+                } else {
+                    printf("Invalid concurrency!\n");
+                }
+                break;
+            }
+                
+            case 7: {
+                int engine;
+                printf("Current engine: %s\n", engine_name(manager->engine));
+                printf("1. %s\n2. %s\nChoose engine: ", engine_name(ENGINE_THREADED), engine_name(ENGINE_MULTI));
+                if (scanf("%d", &engine) == 1 &&
+                    set_engine(manager, engine == 2 ? ENGINE_MULTI : engine == 1 ? ENGINE_THREADED : -1)) {
+                    printf("Using the %s engine.\n", engine_name(manager->engine));
+                } else {
+                    printf("Invalid engine!\n");
+                }
+                break;
+            }
+                
+            case 8: {
+                int per_host;
+                double rate;
+                printf("Enter requests in flight per host (0 = no limit, current %d): ", manager->host_limit);
+                if (scanf("%d", &per_host) != 1) {
+                    printf("Invalid limit!\n");
+                    break;
+                }
+                printf("Enter requests per second per host (0 = no limit, current %.1f): ", manager->host_rate);
+                if (scanf("%lf", &rate) == 1 && set_host_limits(manager, per_host, rate)) {
+                    printf("Per-host limits set.\n");
+                } else {
+                    printf("Invalid limit!\n");
+                }
+                break;
+            }
+                
+            case 9: {
+                int retries, cache;
+                printf("Enter retries for transient errors (0-%d, current %d): ", MAX_RETRIES, manager->max_retries);
+                if (scanf("%d", &retries) != 1 || !set_max_retries(manager, retries)) {
+                    printf("Invalid retry count!\n");
+                    break;
+                }
+                printf("Use the HTTP cache in %s? (1 = yes, 0 = no, current %s): ", DEFAULT_CACHE_DIR,
+                       manager->cache_dir[0] ? "yes" : "no");
+                if (scanf("%d", &cache) == 1 && (cache == 0 || cache == 1)) {
+                    set_cache_dir(manager, cache ? DEFAULT_CACHE_DIR : NULL);
+                    printf("Retries set to %d, cache %s.\n", retries, cache ? "on" : "off");
+                } else {
+                    printf("Invalid choice!\n");
+                }
+                break;
+            }
+                
+            case 10: {
+                char path[MAX_FILENAME_LENGTH];
+                if (manager->makespan <= 0) {
+                    printf("No completed run to export yet.\n");
+                    break;
+                }
+                printf("Enter report filename (.json or .csv): ");
+                if (scanf("%255s", path) != 1) {
+                    printf("Invalid filename!\n");
+                    break;
+                }
+                if (export_run_report(manager, path)) {
+                    printf("Report written to %s\n", path);
+                } else {
+                    printf("Error: cannot write %s\n", path);
+                }
+                break;
+            }
+                
+            case 11: {
+                int depth;
+                printf("Enter link depth to crawl (0-%d, 0 = listed URLs only, current %d): ",
+                       MAX_CRAWL_DEPTH, manager->crawl_depth);
+                if (scanf("%d", &depth) == 1 && set_crawl_depth(manager, depth)) {
+                    printf("Crawl depth set to %d.\n", depth);
+                } else {
+                    printf("Invalid depth!\n");
+                }
+                break;
+            }
+                
+            case 12: {
+                int output, compress = 0;
+                printf("Current output: %s\n", manager->output == OUTPUT_ARCHIVE ? "page archive" : "one file per page");
+                printf("1. One .html file per page\n2. Deduplicated page archive in %s\nChoose output: ",
+                       DEFAULT_ARCHIVE_DIR);
+                if (scanf("%d", &output) != 1 || (output != 1 && output != 2)) {
+                    printf("Invalid output!\n");
+                    break;
+                }
+                if (output == 2 && page_archive_can_compress()) {
+                    printf("Compress archive records? (1 = yes, 0 = no): ");
+                    if (scanf("%d", &compress) != 1 || (compress != 0 && compress != 1)) {
+                        printf("Invalid choice!\n");
+                        break;
+                    }
+                }
+                if (set_output(manager, output == 2 ? OUTPUT_ARCHIVE : OUTPUT_FILES, DEFAULT_ARCHIVE_DIR, compress)) {
+                    printf("Saving %s.\n", output == 2 ? "to the page archive" : "one file per page");
+                } else {
+                    printf("Invalid output!\n");
+                }
+                break;
+            }
+                
+            case 0:
                 free_scraper(manager);
                 printf("Goodbye!\n");
                 return 0;
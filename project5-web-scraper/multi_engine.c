@@ -0,0 +1,281 @@
+#include "multi_engine.h"
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+
+typedef struct {
+    CURL *curl;             // Kept for the whole run and reused by each job
+    WebResponse response;
+    ThreadData data;        // Working state of the job in this slot
+    int job;                // Job index, -1 when idle
+    int attempt;            // 0 for the first try of the job
+    long long retry_at;     // Monotonic ms when a backed-off job restarts, 0 if none
+} Transfer;
+
+typedef struct {
+    int epoll_fd;
+    CURLM *multi;
+    long timeout_ms;        // Next libcurl timeout, -1 for none
+    long schedule_ms;       // Until the host scheduler releases a job, -1 for none
+    long retry_ms;          // Until the next backed-off job restarts, -1 for none
+    int backing_off;        // Slots waiting to retry their job
+    Transfer *transfers;
+    int *idle;              // Slots without a transfer
+    int idle_count;
+    int active;             // Transfers in flight
+} EventLoop;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// curl_multi tells us which sockets to watch and for what
+static int socket_callback(CURL *easy, curl_socket_t fd, int what, void *userp, void *socketp) {
+    EventLoop *loop = userp;
+    (void)easy;
+    (void)socketp;
+
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        return 0;
+    }
+
+    struct epoll_event event = {0};
+    event.data.fd = fd;
+    if (what & CURL_POLL_IN) event.events |= EPOLLIN;
+    if (what & CURL_POLL_OUT) event.events |= EPOLLOUT;
+
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0) {
+        if (errno != ENOENT || epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) return -1;
+    }
+    return 0;
+}
+
+static int timer_callback(CURLM *multi, long timeout_ms, void *userp) {
+    EventLoop *loop = userp;
+    (void)multi;
+    loop->timeout_ms = timeout_ms;
+    return 0;
+}
+
+static int start_transfer(ScraperManager *manager, EventLoop *loop, Transfer *transfer, int job) {
+    ThreadData *data = &transfer->data;
+    if (manager->verbose) printf("Thread %d: Starting download from %s\n", data->thread_id, data->url);
+
+    if (!transfer->curl) {
+        printf("Thread %d: Failed to initialize curl\n", data->thread_id);
+        data->success = 0;
+        return 0;
+    }
+
+    transfer->job = job;
+    data->success = 0;
+    configure_transfer(manager, transfer->curl, data, &transfer->response);
+    curl_easy_setopt(transfer->curl, CURLOPT_PRIVATE, transfer);
+
+    if (curl_multi_add_handle(loop->multi, transfer->curl) != CURLM_OK) {
+        transfer->job = -1;
+        return 0;
+    }
+    return 1;
+}
+
+// Hands a finished job back to the scheduler and frees its slot
+static void finish_slot(ScraperManager *manager, EventLoop *loop, Transfer *transfer) {
+    release_response(&transfer->response);
+    finish_job(manager, &transfer->data);
+    host_scheduler_done(&manager->scheduler, transfer->job);
+    transfer->job = -1;
+    loop->idle[loop->idle_count++] = (int)(transfer - loop->transfers);
+    loop->active--;
+}
+
+// Finishes every completed transfer: its slot either backs off for a
+// retry or returns to the idle list
+static void collect_finished(ScraperManager *manager, EventLoop *loop) {
+    CURLMsg *message;
+    int pending;
+
+    while ((message = curl_multi_info_read(loop->multi, &pending)) != NULL) {
+        if (message->msg != CURLMSG_DONE) continue;
+
+        Transfer *transfer;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char **)&transfer);
+        ThreadData *data = &transfer->data;
+
+        // A retried job keeps its slot (and its host's) through the backoff
+        CURLcode result = message->data.result;
+        long delay = retry_delay_ms(manager, data, transfer->curl, result, transfer->attempt);
+        curl_multi_remove_handle(loop->multi, transfer->curl);
+        if (delay >= 0) {
+            if (manager->verbose) printf("Thread %d: Retrying in %ld ms\n", data->thread_id, delay);
+            release_response(&transfer->response);
+            data->retries++;
+            transfer->attempt++;
+            transfer->retry_at = now_ms() + delay;
+            loop->backing_off++;
+            continue;
+        }
+
+        complete_transfer(manager, data, transfer->curl, result, &transfer->response);
+        finish_slot(manager, loop, transfer);
+    }
+}
+
+// Restarts backed-off jobs that are due and notes when the next one is;
+// returns the number restarted
+static int restart_due(ScraperManager *manager, EventLoop *loop, int slots) {
+    int started = 0;
+    long long now = now_ms(), next = -1;
+
+    loop->retry_ms = -1;
+    for (int i = 0; i < slots && loop->backing_off > 0; i++) {
+        Transfer *transfer = &loop->transfers[i];
+        if (transfer->retry_at == 0) continue;
+        if (transfer->retry_at > now) {
+            if (next < 0 || transfer->retry_at < next) next = transfer->retry_at;
+            continue;
+        }
+
+        transfer->retry_at = 0;
+        loop->backing_off--;
+        if (start_transfer(manager, loop, transfer, transfer->job)) {
+            started++;
+        } else {
+            finish_slot(manager, loop, transfer);
+        }
+    }
+    if (next >= 0) loop->retry_ms = (long)(next - now);
+    return started;
+}
+
+// Starts jobs in idle slots for as long as the host scheduler releases
+// them; returns the number started
+static int fill_slots(ScraperManager *manager, EventLoop *loop) {
+    int started = 0, job;
+    long wait_ms = -1;
+
+    loop->schedule_ms = -1;
+    while (loop->idle_count > 0) {
+        int result = host_scheduler_poll(&manager->scheduler, &job, &wait_ms);
+        if (result != 1) {
+            if (result == 0) loop->schedule_ms = wait_ms;
+            break;
+        }
+
+        Transfer *transfer = &loop->transfers[loop->idle[loop->idle_count - 1]];
+        transfer->attempt = 0;
+        load_job(manager, job, &transfer->data);
+        if (start_transfer(manager, loop, transfer, job)) {
+            loop->idle_count--;
+            loop->active++;
+            started++;
+        } else {
+            finish_job(manager, &transfer->data);
+            host_scheduler_done(&manager->scheduler, job);
+        }
+    }
+    return started;
+}
+
+// Sleeps until libcurl, the scheduler or a retry has something to do
+static int next_timeout(EventLoop *loop) {
+    long timeout = loop->timeout_ms;
+    if (loop->schedule_ms >= 0 && (timeout < 0 || loop->schedule_ms < timeout)) timeout = loop->schedule_ms;
+    if (loop->retry_ms >= 0 && (timeout < 0 || loop->retry_ms < timeout)) timeout = loop->retry_ms;
+    return timeout < 0 ? 1000 : (int)timeout;
+}
+
+int run_multi_engine(ScraperManager *manager) {
+    // A crawl can grow past the listed URLs, so it gets every slot
+    int slots = manager->max_transfers;
+    if (manager->crawl_depth == 0 && manager->jobs.count < slots) slots = manager->jobs.count;
+    if (slots <= 0) return 1;
+
+    EventLoop loop;
+    loop.timeout_ms = -1;
+    loop.schedule_ms = -1;
+    loop.retry_ms = -1;
+    loop.backing_off = 0;
+    loop.epoll_fd = epoll_create1(0);
+    loop.multi = curl_multi_init();
+    loop.transfers = calloc((size_t)slots, sizeof(Transfer));
+    loop.idle = malloc((size_t)slots * sizeof(int));
+    if (loop.epoll_fd < 0 || !loop.multi || !loop.transfers || !loop.idle) {
+        printf("Error setting up the event loop\n");
+        if (loop.epoll_fd >= 0) close(loop.epoll_fd);
+        if (loop.multi) curl_multi_cleanup(loop.multi);
+        free(loop.transfers);
+        free(loop.idle);
+        return 0;
+    }
+
+    curl_multi_setopt(loop.multi, CURLMOPT_SOCKETFUNCTION, socket_callback);
+    curl_multi_setopt(loop.multi, CURLMOPT_SOCKETDATA, &loop);
+    curl_multi_setopt(loop.multi, CURLMOPT_TIMERFUNCTION, timer_callback);
+    curl_multi_setopt(loop.multi, CURLMOPT_TIMERDATA, &loop);
+    // A handle's CURLOPT_MAXCONNECTS does not apply inside a multi handle,
+    // whose own default (four per attached handle) shrinks whenever few
+    // transfers are in flight; keep the cap configure_transfer sets
+    curl_multi_setopt(loop.multi, CURLMOPT_MAXCONNECTS, (long)manager->max_transfers * POOL_CONNECTIONS_PER_TRANSFER);
+
+    printf("Starting event-driven download of %d URLs with up to %d transfers in flight...\n",
+           manager->jobs.count, slots);
+
+    loop.idle_count = 0;
+    loop.active = 0;
+    for (int i = slots - 1; i >= 0; i--) {
+        loop.transfers[i].curl = curl_easy_init();
+        loop.transfers[i].job = -1;
+        loop.idle[loop.idle_count++] = i;
+    }
+
+    int running = 0;
+    fill_slots(manager, &loop);
+    curl_multi_socket_action(loop.multi, CURL_SOCKET_TIMEOUT, 0, &running);
+
+    struct epoll_event events[EPOLL_BATCH];
+    while (loop.active > 0 || loop.schedule_ms >= 0) {
+        int ready = epoll_wait(loop.epoll_fd, events, EPOLL_BATCH, next_timeout(&loop));
+        if (ready < 0 && errno != EINTR) break;
+
+        if (ready <= 0) {
+            curl_multi_socket_action(loop.multi, CURL_SOCKET_TIMEOUT, 0, &running);
+        } else {
+            for (int i = 0; i < ready; i++) {
+                int flags = 0;
+                if (events[i].events & EPOLLIN) flags |= CURL_CSELECT_IN;
+                if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) flags |= CURL_CSELECT_ERR;
+                curl_multi_socket_action(loop.multi, events[i].data.fd, flags, &running);
+            }
+            // Sockets were busy while a timer expired
+            if (loop.timeout_ms == 0) {
+                curl_multi_socket_action(loop.multi, CURL_SOCKET_TIMEOUT, 0, &running);
+            }
+        }
+
+        collect_finished(manager, &loop);
+        int started = restart_due(manager, &loop, slots);
+        if (fill_slots(manager, &loop) + started > 0) {
+            curl_multi_socket_action(loop.multi, CURL_SOCKET_TIMEOUT, 0, &running);
+        }
+    }
+
+    for (int i = 0; i < slots; i++) {
+        // Transfers are only left in flight after an epoll failure
+        if (loop.transfers[i].job >= 0) {
+            if (!loop.transfers[i].retry_at) curl_multi_remove_handle(loop.multi, loop.transfers[i].curl);
+            release_response(&loop.transfers[i].response);
+        }
+        if (loop.transfers[i].curl) curl_easy_cleanup(loop.transfers[i].curl);
+    }
+
+    curl_multi_cleanup(loop.multi);
+    close(loop.epoll_fd);
+    free(loop.transfers);
+    free(loop.idle);
+    return 1;
+}
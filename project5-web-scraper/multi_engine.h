@@ -0,0 +1,14 @@
+#ifndef MULTI_ENGINE_H
+#define MULTI_ENGINE_H
+
+#include "web_scraper.h"
+
+#define EPOLL_BATCH 256
+
+// Runs every job on the calling thread: curl_multi reports the sockets it
+// needs through a socket callback, epoll waits on them, and up to
+// manager->max_transfers transfers stay in flight at once.
+// Returns 0 if the event loop could not be set up.
+int run_multi_engine(ScraperManager *manager);
+
+#endif
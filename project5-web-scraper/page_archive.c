@@ -0,0 +1,418 @@
+#include "page_archive.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define MIN_ARCHIVE_SLOTS 1024
+#define SEGMENT_BUFFER_SIZE (256 * 1024)    // Small records reach the disk in batches
+#define COPY_BUFFER_SIZE 65536              // Bodies move between files in chunks this big
+#define RECORD_END "\r\n\r\n"
+#define REVISIT_PROFILE "http://netpreserve.org/warc/1.1/revisit/identical-payload-digest"
+
+int page_archive_can_compress(void) {
+#ifdef HAVE_ZLIB
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static size_t digest_slot(const uint8_t *digest, size_t mask) {
+    uint64_t hash;
+    memcpy(&hash, digest, sizeof(hash));
+    return (size_t)hash & mask;
+}
+
+static ArchiveEntry* find_entry(PageArchive *archive, const uint8_t *digest) {
+    size_t slot = digest_slot(digest, archive->mask);
+    while (archive->entries[slot].url) {
+        if (memcmp(archive->entries[slot].digest, digest, SHA256_DIGEST_LENGTH) == 0) {
+            return &archive->entries[slot];
+        }
+        slot = (slot + 1) & archive->mask;
+    }
+    return NULL;
+}
+
+static void place_entry(ArchiveEntry *entries, size_t mask, const ArchiveEntry *entry) {
+    size_t slot = digest_slot(entry->digest, mask);
+    while (entries[slot].url) slot = (slot + 1) & mask;
+    entries[slot] = *entry;
+}
+
+static int reserve_entries(PageArchive *archive) {
+    if (archive->entries && (archive->count + 1) * 2 <= archive->mask + 1) return 1;
+
+    size_t slots = archive->entries ? (archive->mask + 1) * 2 : MIN_ARCHIVE_SLOTS;
+    ArchiveEntry *grown = calloc(slots, sizeof(ArchiveEntry));
+    if (!grown) return 0;
+    if (archive->entries) {
+        for (size_t i = 0; i <= archive->mask; i++) {
+            if (archive->entries[i].url) place_entry(grown, slots - 1, &archive->entries[i]);
+        }
+        free(archive->entries);
+    }
+    archive->entries = grown;
+    archive->mask = slots - 1;
+    return 1;
+}
+
+// Remembers the record holding a body; takes a copy of the URL
+static int add_entry(PageArchive *archive, const uint8_t *digest, const char *record_id, const char *url,
+                     int written) {
+    if (!reserve_entries(archive)) return 0;
+
+    ArchiveEntry entry;
+    memcpy(entry.digest, digest, SHA256_DIGEST_LENGTH);
+    snprintf(entry.record_id, sizeof(entry.record_id), "%s", record_id);
+    entry.url = strdup(url);
+    if (!entry.url) return 0;
+    entry.written = written;
+    place_entry(archive->entries, archive->mask, &entry);
+    archive->count++;
+    return 1;
+}
+
+// Empties a slot, moving later entries of the probe run back so that
+// find_entry still reaches them
+static void remove_entry(PageArchive *archive, ArchiveEntry *entry) {
+    size_t hole = (size_t)(entry - archive->entries);
+    free(entry->url);
+    entry->url = NULL;
+    archive->count--;
+
+    for (size_t slot = (hole + 1) & archive->mask; archive->entries[slot].url;
+         slot = (slot + 1) & archive->mask) {
+        size_t home = digest_slot(archive->entries[slot].digest, archive->mask);
+        if (((slot - home) & archive->mask) >= ((slot - hole) & archive->mask)) {
+            archive->entries[hole] = archive->entries[slot];
+            archive->entries[slot].url = NULL;
+            hole = slot;
+        }
+    }
+}
+
+static void digest_to_hex(const uint8_t *digest, char *hex) {
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) sprintf(hex + i * 2, "%02x", digest[i]);
+}
+
+static int hex_to_digest(const char *hex, uint8_t *digest) {
+    if (strlen(hex) != SHA256_DIGEST_LENGTH * 2) return 0;
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+        unsigned int byte;
+        if (sscanf(hex + i * 2, "%2x", &byte) != 1) return 0;
+        digest[i] = (uint8_t)byte;
+    }
+    return 1;
+}
+
+// splitmix64: one state per archive is plenty for unique record IDs
+static uint64_t next_random(PageArchive *archive) {
+    uint64_t z = (archive->random_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// A random (version 4) UUID URN, as WARC-Record-ID expects
+static void new_record_id(PageArchive *archive, char *record_id) {
+    uint64_t high = next_random(archive), low = next_random(archive);
+    high = (high & ~0xf000ull) | 0x4000ull;
+    low = (low & ~(3ull << 62)) | (2ull << 62);
+    snprintf(record_id, ARCHIVE_RECORD_ID_LENGTH, "<urn:uuid:%08x-%04x-%04x-%04x-%012llx>",
+             (unsigned int)(high >> 32), (unsigned int)(high >> 16) & 0xffff, (unsigned int)high & 0xffff,
+             (unsigned int)(low >> 48), (unsigned long long)(low & 0xffffffffffffull));
+}
+
+static void segment_name(char *name, size_t size, int number, int compress) {
+    snprintf(name, size, "segment-%05d.warc%s", number, compress ? ".gz" : "");
+}
+
+// Reads the index of an earlier session: its bodies become revisit
+// targets and its highest segment number is not reused
+static int load_index(PageArchive *archive, const char *path) {
+    FILE *index = fopen(path, "r");
+    if (!index) return errno == ENOENT;
+
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    int ok = 1;
+    while (ok && (length = getline(&line, &capacity, index)) != -1) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *fields[7];
+        char *cursor = line;
+        int count = 0;
+        while (count < 7 && cursor) {
+            fields[count++] = cursor;
+            cursor = count < 7 ? strchr(cursor, '\t') : NULL;
+            if (cursor) *cursor++ = '\0';
+        }
+        if (count < 7) continue;
+
+        int number;
+        if (sscanf(fields[1], "segment-%d", &number) == 1 && number >= archive->segment_number) {
+            archive->segment_number = number + 1;
+        }
+        uint8_t digest[SHA256_DIGEST_LENGTH];
+        if (strcmp(fields[4], "resource") == 0 && hex_to_digest(fields[0], digest) &&
+            !find_entry(archive, digest)) {
+            ok = add_entry(archive, digest, fields[5], fields[6], 1);
+        }
+    }
+    free(line);
+    fclose(index);
+    return ok;
+}
+
+int page_archive_open(PageArchive *archive, const char *dir, int compress) {
+    char path[MAX_ARCHIVE_PATH + sizeof(ARCHIVE_INDEX_NAME) + 1];
+
+    memset(archive, 0, sizeof(*archive));
+    if (strlen(dir) >= sizeof(archive->dir) || (compress && !page_archive_can_compress())) return 0;
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return 0;
+    strcpy(archive->dir, dir);
+    archive->compress = compress;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    archive->random_state = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    archive->random_state ^= (uint64_t)getpid() << 32;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, ARCHIVE_INDEX_NAME);
+    if (!reserve_entries(archive) || !load_index(archive, path) || !(archive->index = fopen(path, "a"))) {
+        page_archive_close(archive);
+        return 0;
+    }
+    pthread_mutex_init(&archive->lock, NULL);
+    pthread_cond_init(&archive->record_written, NULL);
+    return 1;
+}
+
+int page_archive_is_open(const PageArchive *archive) {
+    return archive->index != NULL;
+}
+
+// Makes sure the current segment can take `length` more bytes
+static int ready_segment(PageArchive *archive, size_t length) {
+    if (archive->segment && (archive->segment_size == 0 ||
+                             archive->segment_size + length <= ARCHIVE_SEGMENT_BYTES)) {
+        return 1;
+    }
+    if (archive->segment) {
+        int closed = fclose(archive->segment) == 0;
+        archive->segment = NULL;
+        archive->segment_number++;
+        if (!closed) return 0;
+    }
+
+    char path[MAX_ARCHIVE_PATH + 64];
+    segment_name(archive->segment_name, sizeof(archive->segment_name), archive->segment_number,
+                 archive->compress);
+    snprintf(path, sizeof(path), "%s/%s", archive->dir, archive->segment_name);
+    archive->segment = fopen(path, "ab");
+    if (!archive->segment) return 0;
+    setvbuf(archive->segment, NULL, _IOFBF, SEGMENT_BUFFER_SIZE);
+
+    // Leftovers of a session whose index lines were lost stay in front
+    fseek(archive->segment, 0, SEEK_END);
+    long end = ftell(archive->segment);
+    archive->segment_size = end > 0 ? (unsigned long long)end : 0;
+    return 1;
+}
+
+// WARC header block of a record, including the blank line before its
+// content; returns its length, 0 if out of memory
+static size_t format_header(char **header, const char *type, const char *url, const char *record_id,
+                            const char *digest_hex, const char *content_type, const ArchiveEntry *original,
+                            size_t content_length) {
+    char date[32];
+    time_t now = time(NULL);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    size_t capacity = 1024 + strlen(url) + strlen(content_type) + (original ? strlen(original->url) : 0);
+    *header = malloc(capacity);
+    if (!*header) return 0;
+
+    int length = snprintf(*header, capacity,
+                          "WARC/1.1\r\nWARC-Type: %s\r\nWARC-Target-URI: %s\r\nWARC-Date: %s\r\n"
+                          "WARC-Record-ID: %s\r\nWARC-Payload-Digest: sha256:%s\r\n",
+                          type, url, date, record_id, digest_hex);
+    if (original) {
+        length += snprintf(*header + length, capacity - length,
+                           "WARC-Profile: " REVISIT_PROFILE "\r\nWARC-Refers-To: %s\r\n"
+                           "WARC-Refers-To-Target-URI: %s\r\n", original->record_id, original->url);
+    } else {
+        length += snprintf(*header + length, capacity - length, "Content-Type: %s\r\n", content_type);
+    }
+    length += snprintf(*header + length, capacity - length, "Content-Length: %zu\r\n\r\n", content_length);
+    return (size_t)length;
+}
+
+// Copies the first `length` bytes of `in` to `out`
+static int copy_part(FILE *in, size_t length, FILE *out) {
+    char buffer[COPY_BUFFER_SIZE];
+    if (length > 0 && fseek(in, 0, SEEK_SET) != 0) return 0;
+    while (length > 0) {
+        size_t chunk = length < sizeof(buffer) ? length : sizeof(buffer);
+        if (fread(buffer, 1, chunk, in) != chunk || fwrite(buffer, 1, chunk, out) != chunk) return 0;
+        length -= chunk;
+    }
+    return 1;
+}
+
+#ifdef HAVE_ZLIB
+// Deflates `length` bytes into `out`, a chunk of output at a time
+static int deflate_part(z_stream *stream, const void *data, size_t length, int flush, FILE *out) {
+    unsigned char buffer[COPY_BUFFER_SIZE];
+    int result;
+    stream->next_in = (Bytef *)data;
+    stream->avail_in = (uInt)length;
+    do {
+        stream->next_out = buffer;
+        stream->avail_out = sizeof(buffer);
+        result = deflate(stream, flush);
+        size_t produced = sizeof(buffer) - stream->avail_out;
+        if (result == Z_STREAM_ERROR || fwrite(buffer, 1, produced, out) != produced) return 0;
+    } while (stream->avail_out == 0);
+    return flush != Z_FINISH || result == Z_STREAM_END;
+}
+
+// Deflates header, the first `size` bytes of `body` and the record end
+// into one gzip member in `out`
+static int compress_record(const char *header, size_t header_length, FILE *body, size_t size,
+                           FILE *out, size_t *out_length) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return 0;
+    }
+
+    char buffer[COPY_BUFFER_SIZE];
+    int ok = deflate_part(&stream, header, header_length, Z_NO_FLUSH, out) &&
+             (size == 0 || fseek(body, 0, SEEK_SET) == 0);
+    while (ok && size > 0) {
+        size_t chunk = size < sizeof(buffer) ? size : sizeof(buffer);
+        ok = fread(buffer, 1, chunk, body) == chunk && deflate_part(&stream, buffer, chunk, Z_NO_FLUSH, out);
+        size -= chunk;
+    }
+    ok = ok && deflate_part(&stream, RECORD_END, 4, Z_FINISH, out);
+    *out_length = stream.total_out;
+    deflateEnd(&stream);
+    return ok;
+}
+#endif
+
+int page_archive_store(PageArchive *archive, const char *url, const char *content_type, FILE *body,
+                       size_t size, const uint8_t *digest, int *duplicate) {
+    char digest_hex[SHA256_DIGEST_LENGTH * 2 + 1];
+    char record_id[ARCHIVE_RECORD_ID_LENGTH];
+    ArchiveEntry original;
+
+    digest_to_hex(digest, digest_hex);
+    if (!content_type) content_type = "application/octet-stream";
+
+    // Claim the digest first, so a copy finishing on another thread while
+    // this record is being compressed already becomes a revisit. That
+    // copy waits for the record it refers to, and claims the digest
+    // itself if the record could not be written.
+    pthread_mutex_lock(&archive->lock);
+    ArchiveEntry *entry;
+    while ((entry = find_entry(archive, digest)) && !entry->written) {
+        pthread_cond_wait(&archive->record_written, &archive->lock);
+    }
+    *duplicate = entry != NULL;
+    if (entry) original = *entry;
+    new_record_id(archive, record_id);
+    int claimed = entry || add_entry(archive, digest, record_id, url, 0);
+    pthread_mutex_unlock(&archive->lock);
+    if (!claimed) return 0;
+
+    // Building and compressing the record happens outside the lock; a
+    // compressed record is spooled to a temporary file of its own
+    char *header;
+    FILE *packed = NULL;
+    size_t content_length = *duplicate ? 0 : size;
+    size_t header_length = format_header(&header, *duplicate ? "revisit" : "resource", url, record_id,
+                                         digest_hex, content_type, *duplicate ? &original : NULL,
+                                         content_length);
+    size_t record_length = header_length + content_length + 4;
+    int ok = header_length > 0;
+#ifdef HAVE_ZLIB
+    if (ok && archive->compress) {
+        packed = tmpfile();
+        ok = packed && compress_record(header, header_length, body, content_length, packed, &record_length);
+    }
+#endif
+
+    pthread_mutex_lock(&archive->lock);
+    int ready = ok && ready_segment(archive, record_length);
+    ok = ready;
+    unsigned long long offset = archive->segment_size;
+    if (ok && packed) {
+        ok = copy_part(packed, record_length, archive->segment);
+    } else if (ok) {
+        ok = fwrite(header, 1, header_length, archive->segment) == header_length &&
+             copy_part(body, content_length, archive->segment) &&
+             fwrite(RECORD_END, 1, 4, archive->segment) == 4;
+    }
+    if (ready && !ok) {
+        // Part of the record may be in the segment; later records go to a
+        // new one so that their offsets stay right
+        fclose(archive->segment);
+        archive->segment = NULL;
+        archive->segment_number++;
+    } else if (ok) {
+        archive->segment_size += record_length;
+        archive->records++;
+        archive->duplicates += *duplicate;
+        archive->body_bytes += size;
+        archive->stored_bytes += record_length;
+        ok = fprintf(archive->index, "%s\t%s\t%llu\t%zu\t%s\t%s\t%s\n", digest_hex, archive->segment_name,
+                     offset, record_length, *duplicate ? "revisit" : "resource", record_id, url) > 0;
+    }
+    if (!*duplicate) {
+        // Settle the claim; a failed record must not become a revisit target
+        entry = find_entry(archive, digest);
+        if (ok) {
+            entry->written = 1;
+        } else {
+            remove_entry(archive, entry);
+        }
+        pthread_cond_broadcast(&archive->record_written);
+    }
+    pthread_mutex_unlock(&archive->lock);
+
+    free(header);
+    if (packed) fclose(packed);
+    return ok;
+}
+
+int page_archive_flush(PageArchive *archive) {
+    pthread_mutex_lock(&archive->lock);
+    int ok = (!archive->segment || fflush(archive->segment) == 0) && fflush(archive->index) == 0;
+    pthread_mutex_unlock(&archive->lock);
+    return ok;
+}
+
+void page_archive_close(PageArchive *archive) {
+    if (archive->index) {
+        if (archive->segment) fclose(archive->segment);
+        fclose(archive->index);
+        pthread_mutex_destroy(&archive->lock);
+        pthread_cond_destroy(&archive->record_written);
+    }
+    if (archive->entries) {
+        for (size_t i = 0; i <= archive->mask; i++) free(archive->entries[i].url);
+        free(archive->entries);
+    }
+    memset(archive, 0, sizeof(*archive));
+}
@@ -0,0 +1,73 @@
+#ifndef PAGE_ARCHIVE_H
+#define PAGE_ARCHIVE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "sha256.h"
+
+#define MAX_ARCHIVE_PATH 512
+#define ARCHIVE_SEGMENT_BYTES (1024ULL * 1024 * 1024)  // A new segment starts past this size
+#define ARCHIVE_RECORD_ID_LENGTH 48                     // "<urn:uuid:...>" and its NUL
+#define ARCHIVE_INDEX_NAME "index.tsv"
+
+// A body already in the archive: later copies become revisit records
+// pointing at `record_id`
+typedef struct {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    char record_id[ARCHIVE_RECORD_ID_LENGTH];
+    char *url;              // NULL marks an empty slot
+    int written;            // 0 while the thread that claimed the body is still writing it
+} ArchiveEntry;
+
+// Pages appended to a few large segment files instead of one file each.
+// Records follow WARC/1.1: a "resource" record holds a body the archive
+// has not seen, a body whose SHA-256 matches an earlier one becomes an
+// empty "revisit" record that refers to it. With compression each record
+// is its own gzip member, so a reader can still seek to any record.
+//
+// <dir>/segment-NNNNN.warc[.gz] are the segments; <dir>/index.tsv has one
+// line per record: digest, segment, offset, length, type, record id, URL.
+// Reopening an archive reads the index back, so deduplication spans runs,
+// and starts a new segment. Safe to call from any number of threads.
+typedef struct {
+    char dir[MAX_ARCHIVE_PATH];
+    int compress;
+    pthread_mutex_t lock;
+    pthread_cond_t record_written;  // An entry was written or given up
+    FILE *segment;          // Opened by the first record of a session
+    FILE *index;
+    int segment_number;
+    char segment_name[32];
+    unsigned long long segment_size;
+    ArchiveEntry *entries;  // Open addressing on the digest, doubling at half load
+    size_t mask;
+    size_t count;
+    uint64_t random_state;  // Source of record IDs
+    int records;            // Written since the archive was opened
+    int duplicates;
+    unsigned long long body_bytes;
+    unsigned long long stored_bytes;
+} PageArchive;
+
+// 1 if the build can compress records (zlib was found)
+int page_archive_can_compress(void);
+
+// Creates `dir` if needed and loads its index; returns 0 on failure
+int page_archive_open(PageArchive *archive, const char *dir, int compress);
+
+int page_archive_is_open(const PageArchive *archive);
+
+// Appends a page's body: the first `size` bytes of `body`, whose SHA-256
+// is `digest`. The body is copied in chunks, never held in memory whole.
+// `duplicate` is set when only a revisit record was needed. Returns 0 if
+// the record could not be written.
+int page_archive_store(PageArchive *archive, const char *url, const char *content_type, FILE *body,
+                       size_t size, const uint8_t *digest, int *duplicate);
+
+// Pushes buffered records and index lines to disk
+int page_archive_flush(PageArchive *archive);
+
+void page_archive_close(PageArchive *archive);
+
+#endif
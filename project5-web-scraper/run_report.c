@@ -0,0 +1,179 @@
+#include "run_report.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *phase_names[JOB_PHASES] = {"dns", "connect", "tls", "ttfb", "transfer"};
+
+const char* phase_name(JobPhase phase) {
+    return phase_names[phase];
+}
+
+static int compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const float *sorted, int count, int p) {
+    int rank = (int)(((long long)p * count + 99) / 100);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+// Sorts `values` in place and summarises them
+static void summarise(float *values, int count, LatencySummary *summary) {
+    memset(summary, 0, sizeof(*summary));
+    if (count == 0) return;
+
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += values[i];
+    qsort(values, (size_t)count, sizeof(float), compare_floats);
+    summary->mean = sum / count;
+    summary->p50 = percentile(values, count, 50);
+    summary->p95 = percentile(values, count, 95);
+    summary->p99 = percentile(values, count, 99);
+}
+
+int build_report(const JobStore *jobs, double makespan, RunReport *report) {
+    memset(report, 0, sizeof(*report));
+    report->requests = jobs->count;
+    report->makespan = makespan;
+
+    float *values = malloc((jobs->count > 0 ? jobs->count : 1) * sizeof(float));
+    if (!values) return 0;
+
+    for (int i = 0; i < jobs->count; i++) {
+        if (jobs->flags[i] & JOB_SUCCESS) report->successful++;
+        if (jobs->flags[i] & JOB_NOT_MODIFIED) report->not_modified++;
+        report->retries += jobs->retries[i];
+        report->bytes += jobs->bytes[i];
+    }
+    if (makespan > 0) {
+        report->requests_per_second = jobs->count / makespan;
+        report->megabytes_per_second = report->bytes / (1024.0 * 1024.0) / makespan;
+    }
+
+    // Jobs that never got a response have no phases worth ranking
+    int answered = 0;
+    for (int i = 0; i < jobs->count; i++) {
+        if (jobs->status[i] != 0) values[answered++] = jobs->seconds[i];
+    }
+    report->answered = answered;
+    summarise(values, answered, &report->total);
+
+    for (int phase = 0; phase < JOB_PHASES; phase++) {
+        int count = 0;
+        for (int i = 0; i < jobs->count; i++) {
+            if (jobs->status[i] != 0) values[count++] = jobs->phases[i][phase];
+        }
+        summarise(values, count, &report->phases[phase]);
+    }
+
+    free(values);
+    return 1;
+}
+
+// JSON string with quotes, backslashes and control characters escaped
+static void write_json_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        } else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+// CSV field, quoted when it contains a separator, quote or line break
+static void write_csv_field(FILE *file, const char *text) {
+    if (!strpbrk(text, ",\"\r\n")) {
+        fputs(text, file);
+        return;
+    }
+    fputc('"', file);
+    for (const char *c = text; *c; c++) {
+        if (*c == '"') fputc('"', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static void write_json_latency(FILE *file, const char *name, const LatencySummary *summary, int last) {
+    fprintf(file, "      \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f}%s\n", name,
+            summary->mean * 1000, summary->p50 * 1000, summary->p95 * 1000, summary->p99 * 1000,
+            last ? "" : ",");
+}
+
+static void write_json(FILE *file, const JobStore *jobs, const RunReport *report) {
+    fprintf(file, "{\n  \"summary\": {\n");
+    fprintf(file, "    \"engine\": ");
+    write_json_string(file, report->engine ? report->engine : "");
+    fprintf(file, ",\n    \"concurrency\": %d,\n", report->concurrency);
+    fprintf(file, "    \"requests\": %d,\n    \"successful\": %d,\n    \"answered\": %d,\n",
+            report->requests, report->successful, report->answered);
+    fprintf(file, "    \"retries\": %d,\n    \"not_modified\": %d,\n    \"bytes\": %.0f,\n",
+            report->retries, report->not_modified, report->bytes);
+    fprintf(file, "    \"makespan_seconds\": %.6f,\n    \"requests_per_second\": %.3f,\n"
+            "    \"megabytes_per_second\": %.3f,\n", report->makespan, report->requests_per_second,
+            report->megabytes_per_second);
+    fprintf(file, "    \"latency_ms\": {\n");
+    write_json_latency(file, "total", &report->total, 0);
+    for (int phase = 0; phase < JOB_PHASES; phase++) {
+        write_json_latency(file, phase_names[phase], &report->phases[phase], phase == JOB_PHASES - 1);
+    }
+    fprintf(file, "    }\n  },\n  \"jobs\": [\n");
+
+    for (int i = 0; i < jobs->count; i++) {
+        fprintf(file, "    {\"job\": %d, \"url\": ", i);
+        write_json_string(file, jobs->urls[i]);
+        fprintf(file, ", \"status\": %u, \"success\": %s, \"not_modified\": %s, \"retries\": %u, "
+                "\"bytes\": %llu, \"total_ms\": %.3f",
+                jobs->status[i], (jobs->flags[i] & JOB_SUCCESS) ? "true" : "false",
+                (jobs->flags[i] & JOB_NOT_MODIFIED) ? "true" : "false", jobs->retries[i],
+                (unsigned long long)jobs->bytes[i], jobs->seconds[i] * 1000.0);
+        for (int phase = 0; phase < JOB_PHASES; phase++) {
+            fprintf(file, ", \"%s_ms\": %.3f", phase_names[phase], jobs->phases[i][phase] * 1000.0);
+        }
+        fprintf(file, "}%s\n", i + 1 < jobs->count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+static void write_csv(FILE *file, const JobStore *jobs) {
+    fprintf(file, "job,url,status,success,not_modified,retries,bytes,total_ms");
+    for (int phase = 0; phase < JOB_PHASES; phase++) fprintf(file, ",%s_ms", phase_names[phase]);
+    fprintf(file, "\n");
+
+    for (int i = 0; i < jobs->count; i++) {
+        fprintf(file, "%d,", i);
+        write_csv_field(file, jobs->urls[i]);
+        fprintf(file, ",%u,%d,%d,%u,%llu,%.3f", jobs->status[i], (jobs->flags[i] & JOB_SUCCESS) != 0,
+                (jobs->flags[i] & JOB_NOT_MODIFIED) != 0, jobs->retries[i],
+                (unsigned long long)jobs->bytes[i], jobs->seconds[i] * 1000.0);
+        for (int phase = 0; phase < JOB_PHASES; phase++) {
+            fprintf(file, ",%.3f", jobs->phases[i][phase] * 1000.0);
+        }
+        fprintf(file, "\n");
+    }
+}
+
+int export_report(const JobStore *jobs, const RunReport *report, const char *path, ReportFormat format) {
+    FILE *file = fopen(path, "w");
+    if (!file) return 0;
+
+    if (format == REPORT_CSV) {
+        write_csv(file, jobs);
+    } else {
+        write_json(file, jobs, report);
+    }
+
+    int ok = !ferror(file);
+    if (fclose(file) != 0) ok = 0;
+    return ok;
+}
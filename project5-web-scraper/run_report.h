@@ -0,0 +1,47 @@
+#ifndef RUN_REPORT_H
+#define RUN_REPORT_H
+
+#include "job_store.h"
+
+// Export formats of export_report
+typedef enum {
+    REPORT_JSON,            // Summary, latency percentiles and one object per job
+    REPORT_CSV              // One row per job
+} ReportFormat;
+
+// Distribution of one latency over the jobs that got a response, in seconds
+typedef struct {
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+} LatencySummary;
+
+// End-of-run figures. Latencies come from the monotonic clock (the total)
+// and from libcurl's per-phase timers (the phases of the final attempt);
+// throughput is measured against the run's wall-clock makespan.
+typedef struct {
+    const char *engine;
+    int concurrency;
+    int requests;
+    int successful;
+    int answered;           // Jobs that got an HTTP response
+    int retries;
+    int not_modified;
+    double bytes;
+    double makespan;        // Seconds from start_scraping until the last job finished
+    double requests_per_second;
+    double megabytes_per_second;
+    LatencySummary total;
+    LatencySummary phases[JOB_PHASES];
+} RunReport;
+
+const char* phase_name(JobPhase phase);
+
+// Fills `report` from the store's results; returns 0 if out of memory
+int build_report(const JobStore *jobs, double makespan, RunReport *report);
+
+// Writes the report and every job's timings to `path`; returns 0 on failure
+int export_report(const JobStore *jobs, const RunReport *report, const char *path, ReportFormat format);
+
+#endif
@@ -0,0 +1,311 @@
+#include "web_scraper.h"
+#include "bench_server.h"
+#include <dirent.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+// Compares the threaded and event-driven engines against a local stand-in
+// server. Each run happens in its own child process so its peak RSS can be
+// read back with wait4().
+//   scraper_bench [--requests N] [--body BYTES] [--delay MS] [--workers N] [--transfers N]
+//                 [--hosts N] [--host-limit N] [--host-rate R] [--fail-every N] [--save] [--cache]
+//                 [--crawl DEPTH] [--links N] [--archive] [--compress]
+// With --cache each engine runs twice over its own cache directory: a cold
+// pass that fills it and a warm pass that revalidates every page.
+// With --crawl each host is seeded with "/" only and the rest is found by
+// following the N links every page carries, DEPTH levels deep.
+// --archive saves into a page archive instead of one file per page
+// (--compress gzips its records); the server sends the same body for
+// every page, so all but the first become revisit records.
+
+typedef struct {
+    int requests;
+    BenchServerConfig server;
+    int workers;
+    int transfers;
+    int hosts;              // Distinct origins the requests are spread over
+    int host_limit;
+    double host_rate;
+    int save;               // Stream bodies to files in a scratch directory
+    int archive;            // Save into a page archive in the scratch directory instead
+    int compress;
+    int cache;              // Cold and warm pass over a scratch HTTP cache
+    int crawl;              // Link depth to crawl from each host's root, 0 for none
+} BenchOptions;
+
+typedef struct {
+    int jobs;               // Listed plus found by crawling
+    int successful;
+    int reused;             // Requests served over an existing connection
+    int retries;
+    int not_modified;
+    double bytes;           // Body bytes over the network
+    double seconds;
+    double p50;             // Request latency percentiles, seconds
+    double p99;
+    int files;              // In the scratch directory after the pass
+    double disk_bytes;
+} RunResult;
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int parse_options(int argc, char **argv, BenchOptions *options) {
+    options->requests = 2000;
+    options->server.body_size = 16384;
+    options->server.delay_ms = 10;
+    options->workers = 16;
+    options->transfers = 256;
+    options->hosts = 1;
+    options->host_limit = 0;
+    options->host_rate = 0.0;
+    options->server.fail_every = 0;
+    options->save = 0;
+    options->archive = 0;
+    options->compress = 0;
+    options->cache = 0;
+    options->crawl = 0;
+    options->server.links = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--save") == 0) {
+            options->save = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--archive") == 0) {
+            options->save = 1;
+            options->archive = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--compress") == 0) {
+            options->save = 1;
+            options->archive = 1;
+            options->compress = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--cache") == 0) {
+            options->cache = 1;
+            continue;
+        }
+        if (i + 1 >= argc) return 0;
+        int value = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--requests") == 0) options->requests = value;
+        else if (strcmp(argv[i], "--body") == 0) options->server.body_size = (size_t)value;
+        else if (strcmp(argv[i], "--delay") == 0) options->server.delay_ms = value;
+        else if (strcmp(argv[i], "--workers") == 0) options->workers = value;
+        else if (strcmp(argv[i], "--transfers") == 0) options->transfers = value;
+        else if (strcmp(argv[i], "--hosts") == 0) options->hosts = value;
+        else if (strcmp(argv[i], "--host-limit") == 0) options->host_limit = value;
+        else if (strcmp(argv[i], "--host-rate") == 0) options->host_rate = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--fail-every") == 0) options->server.fail_every = value;
+        else if (strcmp(argv[i], "--crawl") == 0) options->crawl = value;
+        else if (strcmp(argv[i], "--links") == 0) options->server.links = value;
+        else return 0;
+        i++;
+    }
+    return options->requests > 0 && options->workers > 0 && options->transfers > 0 &&
+           options->hosts > 0 && options->host_limit >= 0 && options->host_rate >= 0 &&
+           options->server.fail_every >= 0 && options->crawl >= 0 && options->crawl <= MAX_CRAWL_DEPTH &&
+           options->server.links >= 0 && (!options->compress || page_archive_can_compress());
+}
+
+// Scratch directories are flat, so one level of unlinking empties them
+static void remove_directory(const char *path) {
+    DIR *dir = opendir(path);
+    if (dir) {
+        char file[MAX_CACHE_PATH];
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+            unlink(file);
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+}
+
+// Files in a flat scratch directory and the disk space they take
+static void directory_usage(const char *path, int *files, double *bytes) {
+    *files = 0;
+    *bytes = 0.0;
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    char file[MAX_CACHE_PATH];
+    struct dirent *entry;
+    struct stat info;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        if (stat(file, &info) != 0) continue;
+        (*files)++;
+        *bytes += (double)info.st_blocks * 512;
+    }
+    closedir(dir);
+}
+
+static void run_pass(ScraperManager *manager, const char *directory, RunResult *result) {
+    double start = monotonic_seconds();
+    start_scraping(manager);
+    wait_for_completion(manager);
+    result->seconds = monotonic_seconds() - start;
+    result->jobs = manager->jobs.count;
+    result->successful = count_successful_downloads(manager);
+    int answered;
+    result->reused = count_reused_connections(manager, &answered);
+    result->retries = count_retries(manager);
+    result->not_modified = count_not_modified(manager);
+    result->bytes = calculate_total_bytes(manager);
+    
+    RunReport report;
+    if (build_run_report(manager, &report)) {
+        result->p50 = report.total.p50;
+        result->p99 = report.total.p99;
+    }
+    if (manager->save_files) directory_usage(directory, &result->files, &result->disk_bytes);
+}
+
+// Child process: scrape every URL with the given engine, once or (with
+// --cache) twice
+static void run_engine(const BenchOptions *options, int port, ScraperEngine engine, int result_fd) {
+    RunResult results[2];
+    memset(results, 0, sizeof(results));
+    ScraperManager *manager = init_scraper(options->requests);
+    if (manager) {
+        char url[MAX_URL_LENGTH];
+        char directory[] = "/tmp/scraper_bench_XXXXXX";
+        char cache[] = "/tmp/scraper_cache_XXXXXX";
+        manager->verbose = 0;
+        manager->save_files = options->save && mkdtemp(directory) && chdir(directory) == 0;
+        set_cache_dir(manager, options->cache && mkdtemp(cache) ? cache : NULL);
+        // The scratch directory is the archive, keeping it flat
+        if (manager->save_files && options->archive) {
+            set_output(manager, OUTPUT_ARCHIVE, directory, options->compress);
+        }
+        set_engine(manager, engine);
+        set_concurrency(manager, engine == ENGINE_MULTI ? options->transfers : options->workers);
+        set_host_limits(manager, options->host_limit, options->host_rate);
+        set_crawl_depth(manager, options->crawl);
+        // libcurl resolves every *.localhost name to the loopback server
+        if (options->crawl > 0) {
+            for (int i = 0; i < options->hosts; i++) {
+                snprintf(url, sizeof(url), "http://host%d.localhost:%d/", i, port);
+                add_url(manager, url);
+            }
+        } else {
+            for (int i = 0; i < options->requests; i++) {
+                snprintf(url, sizeof(url), "http://host%d.localhost:%d/page/%d", i % options->hosts, port, i);
+                add_url(manager, url);
+            }
+        }
+
+        // Progress lines from the engines are not part of the report
+        if (!freopen("/dev/null", "w", stdout)) return;
+        run_pass(manager, directory, &results[0]);
+        if (options->cache) run_pass(manager, directory, &results[1]);
+
+        if (manager->save_files) remove_directory(directory);
+        if (manager->cache_dir[0]) remove_directory(manager->cache_dir);
+        free_scraper(manager);
+    }
+    size_t size = sizeof(RunResult) * (options->cache ? 2 : 1);
+    if (write(result_fd, results, size) != (ssize_t)size) _exit(1);
+    _exit(0);
+}
+
+static int measure(const BenchOptions *options, int port, ScraperEngine engine) {
+    int fds[2];
+    if (pipe(fds) != 0) return 0;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return 0;
+    if (pid == 0) {
+        close(fds[0]);
+        run_engine(options, port, engine, fds[1]);
+    }
+    close(fds[1]);
+
+    RunResult results[2];
+    int passes = options->cache ? 2 : 1;
+    size_t size = sizeof(RunResult) * passes;
+    int got = read(fds[0], results, size) == (ssize_t)size;
+    close(fds[0]);
+
+    struct rusage usage;
+    int status;
+    if (wait4(pid, &status, 0, &usage) < 0 || !got) return 0;
+
+    int limit = engine == ENGINE_MULTI ? options->transfers : options->workers;
+    for (int pass = 0; pass < passes; pass++) {
+        RunResult *result = &results[pass];
+        char label[32];
+        snprintf(label, sizeof(label), "%s%s", engine == ENGINE_MULTI ? "multi" : "threaded",
+                 !options->cache ? "" : pass == 0 ? "/cold" : "/warm");
+        printf("%-14s %11d %9d/%-9d %7.1f%% %7d %7d %9.1f %9.3f %10.1f %8.1f %8.1f %8d %8.1f %12.1f\n",
+               label, limit, result->successful, result->jobs,
+               result->jobs > 0 ? (double)result->reused / result->jobs * 100 : 0.0, result->retries, result->not_modified,
+               result->bytes / (1024.0 * 1024.0), result->seconds,
+               result->seconds > 0 ? result->successful / result->seconds : 0.0,
+               result->p50 * 1000, result->p99 * 1000, result->files, result->disk_bytes / (1024.0 * 1024.0),
+               usage.ru_maxrss / 1024.0);
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        fprintf(stderr, "Usage: %s [--requests N] [--body BYTES] [--delay MS] [--workers N] [--transfers N]\n"
+                "       [--hosts N] [--host-limit N] [--host-rate R] [--fail-every N] [--save] [--cache]\n"
+                "       [--crawl DEPTH] [--links N] [--archive] [--compress]\n",
+                argv[0]);
+        return 2;
+    }
+
+    int port = 0;
+    int listen_fd = bench_server_listen(&port);
+    if (listen_fd < 0) {
+        perror("listen");
+        return 1;
+    }
+
+    pid_t server = fork();
+    if (server < 0) return 1;
+    if (server == 0) {
+        run_bench_server(listen_fd, &options.server);
+        _exit(1);
+    }
+    close(listen_fd);
+
+    printf("Local server on port %d: %zu-byte bodies, %d ms latency, %d requests per run over %d host(s)%s\n",
+           port, options.server.body_size, options.server.delay_ms, options.requests, options.hosts,
+           !options.save ? "" : !options.archive ? ", saved to disk" :
+           options.compress ? ", saved to a compressed page archive" : ", saved to a page archive");
+    if (options.server.fail_every > 0) printf("Every %d-th response is a 503\n", options.server.fail_every);
+    if (options.crawl > 0) {
+        printf("Crawling %d level(s) deep from each host's root, %d links per page\n", options.crawl,
+               options.server.links);
+    }
+    if (options.host_limit > 0 || options.host_rate > 0) {
+        printf("Per-host limits: %d in flight, %.1f requests/sec (0 = none)\n", options.host_limit,
+               options.host_rate);
+    }
+    printf("\n");
+    printf("%-14s %11s %19s %8s %7s %7s %9s %9s %10s %8s %8s %8s %8s %12s\n", "Engine", "Concurrency",
+           "Successful", "Reused", "Retries", "304s", "MB in", "Seconds", "Req/s", "p50 ms", "p99 ms", "Files",
+           "Disk MB", "Peak RSS MB");
+
+    int ok = measure(&options, port, ENGINE_THREADED) && measure(&options, port, ENGINE_MULTI);
+
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_LENGTH 32
+
+// Incremental SHA-256 (FIPS 180-4)
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;        // Bytes hashed so far
+    uint8_t block[64];
+    size_t block_used;
+} Sha256;
+
+void sha256_init(Sha256 *sha);
+void sha256_update(Sha256 *sha, const void *data, size_t size);
+void sha256_final(Sha256 *sha, uint8_t digest[SHA256_DIGEST_LENGTH]);
+
+// One-shot digest of a buffer
+void sha256(const void *data, size_t size, uint8_t digest[SHA256_DIGEST_LENGTH]);
+
+#endif
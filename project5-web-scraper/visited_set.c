@@ -0,0 +1,74 @@
+#include "visited_set.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_VISITED_SLOTS 1024
+
+static uint64_t fingerprint(const char *url) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char *c = url; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
+    }
+    // Finalizer so the low bits (the slot) depend on every byte
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash ? hash : 1;
+}
+
+static void insert(uint64_t *slots, size_t mask, uint64_t hash) {
+    size_t slot = hash & mask;
+    while (slots[slot] != 0) slot = (slot + 1) & mask;
+    slots[slot] = hash;
+}
+
+int visited_set_init(VisitedSet *set, size_t expected) {
+    size_t slots = MIN_VISITED_SLOTS;
+    while (slots < expected * 2) slots *= 2;
+    set->slots = calloc(slots, sizeof(uint64_t));
+    set->mask = slots - 1;
+    set->count = 0;
+    return set->slots != NULL;
+}
+
+void visited_set_free(VisitedSet *set) {
+    free(set->slots);
+    memset(set, 0, sizeof(*set));
+}
+
+void visited_set_clear(VisitedSet *set) {
+    memset(set->slots, 0, (set->mask + 1) * sizeof(uint64_t));
+    set->count = 0;
+}
+
+static int grow(VisitedSet *set) {
+    size_t slots = (set->mask + 1) * 2;
+    uint64_t *grown = calloc(slots, sizeof(uint64_t));
+    if (!grown) return 0;
+    for (size_t i = 0; i <= set->mask; i++) {
+        if (set->slots[i] != 0) insert(grown, slots - 1, set->slots[i]);
+    }
+    free(set->slots);
+    set->slots = grown;
+    set->mask = slots - 1;
+    return 1;
+}
+
+int visited_set_add(VisitedSet *set, const char *url) {
+    uint64_t hash = fingerprint(url);
+    size_t slot = hash & set->mask;
+    while (set->slots[slot] != 0) {
+        if (set->slots[slot] == hash) return 0;
+        slot = (slot + 1) & set->mask;
+    }
+
+    if ((set->count + 1) * 2 > set->mask + 1) {
+        if (!grow(set)) return 0;
+        insert(set->slots, set->mask, hash);
+    } else {
+        set->slots[slot] = hash;
+    }
+    set->count++;
+    return 1;
+}
@@ -0,0 +1,25 @@
+#ifndef VISITED_SET_H
+#define VISITED_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// URLs a crawl has already queued, kept as 64-bit fingerprints in an
+// open-addressing table that doubles at half load: 16-32 bytes per URL
+// however long it is. Two distinct URLs share a fingerprint with odds of
+// about n^2 / 2^65, so false "already seen" answers are negligible even
+// for millions of URLs. Not thread-safe; callers hold their own lock.
+typedef struct {
+    uint64_t *slots;        // 0 marks an empty slot
+    size_t mask;
+    size_t count;
+} VisitedSet;
+
+int visited_set_init(VisitedSet *set, size_t expected);
+void visited_set_free(VisitedSet *set);
+void visited_set_clear(VisitedSet *set);
+
+// Adds `url`; returns 1 if it was new, 0 if already present or out of memory
+int visited_set_add(VisitedSet *set, const char *url);
+
+#endif
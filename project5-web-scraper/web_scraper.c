@@ -1,30 +1,76 @@
 #include "web_scraper.h"
+#include "multi_engine.h"
+#include <strings.h>
+#include <time.h>
 
-ScraperManager* init_scraper(int max_threads) {
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// initial_capacity only sizes the job store; it grows as URLs are added
+ScraperManager* init_scraper(int initial_capacity) {
     ScraperManager *manager = malloc(sizeof(ScraperManager));
     if (!manager) return NULL;
     
-    manager->threads = malloc(max_threads * sizeof(ThreadData));
-    manager->thread_ids = malloc(max_threads * sizeof(pthread_t));
+    // Initialize curl globally
+    curl_global_init(CURL_GLOBAL_DEFAULT);
     
-    if (!manager->threads || !manager->thread_ids) {
-        free(manager->threads);
+    int jobs_ready = job_store_init(&manager->jobs, initial_capacity);
+    int visited_ready = visited_set_init(&manager->visited, initial_capacity);
+    manager->thread_ids = malloc(MAX_WORKERS * sizeof(pthread_t));
+    manager->share.share = NULL;
+    memset(&manager->scheduler, 0, sizeof(manager->scheduler));
+    memset(&manager->archive, 0, sizeof(manager->archive));
+    
+    if (!jobs_ready || !visited_ready || !manager->thread_ids ||
+        !work_queue_init(&manager->queue, QUEUE_CAPACITY)) {
+        job_store_free(&manager->jobs);
+        visited_set_free(&manager->visited);
         free(manager->thread_ids);
         free(manager);
+        curl_global_cleanup();
         return NULL;
     }
     
-    manager->count = 0;
+    // Without the share every handle just keeps its own caches
+    if (!connection_share_init(&manager->share)) {
+        printf("Warning: connection sharing unavailable\n");
+    }
     
-    // Initialize curl globally
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+    manager->max_workers = DEFAULT_WORKERS;
+    manager->worker_count = 0;
+    manager->engine = ENGINE_THREADED;
+    manager->max_transfers = DEFAULT_TRANSFERS;
+    manager->verbose = 1;
+    manager->save_files = 1;
+    manager->host_limit = DEFAULT_HOST_CONCURRENCY;
+    manager->host_rate = 0.0;
+    manager->max_retries = DEFAULT_RETRIES;
+    strcpy(manager->cache_dir, DEFAULT_CACHE_DIR);
+    manager->run_started = 0.0;
+    manager->makespan = 0.0;
+    manager->crawl_depth = 0;
+    manager->discovered = 0;
+    manager->listed = job_store_mark(&manager->jobs);
+    manager->output = OUTPUT_FILES;
+    strcpy(manager->archive_dir, DEFAULT_ARCHIVE_DIR);
+    manager->archive_compress = 0;
+    pthread_mutex_init(&manager->jobs_lock, NULL);
     
     return manager;
 }
 
 void free_scraper(ScraperManager *manager) {
     if (manager) {
-        free(manager->threads);
+        host_scheduler_destroy(&manager->scheduler);
+        connection_share_destroy(&manager->share);
+        work_queue_destroy(&manager->queue);
+        job_store_free(&manager->jobs);
+        visited_set_free(&manager->visited);
+        page_archive_close(&manager->archive);
+        pthread_mutex_destroy(&manager->jobs_lock);
         free(manager->thread_ids);
         free(manager);
     }
@@ -32,130 +78,724 @@ void free_scraper(ScraperManager *manager) {
 }
 
 int add_url(ScraperManager *manager, const char *url) {
-    if (!manager || manager->count >= MAX_URLS || !is_valid_url(url)) {
+    if (!manager || !is_valid_url(url)) {
         return 0;
     }
+    if (job_store_add(&manager->jobs, url, strlen(url), 0) < 0) return 0;
+    manager->listed = job_store_mark(&manager->jobs);
+    return 1;
+}
+
+void clear_urls(ScraperManager *manager) {
+    job_store_clear(&manager->jobs);
+    manager->listed = job_store_mark(&manager->jobs);
+}
+
+// Fills the working state of a job from the store
+void load_job(ScraperManager *manager, int job, ThreadData *data) {
+    memset(data, 0, sizeof(*data));
+    pthread_mutex_lock(&manager->jobs_lock);
+    data->url = manager->jobs.urls[job];
+    data->depth = manager->jobs.depths[job];
+    pthread_mutex_unlock(&manager->jobs_lock);
+    data->thread_id = job;
+    data->started_at = monotonic_seconds();
+    
+    char *filename = generate_filename(data->url, job);
+    if (filename) {
+        strcpy(data->filename, filename);
+        free(filename);
+    }
+}
+
+// Records the outcome of a job in the store
+void finish_job(ScraperManager *manager, const ThreadData *data) {
+    JobResult result;
+    result.response_code = data->response_code;
+    result.download_time = monotonic_seconds() - data->started_at;
+    memcpy(result.phases, data->phases, sizeof(result.phases));
+    result.new_connections = data->new_connections;
+    result.bytes_received = data->bytes_received;
+    result.retries = data->retries;
+    result.success = data->success;
+    result.not_modified = data->not_modified;
+    pthread_mutex_lock(&manager->jobs_lock);
+    job_store_set_result(&manager->jobs, data->thread_id, &result);
+    pthread_mutex_unlock(&manager->jobs_lock);
+}
+
+// Queues a URL found on a page unless this run has already seen it. The
+// job goes into the store first, so it is complete before the scheduler
+// can hand it out.
+static void queue_link(ScraperManager *manager, const char *url, int depth) {
+    pthread_mutex_lock(&manager->jobs_lock);
+    int job = -1;
+    if (visited_set_add(&manager->visited, url)) {
+        job = job_store_add(&manager->jobs, url, strlen(url), depth);
+        if (job >= 0) manager->discovered++;
+    }
+    pthread_mutex_unlock(&manager->jobs_lock);
+    
+    if (job >= 0 && !host_scheduler_add(&manager->scheduler, job, url)) {
+        printf("Warning: cannot schedule %s\n", url);
+    }
+}
+
+// host[:port] part of a URL's origin
+static const char* origin_authority(const char *origin) {
+    const char *authority = strstr(origin, "://");
+    return authority ? authority + 3 : origin;
+}
+
+// Link callback of a page being crawled: follows links that stay on the
+// page's host. Relative links resolve against the URL the page was
+// finally served from, after redirects.
+static void follow_link(void *context, const char *tag, const char *link) {
+    WebResponse *response = context;
+    char *base = NULL;
+    char url[MAX_LINK_LENGTH];
+    char page_origin[MAX_HOST_LENGTH];
+    char link_origin[MAX_HOST_LENGTH];
+    (void)tag;
     
-    ThreadData *thread_data = &manager->threads[manager->count];
-    strncpy(thread_data->url, url, MAX_URL_LENGTH - 1);
-    thread_data->url[MAX_URL_LENGTH - 1] = '\0';
+    curl_easy_getinfo(response->curl, CURLINFO_EFFECTIVE_URL, &base);
+    if (!base || !resolve_url(base, link, url, sizeof(url))) return;
     
-    char *filename = generate_filename(url, manager->count);
-    strncpy(thread_data->filename, filename, MAX_FILENAME_LENGTH - 1);
-    thread_data->filename[MAX_FILENAME_LENGTH - 1] = '\0';
-    free(filename);
+    url_origin(base, page_origin, sizeof(page_origin));
+    url_origin(url, link_origin, sizeof(link_origin));
+    if (strcmp(origin_authority(page_origin), origin_authority(link_origin)) != 0) return;
     
-    thread_data->thread_id = manager->count;
-    thread_data->success = 0;
-    thread_data->response_code = 0;
-    thread_data->download_time = 0.0;
+    queue_link(response->manager, url, response->depth + 1);
+}
+
+// Feeds the cached copy of an unchanged page to its link extractor
+static void scan_cached_body(ScraperManager *manager, const char *url, LinkExtractor *links) {
+    FILE *body = http_cache_open_body(manager->cache_dir, url);
+    if (!body) return;
     
-    manager->count++;
+    char buffer[RESPONSE_MIN_CAPACITY];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), body)) > 0) {
+        link_extractor_feed(links, buffer, read);
+    }
+    fclose(body);
+}
+
+// Appends a successful body, the first `size` bytes of `body`, to the
+// archive; identical bodies cost only a short revisit record
+static int archive_page(ScraperManager *manager, ThreadData *data, CURL *curl, FILE *body, size_t size,
+                        const uint8_t *digest) {
+    char *type = NULL;
+    int duplicate;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &type);
+    if (!page_archive_store(&manager->archive, data->url, type, body, size, digest, &duplicate)) {
+        printf("Thread %d: Failed to append to archive %s\n", data->thread_id, manager->archive_dir);
+        return 0;
+    }
+    if (manager->verbose) {
+        printf("Thread %d: Archived (%.2f KB)%s\n", data->thread_id, size / 1024.0,
+               duplicate ? ", same content as an earlier page" : "");
+    }
     return 1;
 }
 
-void start_scraping(ScraperManager *manager) {
-    printf("Starting %d download threads...\n", manager->count);
+// Archives the cached copy of an unchanged page, hashed in one pass over
+// the file before the archive copies it
+static int archive_cached_body(ScraperManager *manager, ThreadData *data, CURL *curl) {
+    FILE *file = http_cache_open_body(manager->cache_dir, data->url);
+    if (!file) return 0;
+    
+    Sha256 sha;
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    char buffer[RESPONSE_MIN_CAPACITY];
+    size_t size = 0, read;
+    sha256_init(&sha);
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        sha256_update(&sha, buffer, read);
+        size += read;
+    }
+    sha256_final(&sha, digest);
+    int ok = !ferror(file) && archive_page(manager, data, curl, file, size, digest);
+    fclose(file);
+    return ok;
+}
+
+// Archives a body spooled by write_callback; the stdio buffer is flushed
+// before the archive reads the file back
+static int archive_spooled_body(ScraperManager *manager, ThreadData *data, CURL *curl,
+                                WebResponse *response) {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    sha256_final(&response->digest, digest);
+    return fflush(response->file) == 0 &&
+           archive_page(manager, data, curl, response->file, response->size, digest);
+}
+
+// Sets the limit of the selected engine: worker threads, or transfers in
+// flight for the multi engine
+int set_concurrency(ScraperManager *manager, int limit) {
+    if (manager->engine == ENGINE_MULTI) {
+        if (limit < 1 || limit > MAX_TRANSFERS) return 0;
+        manager->max_transfers = limit;
+    } else {
+        if (limit < 1 || limit > MAX_WORKERS) return 0;
+        manager->max_workers = limit;
+    }
+    return 1;
+}
+
+int set_engine(ScraperManager *manager, ScraperEngine engine) {
+    if (engine != ENGINE_THREADED && engine != ENGINE_MULTI) return 0;
+    manager->engine = engine;
+    return 1;
+}
+
+// Politeness limits applied to every host; 0 disables a limit
+int set_host_limits(ScraperManager *manager, int max_per_host, double rate) {
+    if (max_per_host < 0 || rate < 0) return 0;
+    manager->host_limit = max_per_host;
+    manager->host_rate = rate;
+    return 1;
+}
+
+int set_max_retries(ScraperManager *manager, int retries) {
+    if (retries < 0 || retries > MAX_RETRIES) return 0;
+    manager->max_retries = retries;
+    return 1;
+}
+
+// Depth 0 fetches only the listed URLs; each level follows the links of
+// the pages fetched at the previous one
+int set_crawl_depth(ScraperManager *manager, int depth) {
+    if (depth < 0 || depth > MAX_CRAWL_DEPTH) return 0;
+    manager->crawl_depth = depth;
+    return 1;
+}
+
+// Selects one file per page or the page archive in `archive_dir`
+// (NULL keeps the current one); compression needs a zlib build. An open
+// archive is closed so the next run picks up the new settings.
+int set_output(ScraperManager *manager, OutputMode output, const char *archive_dir, int compress) {
+    if (output != OUTPUT_FILES && output != OUTPUT_ARCHIVE) return 0;
+    if (archive_dir && (archive_dir[0] == '\0' || strlen(archive_dir) >= sizeof(manager->archive_dir))) return 0;
+    if (compress && !page_archive_can_compress()) return 0;
+    
+    page_archive_close(&manager->archive);
+    manager->output = output;
+    if (archive_dir) strcpy(manager->archive_dir, archive_dir);
+    manager->archive_compress = compress;
+    return 1;
+}
+
+// Turns the HTTP cache on in `dir`, or off for NULL or ""
+int set_cache_dir(ScraperManager *manager, const char *dir) {
+    if (dir && strlen(dir) >= sizeof(manager->cache_dir)) return 0;
+    strcpy(manager->cache_dir, dir ? dir : "");
+    return 1;
+}
+
+const char* engine_name(ScraperEngine engine) {
+    return engine == ENGINE_MULTI ? "event-driven (curl_multi + epoll)" : "threaded (worker pool)";
+}
+
+// Pulls job indices until the queue is closed and drained. The worker
+// keeps one easy handle for all its jobs so live connections carry over.
+void* scrape_worker(void *arg) {
+    ScraperManager *manager = (ScraperManager*)arg;
+    CURL *curl = curl_easy_init();
+    int index;
+    
+    while (work_queue_pop(&manager->queue, &index)) {
+        scrape_url(manager, curl, index);
+        host_scheduler_done(&manager->scheduler, index);
+    }
+    if (curl) curl_easy_cleanup(curl);
+    return NULL;
+}
+
+// Starts a fixed pool of workers and feeds it every job through the
+// bounded queue, in the order and at the pace the host scheduler
+// releases them; returns once all jobs are queued
+static void start_worker_pool(ScraperManager *manager) {
+    // A crawl can grow past the listed URLs, so it gets the whole pool
+    int workers = manager->max_workers;
+    if (manager->crawl_depth == 0 && manager->jobs.count < workers) workers = manager->jobs.count;
+    printf("Starting %d worker threads for %d URLs...\n", workers, manager->jobs.count);
     
-    for (int i = 0; i < manager->count; i++) {
-        int result = pthread_create(&manager->thread_ids[i], NULL, 
-                                   scrape_url, &manager->threads[i]);
+    // A previous run closed the queue
+    work_queue_destroy(&manager->queue);
+    if (!work_queue_init(&manager->queue, QUEUE_CAPACITY)) {
+        printf("Error creating work queue\n");
+        manager->worker_count = 0;
+        return;
+    }
+    
+    manager->worker_count = 0;
+    for (int i = 0; i < workers; i++) {
+        int result = pthread_create(&manager->thread_ids[manager->worker_count], NULL,
+                                   scrape_worker, manager);
         if (result != 0) {
-            printf("Error creating thread %d: %d\n", i, result);
-            manager->threads[i].success = 0;
+            printf("Error creating worker %d: %d\n", i, result);
+            continue;
+        }
+        manager->worker_count++;
+    }
+    
+    // No workers: run the jobs on this thread with a handle of its own
+    CURL *curl = manager->worker_count > 0 ? NULL : curl_easy_init();
+    int job;
+    while (host_scheduler_take(&manager->scheduler, &job)) {
+        if (manager->worker_count > 0) {
+            work_queue_push(&manager->queue, job);
+        } else {
+            scrape_url(manager, curl, job);
+            host_scheduler_done(&manager->scheduler, job);
         }
     }
+    work_queue_close(&manager->queue);
+    if (curl) curl_easy_cleanup(curl);
+}
+
+// The multi engine runs to completion here; the threaded engine returns
+// once every job is queued and wait_for_completion joins the pool
+void start_scraping(ScraperManager *manager) {
+    // Pages found by the previous run's crawl are not seeds of this one
+    job_store_rewind(&manager->jobs, &manager->listed);
+    
+    // Jobs are grouped by host afresh for every run
+    host_scheduler_destroy(&manager->scheduler);
+    if (!host_scheduler_init(&manager->scheduler, manager->jobs.count, manager->host_limit, manager->host_rate)) {
+        printf("Error creating host scheduler\n");
+        return;
+    }
+    JobResult empty = {0};
+    manager->makespan = 0.0;
+    manager->run_started = monotonic_seconds();
+    manager->discovered = 0;
+    visited_set_clear(&manager->visited);
+    for (int i = 0; i < manager->jobs.count; i++) {
+        job_store_set_result(&manager->jobs, i, &empty);
+        if (manager->crawl_depth > 0) visited_set_add(&manager->visited, manager->jobs.urls[i]);
+        host_scheduler_add(&manager->scheduler, i, manager->jobs.urls[i]);
+    }
+    
+    if (manager->cache_dir[0] && !http_cache_open(manager->cache_dir)) {
+        printf("Warning: cannot use cache directory %s, caching disabled\n", manager->cache_dir);
+        manager->cache_dir[0] = '\0';
+    }
+    if (manager->save_files && manager->output == OUTPUT_ARCHIVE && !page_archive_is_open(&manager->archive) &&
+        !page_archive_open(&manager->archive, manager->archive_dir, manager->archive_compress)) {
+        printf("Warning: cannot use archive directory %s, saving one file per page\n", manager->archive_dir);
+        manager->output = OUTPUT_FILES;
+    }
+    
+    if (manager->engine == ENGINE_MULTI) {
+        run_multi_engine(manager);
+    } else {
+        start_worker_pool(manager);
+    }
 }
 
 void wait_for_completion(ScraperManager *manager) {
-    for (int i = 0; i < manager->count; i++) {
+    for (int i = 0; i < manager->worker_count; i++) {
         pthread_join(manager->thread_ids[i], NULL);
     }
+    manager->worker_count = 0;
+    manager->makespan = monotonic_seconds() - manager->run_started;
+    if (page_archive_is_open(&manager->archive) && !page_archive_flush(&manager->archive)) {
+        printf("Error: cannot write to archive %s\n", manager->archive_dir);
+    }
     printf("All downloads completed.\n");
 }
 
-void* scrape_url(void *arg) {
-    ThreadData *data = (ThreadData*)arg;
-    CURL *curl;
-    CURLcode res;
-    WebResponse response = {0};
+// Points a handle at one job; the body is collected in `response`.
+// Handles are reused between jobs, so options start from a reset; the
+// reset keeps the handle's connections and the manager's shared caches.
+void configure_transfer(ScraperManager *manager, CURL *curl, ThreadData *data, WebResponse *response) {
+    curl_easy_reset(curl);
+    connection_share_attach(&manager->share, curl);
     
-    printf("Thread %d: Starting download from %s\n", data->thread_id, data->url);
+    memset(response, 0, sizeof(*response));
+    response->curl = curl;
+    // Archived bodies are spooled and hashed as they arrive, and appended
+    // as one record once their length and digest are known
+    response->filename = manager->save_files && manager->output == OUTPUT_FILES ? data->filename : NULL;
+    response->archive = manager->save_files && manager->output == OUTPUT_ARCHIVE;
     
-    curl = curl_easy_init();
-    if (!curl) {
-        printf("Thread %d: Failed to initialize curl\n", data->thread_id);
-        data->success = 0;
-        return NULL;
+    // Pages short of the depth limit are scanned for links as they arrive
+    if (data->depth < manager->crawl_depth) {
+        response->links = malloc(sizeof(LinkExtractor));
+        if (response->links) link_extractor_init(response->links, follow_link, response);
+        response->manager = manager;
+        response->depth = data->depth;
+    }
+    
+    // Revalidate a cached copy instead of downloading it again
+    CacheValidators cached;
+    if (manager->cache_dir[0] && http_cache_lookup(manager->cache_dir, data->url, &cached)) {
+        char header[MAX_VALIDATOR_LENGTH + 32];
+        if (cached.etag[0]) {
+            snprintf(header, sizeof(header), "If-None-Match: %s", cached.etag);
+            response->headers = curl_slist_append(response->headers, header);
+        }
+        if (cached.last_modified[0]) {
+            snprintf(header, sizeof(header), "If-Modified-Since: %s", cached.last_modified);
+            response->headers = curl_slist_append(response->headers, header);
+        }
+        response->conditional = response->headers != NULL;
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, response->headers);
+    }
+    if (manager->cache_dir[0]) {
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, response);
     }
     
-    // Set curl options
     curl_easy_setopt(curl, CURLOPT_URL, data->url);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "WebScraper/1.0");
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
     
-    // Perform the request
-    double start_time = (double)clock() / CLOCKS_PER_SEC;
-    res = curl_easy_perform(curl);
-    double end_time = (double)clock() / CLOCKS_PER_SEC;
-    
-    data->download_time = end_time - start_time;
+    // The shared pool is capped by each handle's limit (5 by default), which
+    // would keep closing connections other transfers are about to reuse; size
+    // it like curl_multi does, four per concurrent transfer of the engine in use
+    int concurrency = manager->engine == ENGINE_MULTI ? manager->max_transfers : manager->max_workers;
+    curl_easy_setopt(curl, CURLOPT_MAXCONNECTS, (long)concurrency * POOL_CONNECTIONS_PER_TRANSFER);
+}
+
+// Seconds between two of libcurl's timestamps, 0 if a phase did not happen
+static double phase_seconds(curl_off_t from, curl_off_t to) {
+    return to > from ? (to - from) / 1e6 : 0.0;
+}
+
+// Splits the last attempt's timeline into phases. libcurl's timestamps
+// count from the start of the request; those of skipped phases (a reused
+// connection, plain HTTP) are 0 or repeat the previous one.
+static void read_phases(CURL *curl, double *phases) {
+    curl_off_t lookup = 0, connect = 0, tls = 0, first_byte = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &lookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
     
-    // Get response code
+    curl_off_t ready = lookup;
+    if (connect > ready) ready = connect;
+    if (tls > ready) ready = tls;
+    phases[PHASE_DNS] = phase_seconds(0, lookup);
+    phases[PHASE_CONNECT] = phase_seconds(lookup, connect);
+    phases[PHASE_TLS] = tls > 0 ? phase_seconds(connect, tls) : 0.0;
+    phases[PHASE_TTFB] = phase_seconds(ready, first_byte);
+    phases[PHASE_TRANSFER] = phase_seconds(first_byte, total);
+}
+
+static void open_sink(WebResponse *response);
+
+// Records the outcome of a finished transfer and saves a successful body.
+// Shared by the threaded and event-driven engines.
+void complete_transfer(ScraperManager *manager, ThreadData *data, CURL *curl, CURLcode res,
+                       WebResponse *response) {
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &data->response_code);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &data->new_connections);
+    data->bytes_received = response->size;
+    read_phases(curl, data->phases);
     
-    if (res != CURLE_OK) {
-        printf("Thread %d: Download failed: %s\n", data->thread_id, curl_easy_strerror(res));
+    // An empty body never reached write_callback and still needs its file
+    if (res == CURLE_OK && response->mode == SINK_PENDING && (response->filename || response->archive) &&
+        data->response_code == 200) {
+        open_sink(response);
+    }
+    
+    // The body is already on disk; closing flushes the last buffered chunk
+    if (res == CURLE_OK && response->mode == SINK_FILE) {
+        int closed = fclose(response->file) == 0;
+        response->file = NULL;
+        if (!closed) {
+            remove(response->filename);
+            response->mode = SINK_ERROR;
+        }
+    }
+    
+    if (response->mode == SINK_ERROR) {
+        if (response->filename) {
+            printf("Thread %d: Failed to create file %s\n", data->thread_id, data->filename);
+        } else if (response->archive) {
+            printf("Thread %d: Failed to spool the body to a temporary file\n", data->thread_id);
+        } else {
+            printf("Thread %d: Memory allocation failed!\n", data->thread_id);
+        }
+        data->success = 0;
+    } else if (res != CURLE_OK) {
+        if (manager->verbose) {
+            printf("Thread %d: Download failed: %s\n", data->thread_id, curl_easy_strerror(res));
+        }
         data->success = 0;
+    } else if (data->response_code == 304 && response->conditional) {
+        // Unchanged: the cached body stands in for the download
+        if (response->filename && !http_cache_restore(manager->cache_dir, data->url, data->filename)) {
+            printf("Thread %d: Failed to restore %s from the cache\n", data->thread_id, data->filename);
+            data->success = 0;
+        } else if (manager->save_files && manager->output == OUTPUT_ARCHIVE &&
+                   !archive_cached_body(manager, data, curl)) {
+            data->success = 0;
+        } else {
+            data->success = 1;
+            data->not_modified = 1;
+            if (manager->verbose) printf("Thread %d: Not modified, using cached copy\n", data->thread_id);
+            if (response->links) scan_cached_body(manager, data->url, response->links);
+        }
     } else if (data->response_code != 200) {
-        printf("Thread %d: HTTP error %ld\n", data->thread_id, data->response_code);
+        if (manager->verbose) printf("Thread %d: HTTP error %ld\n", data->thread_id, data->response_code);
+        data->success = 0;
+    } else if (response->mode == SINK_SPOOL && !archive_spooled_body(manager, data, curl, response)) {
         data->success = 0;
     } else {
-        // Save to file
-        FILE *file = fopen(data->filename, "w");
-        if (file) {
-            if (response.data) {
-                fwrite(response.data, 1, response.size, file);
+        data->success = 1;
+        if (response->filename && manager->verbose) {
+            printf("Thread %d: Successfully saved to %s (%.2f KB)\n",
+                   data->thread_id, data->filename, response->size / 1024.0);
+        }
+        
+        // Only responses that can be revalidated are worth keeping
+        if (manager->cache_dir[0] && (response->validators.etag[0] || response->validators.last_modified[0])) {
+            if (response->filename) {
+                http_cache_store_file(manager->cache_dir, data->url, &response->validators, data->filename);
+            } else if (response->mode == SINK_SPOOL) {
+                http_cache_store_stream(manager->cache_dir, data->url, &response->validators, response->file);
+            } else {
+                http_cache_store_data(manager->cache_dir, data->url, &response->validators,
+                                      response->data, response->size);
             }
-            fclose(file);
-            data->success = 1;
-            printf("Thread %d: Successfully saved to %s (%.2f KB)\n", 
-                   data->thread_id, data->filename, response.size / 1024.0);
-        } else {
-            printf("Thread %d: Failed to create file %s\n", data->thread_id, data->filename);
-            data->success = 0;
         }
     }
+}
+
+// Errors worth another attempt: the network hiccupped or the server asked
+// us to come back later
+static int is_transient(CURL *curl, CURLcode res) {
+    switch (res) {
+        case CURLE_OK: {
+            long code = 0;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+            return code == 429 || code == 502 || code == 503 || code == 504;
+        }
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Milliseconds to wait before retrying a finished attempt, or -1 to give
+// up. Exponential backoff with jitter (half fixed, half random) keeps
+// retries from many transfers from arriving in lockstep; a Retry-After
+// header from the server is honoured up to RETRY_MAX_MS.
+long retry_delay_ms(ScraperManager *manager, ThreadData *data, CURL *curl, CURLcode res, int attempt) {
+    if (attempt >= manager->max_retries || !is_transient(curl, res)) return -1;
+    
+    long backoff = RETRY_BASE_MS;
+    for (int i = 0; i < attempt && backoff < RETRY_MAX_MS; i++) backoff *= 2;
+    if (backoff > RETRY_MAX_MS) backoff = RETRY_MAX_MS;
     
-    // Cleanup
-    if (response.data) {
-        free(response.data);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    unsigned int seed = (unsigned int)ts.tv_nsec ^ ((unsigned int)data->thread_id * 2654435761u) ^ (unsigned int)attempt;
+    long delay = backoff / 2 + rand_r(&seed) % (backoff / 2 + 1);
+    
+    curl_off_t retry_after = 0;
+    curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after);
+    if (retry_after > 0) {
+        long requested = retry_after > RETRY_MAX_MS / 1000 ? RETRY_MAX_MS : (long)retry_after * 1000;
+        if (requested > delay) delay = requested;
     }
-    curl_easy_cleanup(curl);
+    return delay;
+}
+
+// Runs one job on the caller's handle
+void scrape_url(ScraperManager *manager, CURL *curl, int job) {
+    CURLcode res;
+    WebResponse response = {0};
+    ThreadData job_data;
+    ThreadData *data = &job_data;
     
-    return NULL;
+    load_job(manager, job, data);
+    if (manager->verbose) printf("Thread %d: Starting download from %s\n", data->thread_id, data->url);
+    
+    if (!curl) {
+        printf("Thread %d: Failed to initialize curl\n", data->thread_id);
+        finish_job(manager, data);
+        return;
+    }
+    
+    for (int attempt = 0; ; attempt++) {
+        configure_transfer(manager, curl, data, &response);
+        
+        res = curl_easy_perform(curl);
+        
+        long delay = retry_delay_ms(manager, data, curl, res, attempt);
+        if (delay < 0) break;
+        
+        // The worker (and its host slot) waits out the backoff
+        if (manager->verbose) printf("Thread %d: Retrying in %ld ms\n", data->thread_id, delay);
+        release_response(&response);
+        data->retries++;
+        struct timespec pause = {delay / 1000, (delay % 1000) * 1000000L};
+        nanosleep(&pause, NULL);
+    }
+    complete_transfer(manager, data, curl, res, &response);
+    finish_job(manager, data);
+    
+    release_response(&response);
+}
+
+// Grows the in-memory body to hold `needed` bytes, at least doubling
+static int reserve_response(WebResponse *response, size_t needed) {
+    if (needed <= response->capacity) return 1;
+    
+    size_t capacity = response->capacity ? response->capacity : RESPONSE_MIN_CAPACITY;
+    while (capacity < needed) capacity *= 2;
+    
+    char *new_data = realloc(response->data, capacity);
+    if (!new_data) return 0;
+    response->data = new_data;
+    response->capacity = capacity;
+    return 1;
+}
+
+// Chooses the sink once the status line and headers are known. Redirects
+// that curl follows never reach write_callback, so this is the final
+// response.
+static void open_sink(WebResponse *response) {
+    long code = 0;
+    curl_easy_getinfo(response->curl, CURLINFO_RESPONSE_CODE, &code);
+    
+    if (code != 200) {
+        response->mode = SINK_DISCARD;
+    } else if (response->archive) {
+        response->file = tmpfile();
+        sha256_init(&response->digest);
+        response->mode = response->file ? SINK_SPOOL : SINK_ERROR;
+    } else if (response->filename) {
+        response->file = fopen(response->filename, "wb");
+        response->mode = response->file ? SINK_FILE : SINK_ERROR;
+    } else {
+        // Size the buffer once when the server announces the length
+        curl_off_t length = -1;
+        curl_easy_getinfo(response->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        response->mode = SINK_MEMORY;
+        if (length > 0 && !reserve_response(response, (size_t)length + 1)) {
+            response->mode = SINK_ERROR;
+        }
+    }
+    
+    // Only HTML pages have links worth following
+    char *type = NULL;
+    curl_easy_getinfo(response->curl, CURLINFO_CONTENT_TYPE, &type);
+    if (response->links && (code != 200 || (type && strncasecmp(type, "text/html", 9) != 0 &&
+                                             strncasecmp(type, "application/xhtml+xml", 21) != 0))) {
+        free(response->links);
+        response->links = NULL;
+    }
 }
 
+// Streams each chunk to the sink: file and spooled bodies only ever
+// occupy the stdio buffer, memory bodies grow geometrically
 size_t write_callback(void *contents, size_t size, size_t nmemb, WebResponse *response) {
     size_t total_size = size * nmemb;
     
-    char *new_data = realloc(response->data, response->size + total_size + 1);
-    if (!new_data) {
-        printf("Memory allocation failed!\n");
-        return 0;
+    if (response->mode == SINK_PENDING) open_sink(response);
+    
+    switch (response->mode) {
+        case SINK_SPOOL:
+            sha256_update(&response->digest, contents, total_size);
+            // fall through
+        case SINK_FILE:
+            if (fwrite(contents, 1, total_size, response->file) != total_size) {
+                response->mode = SINK_ERROR;
+                return 0;
+            }
+            break;
+        case SINK_MEMORY:
+            if (!reserve_response(response, response->size + total_size + 1)) {
+                response->mode = SINK_ERROR;
+                return 0;
+            }
+            memcpy(&(response->data[response->size]), contents, total_size);
+            response->data[response->size + total_size] = '\0';
+            break;
+        case SINK_ERROR:
+            return 0;
+        default:
+            break;
     }
     
-    response->data = new_data;
-    memcpy(&(response->data[response->size]), contents, total_size);
-    response->size += total_size;
-    response->data[response->size] = '\0';
+    // Links are queued while the rest of the page is still arriving
+    if (response->links) link_extractor_feed(response->links, contents, total_size);
     
+    response->size += total_size;
     return total_size;
 }
 
+// Copies a header value into `value` when `line` is that header
+static void capture_header(const char *line, size_t length, const char *name, char *value) {
+    size_t name_length = strlen(name);
+    if (length <= name_length || strncasecmp(line, name, name_length) != 0) return;
+    
+    line += name_length;
+    length -= name_length;
+    while (length > 0 && (*line == ' ' || *line == '\t')) {
+        line++;
+        length--;
+    }
+    while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == '\n' || line[length - 1] == ' ')) {
+        length--;
+    }
+    if (length >= MAX_VALIDATOR_LENGTH) return;     // Too long to send back; treat as absent
+    memcpy(value, line, length);
+    value[length] = '\0';
+}
+
+// Keeps the validators of the final response; each redirect hop starts
+// with a new status line
+size_t header_callback(char *buffer, size_t size, size_t nitems, WebResponse *response) {
+    size_t length = size * nitems;
+    
+    if (length >= 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+        response->validators.etag[0] = '\0';
+        response->validators.last_modified[0] = '\0';
+    } else {
+        capture_header(buffer, length, "ETag:", response->validators.etag);
+        capture_header(buffer, length, "Last-Modified:", response->validators.last_modified);
+    }
+    return length;
+}
+
+// Frees the body; an output file still open here belongs to a failed
+// transfer and is removed rather than left half-written, a spool file
+// goes away when closed
+void release_response(WebResponse *response) {
+    if (response->file) {
+        fclose(response->file);
+        if (response->filename) remove(response->filename);
+        response->file = NULL;
+    }
+    free(response->data);
+    response->data = NULL;
+    response->capacity = 0;
+    curl_slist_free_all(response->headers);
+    response->headers = NULL;
+    free(response->links);
+    response->links = NULL;
+}
+
 char* generate_filename(const char *url, int thread_id) {
     char *filename = malloc(MAX_FILENAME_LENGTH);
     if (!filename) return NULL;
@@ -196,48 +836,132 @@ int is_valid_url(const char *url) {
 }
 
 void print_results(ScraperManager *manager) {
+    JobStore *jobs = &manager->jobs;
     printf("\n=== Download Results ===\n");
     printf("%-8s %-50s %-12s %-8s %-10s\n", "Thread", "URL", "Status", "Code", "Time(s)");
     printf("--------------------------------------------------------------------------------\n");
     
-    for (int i = 0; i < manager->count; i++) {
-        ThreadData *data = &manager->threads[i];
-        printf("%-8d %-50.47s %-12s %-8ld %-10.3f\n",
-               data->thread_id,
-               data->url,
-               data->success ? "SUCCESS" : "FAILED",
-               data->response_code,
-               data->download_time);
+    for (int i = 0; i < jobs->count; i++) {
+        printf("%-8d %-50.47s %-12s %-8d %-10.3f\n",
+               i,
+               jobs->urls[i],
+               (jobs->flags[i] & JOB_SUCCESS) ? "SUCCESS" : "FAILED",
+               jobs->status[i],
+               jobs->seconds[i]);
     }
 }
 
 void print_statistics(ScraperManager *manager) {
-    int successful = count_successful_downloads(manager);
-    double total_time = calculate_total_time(manager);
+    RunReport report;
+    if (!build_run_report(manager, &report)) {
+        printf("Error: not enough memory for statistics\n");
+        return;
+    }
+    int count = report.requests;
     
     printf("\n=== Statistics ===\n");
-    printf("Total URLs: %d\n", manager->count);
-    printf("Successful: %d\n", successful);
-    printf("Failed: %d\n", manager->count - successful);
-    printf("Success Rate: %.1f%%\n", (double)successful / manager->count * 100);
-    printf("Total Download Time: %.3f seconds\n", total_time);
-    printf("Average Time per URL: %.3f seconds\n", total_time / manager->count);
+    printf("Total URLs: %d\n", count);
+    if (manager->crawl_depth > 0) printf("Found by crawling: %d\n", manager->discovered);
+    printf("Successful: %d\n", report.successful);
+    printf("Failed: %d\n", count - report.successful);
+    printf("Success Rate: %.1f%%\n", (double)report.successful / count * 100);
+    printf("Makespan: %.3f seconds\n", report.makespan);
+    printf("Throughput: %.1f requests/sec, %.2f MB/sec\n",
+           report.requests_per_second, report.megabytes_per_second);
+    
+    int answered;
+    int reused = count_reused_connections(manager, &answered);
+    if (answered > 0) {
+        printf("Connection Reuse: %d of %d requests (%.1f%%), pool of %d connections\n",
+               reused, answered, (double)reused / answered * 100,
+               report.concurrency * POOL_CONNECTIONS_PER_TRANSFER);
+    }
+    printf("Retries: %d\n", report.retries);
+    printf("Not Modified (cached): %d\n", report.not_modified);
+    printf("Downloaded: %.2f KB\n", report.bytes / 1024.0);
+    if (page_archive_is_open(&manager->archive)) {
+        PageArchive *archive = &manager->archive;
+        printf("Archived: %d records (%d duplicates), %.2f KB of pages in %.2f KB\n", archive->records,
+               archive->duplicates, archive->body_bytes / 1024.0, archive->stored_bytes / 1024.0);
+    }
+    
+    if (report.answered == 0) return;
+    printf("\nLatency (ms) over %d responses:\n", report.answered);
+    printf("%-10s %10s %10s %10s %10s\n", "Phase", "Mean", "p50", "p95", "p99");
+    printf("%-10s %10.2f %10.2f %10.2f %10.2f\n", "total", report.total.mean * 1000,
+           report.total.p50 * 1000, report.total.p95 * 1000, report.total.p99 * 1000);
+    for (int phase = 0; phase < JOB_PHASES; phase++) {
+        LatencySummary *summary = &report.phases[phase];
+        printf("%-10s %10.2f %10.2f %10.2f %10.2f\n", phase_name(phase), summary->mean * 1000,
+               summary->p50 * 1000, summary->p95 * 1000, summary->p99 * 1000);
+    }
 }
 
-double calculate_total_time(ScraperManager *manager) {
-    double total = 0.0;
-    for (int i = 0; i < manager->count; i++) {
-        total += manager->threads[i].download_time;
-    }
-    return total;
+int build_run_report(ScraperManager *manager, RunReport *report) {
+    if (!build_report(&manager->jobs, manager->makespan, report)) return 0;
+    report->engine = engine_name(manager->engine);
+    report->concurrency = manager->engine == ENGINE_MULTI ? manager->max_transfers : manager->max_workers;
+    return 1;
+}
+
+// The format follows the extension: .csv for one row per job, JSON otherwise
+int export_run_report(ScraperManager *manager, const char *path) {
+    RunReport report;
+    if (!build_run_report(manager, &report)) return 0;
+    
+    const char *extension = strrchr(path, '.');
+    ReportFormat format = extension && strcasecmp(extension, ".csv") == 0 ? REPORT_CSV : REPORT_JSON;
+    return export_report(&manager->jobs, &report, path, format);
 }
 
 int count_successful_downloads(ScraperManager *manager) {
     int count = 0;
-    for (int i = 0; i < manager->count; i++) {
-        if (manager->threads[i].success) {
+    for (int i = 0; i < manager->jobs.count; i++) {
+        if (manager->jobs.flags[i] & JOB_SUCCESS) {
             count++;
         }
     }
     return count;
+}
+
+// Requests that got a response without opening a new connection;
+// `answered` receives the number that got a response at all
+int count_reused_connections(ScraperManager *manager, int *answered) {
+    int reused = 0;
+    *answered = 0;
+    for (int i = 0; i < manager->jobs.count; i++) {
+        if (manager->jobs.status[i] == 0) continue;
+        (*answered)++;
+        if (manager->jobs.new_connections[i] == 0) {
+            reused++;
+        }
+    }
+    return reused;
+}
+
+int count_retries(ScraperManager *manager) {
+    int count = 0;
+    for (int i = 0; i < manager->jobs.count; i++) {
+        count += manager->jobs.retries[i];
+    }
+    return count;
+}
+
+int count_not_modified(ScraperManager *manager) {
+    int count = 0;
+    for (int i = 0; i < manager->jobs.count; i++) {
+        if (manager->jobs.flags[i] & JOB_NOT_MODIFIED) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Body bytes that came over the network in the last run
+double calculate_total_bytes(ScraperManager *manager) {
+    double total = 0.0;
+    for (int i = 0; i < manager->jobs.count; i++) {
+        total += manager->jobs.bytes[i];
+    }
+    return total;
 }
\ No newline at end of file
@@ -7,51 +7,166 @@
 #include <pthread.h>
 #include <curl/curl.h>
 #include <unistd.h>
+#include "work_queue.h"
+#include "connection_share.h"
+#include "host_scheduler.h"
+#include "http_cache.h"
+#include "job_store.h"
+#include "run_report.h"
+#include "link_extractor.h"
+#include "visited_set.h"
+#include "page_archive.h"
 
-#define MAX_URL_LENGTH 512
+#define MAX_URL_LENGTH 512         // Interactive input only; stored URLs have no limit
 #define MAX_FILENAME_LENGTH 256
-#define MAX_URLS 50
+#define DEFAULT_WORKERS 8
+#define MAX_WORKERS 256
+#define QUEUE_CAPACITY 1024
+#define DEFAULT_TRANSFERS 64
+#define MAX_TRANSFERS 10000
+#define POOL_CONNECTIONS_PER_TRANSFER 4 // Idle connections kept, like curl_multi's default
+#define DEFAULT_HOST_CONCURRENCY 6
+#define DEFAULT_RETRIES 3
+#define MAX_RETRIES 10
+#define RETRY_BASE_MS 250       // Backoff before the first retry, doubled for each next one
+#define RETRY_MAX_MS 30000
+#define DEFAULT_CACHE_DIR ".scraper_cache"
+#define MAX_CRAWL_DEPTH 16
+#define DEFAULT_ARCHIVE_DIR "scraper_archive"
+
+// How start_scraping runs the jobs
+typedef enum {
+    ENGINE_THREADED,    // Worker pool, one blocking transfer per thread
+    ENGINE_MULTI        // One thread driving curl_multi with epoll
+} ScraperEngine;
+
+// Where saved bodies go
+typedef enum {
+    OUTPUT_FILES,       // One .html file per job
+    OUTPUT_ARCHIVE      // Deduplicated records in the page archive's segments
+} OutputMode;
+
+#define RESPONSE_MIN_CAPACITY 16384
+
+struct ScraperManager;
+
+// Where a body goes; decided when its first chunk arrives
+typedef enum {
+    SINK_PENDING,       // Nothing received yet
+    SINK_FILE,          // Streamed to the output file
+    SINK_SPOOL,         // Streamed to a temporary file and hashed, for the page archive
+    SINK_MEMORY,        // Collected in data (files are not being saved)
+    SINK_DISCARD,       // Error status: counted, not kept
+    SINK_ERROR          // The output file could not be created or written
+} SinkMode;
 
 typedef struct {
-    char *data;
-    size_t size;
+    SinkMode mode;
+    CURL *curl;             // Status and Content-Length are read from it
+    const char *filename;   // Output file, NULL to keep the body in memory
+    int archive;            // Spool the body for the page archive instead
+    FILE *file;             // Output or spool file
+    Sha256 digest;          // SINK_SPOOL only, of the bytes spooled so far
+    char *data;             // SINK_MEMORY only, NUL-terminated
+    size_t capacity;
+    size_t size;            // Body bytes received
+    struct curl_slist *headers;     // Conditional request headers, if any
+    int conditional;        // Validators of a cached copy were sent
+    CacheValidators validators;     // From the final response's headers
+    LinkExtractor *links;   // Scans an HTML body for links to crawl, NULL otherwise
+    struct ScraperManager *manager; // Where found links are queued
+    int depth;              // Crawl depth of the page
 } WebResponse;
 
+// Working state of one job while a worker or event-loop slot runs it; the
+// outcome goes back to the job store when the job finishes
 typedef struct {
-    char url[MAX_URL_LENGTH];
+    const char *url;        // Owned by the job store
     char filename[MAX_FILENAME_LENGTH];
-    int thread_id;
+    int thread_id;          // Job index
+    int depth;              // Links followed to reach this job
     int success;
     long response_code;
-    double download_time;
+    double started_at;      // Monotonic seconds when the job was loaded
+    double phases[JOB_PHASES];      // Of the final attempt
+    long new_connections;   // Connections opened for this job, 0 if one was reused
+    int retries;            // Attempts after the first one
+    int not_modified;       // 304: the cached copy was used
+    size_t bytes_received;  // Body bytes of the final attempt
 } ThreadData;
 
-typedef struct {
-    ThreadData *threads;
-    int count;
-    pthread_t *thread_ids;
+typedef struct ScraperManager {
+    JobStore jobs;          // URLs and results of every job
+    JobStoreMark listed;    // The store as add_url left it; jobs past it came from crawling
+    pthread_mutex_t jobs_lock;      // Guards the store while a crawl adds jobs
+    pthread_t *thread_ids;  // Worker threads of the current run
+    int max_workers;        // Concurrency limit of the threaded engine
+    int worker_count;       // Workers started by start_scraping
+    WorkQueue queue;        // Job indices waiting for a worker
+    ScraperEngine engine;
+    int max_transfers;      // Concurrency limit of the multi engine
+    int verbose;            // Print a line per transfer
+    int save_files;         // Write bodies to their output files
+    ConnectionShare share;  // DNS, connection and TLS session caches
+    HostScheduler scheduler;// Order of the current run's jobs
+    int host_limit;         // Requests in flight per host, 0 for no limit
+    double host_rate;       // New requests per second per host, 0 for no limit
+    int max_retries;        // For transient errors, 429 and 5xx gateway errors
+    char cache_dir[MAX_FILENAME_LENGTH];    // Empty when the HTTP cache is off
+    double run_started;     // Monotonic seconds when the last run started
+    double makespan;        // Wall-clock seconds of the last run, 0 before one finished
+    int crawl_depth;        // Levels of same-host links to follow, 0 for none
+    VisitedSet visited;     // URLs queued in the current run
+    int discovered;         // Jobs the current run added by following links
+    OutputMode output;
+    char archive_dir[MAX_FILENAME_LENGTH];
+    int archive_compress;   // gzip each archive record
+    PageArchive archive;    // Open while archive_dir is in use
 } ScraperManager;
 
 // Core functions
-ScraperManager* init_scraper(int max_threads);
+ScraperManager* init_scraper(int initial_capacity);
 void free_scraper(ScraperManager *manager);
 int add_url(ScraperManager *manager, const char *url);
+void clear_urls(ScraperManager *manager);
+int set_concurrency(ScraperManager *manager, int limit);
+int set_engine(ScraperManager *manager, ScraperEngine engine);
+int set_host_limits(ScraperManager *manager, int max_per_host, double rate);
+int set_max_retries(ScraperManager *manager, int retries);
+int set_cache_dir(ScraperManager *manager, const char *dir);
+int set_crawl_depth(ScraperManager *manager, int depth);
+int set_output(ScraperManager *manager, OutputMode output, const char *archive_dir, int compress);
+const char* engine_name(ScraperEngine engine);
 void start_scraping(ScraperManager *manager);
 void wait_for_completion(ScraperManager *manager);
 void print_results(ScraperManager *manager);
 
-// Thread function
-void* scrape_url(void *arg);
+// Transfers
+void load_job(ScraperManager *manager, int job, ThreadData *data);
+void finish_job(ScraperManager *manager, const ThreadData *data);
+void scrape_url(ScraperManager *manager, CURL *curl, int job);
+void* scrape_worker(void *arg);
+void configure_transfer(ScraperManager *manager, CURL *curl, ThreadData *data, WebResponse *response);
+void complete_transfer(ScraperManager *manager, ThreadData *data, CURL *curl, CURLcode res,
+                       WebResponse *response);
+long retry_delay_ms(ScraperManager *manager, ThreadData *data, CURL *curl, CURLcode res, int attempt);
 
 // Utility functions
 size_t write_callback(void *contents, size_t size, size_t nmemb, WebResponse *response);
+size_t header_callback(char *buffer, size_t size, size_t nitems, WebResponse *response);
+void release_response(WebResponse *response);
 char* generate_filename(const char *url, int thread_id);
 int is_valid_url(const char *url);
 void sanitize_filename(char *filename);
 
 // Statistics
 void print_statistics(ScraperManager *manager);
-double calculate_total_time(ScraperManager *manager);
+int build_run_report(ScraperManager *manager, RunReport *report);
+int export_run_report(ScraperManager *manager, const char *path);
 int count_successful_downloads(ScraperManager *manager);
+int count_reused_connections(ScraperManager *manager, int *answered);
+int count_retries(ScraperManager *manager);
+int count_not_modified(ScraperManager *manager);
+double calculate_total_bytes(ScraperManager *manager);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "work_queue.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <sched.h>
+
+int work_queue_init(WorkQueue *queue, size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+
+    queue->cells = malloc(size * sizeof(QueueCell));
+    if (!queue->cells) return 0;
+    for (size_t i = 0; i < size; i++) queue->cells[i].sequence = i;
+
+    queue->mask = size - 1;
+    queue->enqueue_pos = 0;
+    queue->dequeue_pos = 0;
+    queue->closed = 0;
+    if (sem_init(&queue->items, 0, 0) != 0) {
+        free(queue->cells);
+        return 0;
+    }
+    if (sem_init(&queue->slots, 0, (unsigned int)size) != 0) {
+        sem_destroy(&queue->items);
+        free(queue->cells);
+        return 0;
+    }
+    return 1;
+}
+
+void work_queue_destroy(WorkQueue *queue) {
+    sem_destroy(&queue->items);
+    sem_destroy(&queue->slots);
+    free(queue->cells);
+    queue->cells = NULL;
+}
+
+// Claims the next enqueue position with a CAS; fails if the ring is full
+static int try_enqueue(WorkQueue *queue, int value) {
+    size_t pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+    QueueCell *cell;
+    while (1) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    cell->value = value;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Claims the next dequeue position; fails if that cell is not published yet
+static int try_dequeue(WorkQueue *queue, int *value) {
+    size_t pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+    QueueCell *cell;
+    while (1) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->dequeue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    *value = cell->value;
+    __atomic_store_n(&cell->sequence, pos + queue->mask + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int work_queue_push(WorkQueue *queue, int value) {
+    if (__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE)) return 0;
+
+    sem_wait(&queue->slots);
+    // A slot is free, but its consumer may still be finishing with the cell
+    while (!try_enqueue(queue, value)) sched_yield();
+    sem_post(&queue->items);
+    return 1;
+}
+
+int work_queue_pop(WorkQueue *queue, int *value) {
+    sem_wait(&queue->items);
+    while (!try_dequeue(queue, value)) {
+        // After close, a wake-up with nothing left is the close token:
+        // pass it on so the next idle consumer exits too
+        if (__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&queue->dequeue_pos, __ATOMIC_ACQUIRE) ==
+            __atomic_load_n(&queue->enqueue_pos, __ATOMIC_ACQUIRE)) {
+            sem_post(&queue->items);
+            return 0;
+        }
+        sched_yield();
+    }
+    sem_post(&queue->slots);
+    return 1;
+}
+
+void work_queue_close(WorkQueue *queue) {
+    __atomic_store_n(&queue->closed, 1, __ATOMIC_RELEASE);
+    sem_post(&queue->items);
+}
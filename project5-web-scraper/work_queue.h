@@ -0,0 +1,44 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <stddef.h>
+#include <semaphore.h>
+
+#define CACHE_LINE_SIZE 64
+
+typedef struct {
+    size_t sequence;
+    int value;
+} QueueCell;
+
+// Bounded multi-producer/multi-consumer queue of job indices. The ring is
+// lock-free (each cell carries a sequence number that tells producers and
+// consumers whose turn it is); two semaphores only put threads to sleep
+// while the queue is full or empty.
+typedef struct {
+    QueueCell *cells;
+    size_t mask;
+    char pad0[CACHE_LINE_SIZE];
+    size_t enqueue_pos;
+    char pad1[CACHE_LINE_SIZE - sizeof(size_t)];
+    size_t dequeue_pos;
+    char pad2[CACHE_LINE_SIZE - sizeof(size_t)];
+    sem_t items;
+    sem_t slots;
+    int closed;
+} WorkQueue;
+
+// Capacity is rounded up to a power of two
+int work_queue_init(WorkQueue *queue, size_t capacity);
+void work_queue_destroy(WorkQueue *queue);
+
+// Blocking calls: push waits for a free slot; pop waits for an item and
+// returns 0 once the queue is closed and drained
+int work_queue_push(WorkQueue *queue, int value);
+int work_queue_pop(WorkQueue *queue, int *value);
+
+// Called once every push has returned; later pushes fail and idle
+// consumers are woken to exit
+void work_queue_close(WorkQueue *queue);
+
+#endif